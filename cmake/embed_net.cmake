@@ -0,0 +1,19 @@
+# converts a network file into a C++ source file, so the network can
+# be compiled directly into the binary instead of being loaded at runtime
+function(embed_net NET_FILE OUT_FILE)
+    file(READ "${NET_FILE}" NET_HEX HEX)
+    file(SIZE "${NET_FILE}" NET_SIZE)
+
+    # every byte becomes a "0x??," literal, 16 bytes per line
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," NET_BYTES "${NET_HEX}")
+    string(REPEAT "0x..," 16 LINE_PATTERN)
+    string(REGEX REPLACE "(${LINE_PATTERN})" "\\1\n    " NET_BYTES "${NET_BYTES}")
+
+    file(WRITE "${OUT_FILE}"
+        "// generated from ${NET_FILE}, do not edit\n\n"
+        "#include \"src/eval/embedded_net.h\"\n\n"
+        "namespace Kreveta {\n\n"
+        "alignas(64) extern const unsigned char EMBEDDED_NET[] = {\n    ${NET_BYTES}\n};\n\n"
+        "extern const std::size_t EMBEDDED_NET_SIZE = ${NET_SIZE};\n\n"
+        "}\n")
+endfunction()
@@ -7,12 +7,13 @@
 #include "board.h"
 
 #include <format>
-#include <iostream>
+#include <string>
 
 #include "bitboard.h"
 #include "uci.h"
 #include "global/consts.h"
 #include "movegen/move.h"
+#include "movegen/movegen.h"
 
 namespace Kreveta {
 
@@ -28,10 +29,24 @@ PieceType Board::piece_at(const uint8_t sq, const Color col) const {
 }
 
 void Board::play_move(const Move move) {
+    DirtyPieces dirty;
+    play_move(move, dirty);
+}
+
+void Board::play_move(const Move move, DirtyPieces &dirty) {
+    dirty.removed_count = 0;
+    dirty.added_count   = 0;
+
+    // the old en passant square and castling rights must be removed from the key
+    if (en_passant_sq != 64)
+        key ^= ZOBRIST.en_passant[en_passant_sq & 7];
+
+    const uint8_t old_castling = castling_rights;
 
     // reset the en passant square and flip the side to move
     en_passant_sq = 64;
     color = col_flip(color);
+    key ^= ZOBRIST.side;
 
     const uint8_t start_i = move.start();
     const uint8_t end_i   = move.end();
@@ -57,6 +72,10 @@ void Board::play_move(const Move move) {
         pieces[col_opp][PT_PAWN] ^= capt_sq;
         pieces[col    ][PT_PAWN] ^= start | end;
 
+        dirty.remove(col,     PT_PAWN, start_i);
+        dirty.remove(col_opp, PT_PAWN, ls1b(capt_sq));
+        dirty.add   (col,     PT_PAWN, end_i);
+
         if (col == COL_WHITE) {
             w_occupied ^= start | end;
             b_occupied ^= capt_sq;
@@ -81,6 +100,19 @@ void Board::play_move(const Move move) {
         pieces[col][PT_KING] ^= start | end;
         pieces[col][PT_ROOK] ^= rook;
 
+        // the rook bitboard contains both the starting and the ending square,
+        // but we need to know which one is which. when castling kingside, the
+        // rook starts right next to the king's target square, otherwise it
+        // starts two squares to the left of it
+        const uint64_t rook_start = (end_i & 7) == 6
+            ? end << 1
+            : end >> 2;
+
+        dirty.remove(col, PT_KING, start_i);
+        dirty.remove(col, PT_ROOK, ls1b(rook_start));
+        dirty.add   (col, PT_KING, end_i);
+        dirty.add   (col, PT_ROOK, ls1b(rook ^ rook_start));
+
         if (col == COL_WHITE) w_occupied ^= rook | start | end;
         else                  b_occupied ^= rook | start | end;
     }
@@ -90,6 +122,9 @@ void Board::play_move(const Move move) {
         pieces[col][piece] ^= start;
         pieces[col][prom]  ^= end;
 
+        dirty.remove(col, piece, start_i);
+        dirty.add   (col, prom,  end_i);
+
         if (col == COL_WHITE) w_occupied ^= start | end;
         else                  b_occupied ^= start | end;
     }
@@ -98,6 +133,9 @@ void Board::play_move(const Move move) {
     else {
         pieces[col][piece] ^= start | end;
 
+        dirty.remove(col, piece, start_i);
+        dirty.add   (col, piece, end_i);
+
         // if we double pushed a pawn, set the en passant square
         if (piece == PT_PAWN && (col == COL_WHITE
             ? start >> 16 == end
@@ -117,6 +155,7 @@ void Board::play_move(const Move move) {
     // captures
     if (capt != PT_NONE) {
         pieces[col_opp][capt] ^= end;
+        dirty.remove(col_opp, capt, end_i);
 
         if (col == COL_WHITE) b_occupied ^= end;
         else                  w_occupied ^= end;
@@ -136,28 +175,62 @@ void Board::play_move(const Move move) {
     // a rook moved or was captured => remove castling right
     if (castling_rights && (piece == PT_ROOK || capt == PT_ROOK)) {
 
-        // if rook moved we need the starting square
-        // if rook was captured we need the ending square
-        const auto rook_sq = piece == PT_ROOK
-            ? start_i
-            : end_i;
-
-        switch (rook_sq) {
-            case 0:  remove_castling_right(CR_B_QUEENSIDE); break;
-            case 7:  remove_castling_right(CR_B_KINGSIDE);  break;
-            case 56: remove_castling_right(CR_W_QUEENSIDE); break;
-            case 63: remove_castling_right(CR_W_KINGSIDE);  break;
-            default: break;
+        // if rook moved we need the starting square, if rook was captured
+        // we need the ending square. a rook capturing a rook needs both
+        for (const uint8_t rook_sq : { start_i, end_i }) {
+            switch (rook_sq) {
+                case 0:  remove_castling_right(CR_B_QUEENSIDE); break;
+                case 7:  remove_castling_right(CR_B_KINGSIDE);  break;
+                case 56: remove_castling_right(CR_W_QUEENSIDE); break;
+                case 63: remove_castling_right(CR_W_KINGSIDE);  break;
+                default: break;
+            }
         }
     }
+
+    // the pieces in the key are updated using the dirty pieces, which
+    // already contain everything that has changed on the board
+    for (int i = 0; i < dirty.removed_count; i++) {
+        const auto &[c, pt, sq] = dirty.removed[i];
+        key ^= ZOBRIST.pieces[c][pt][sq];
+    }
+
+    for (int i = 0; i < dirty.added_count; i++) {
+        const auto &[c, pt, sq] = dirty.added[i];
+        key ^= ZOBRIST.pieces[c][pt][sq];
+    }
+
+    key ^= ZOBRIST.castling[old_castling] ^ ZOBRIST.castling[castling_rights];
+
+    if (en_passant_sq != 64)
+        key ^= ZOBRIST.en_passant[en_passant_sq & 7];
+
+    // pawn moves and captures are irreversible, which resets the fifty-move rule
+    if (piece == PT_PAWN || capt != PT_NONE) halfmove_clock = 0;
+    else if (halfmove_clock < 255)           halfmove_clock++;
+}
+
+void Board::play_null_move() {
+    if (en_passant_sq != 64)
+        key ^= ZOBRIST.en_passant[en_passant_sq & 7];
+
+    en_passant_sq = 64;
+    color = col_flip(color);
+    key ^= ZOBRIST.side;
+
+    if (halfmove_clock < 255)
+        halfmove_clock++;
 }
 
 void Board::play_reversible_move(Move move, Color color) {
 
 }
 
-bool Board::is_move_legal(Move move, Color color) {
-    return false;
+bool Board::is_move_legal(const Move move, const Color color) const {
+    Board child = clone();
+    child.play_move(move);
+
+    return !Movegen::is_in_check(child, color);
 }
 
 void Board::print() const {
@@ -179,14 +252,74 @@ void Board::print() const {
         }
     }
 
+    std::string rank;
     for (int i = 0; i < 64; i++) {
-        std::cout << chars[i] << ' ';
+        rank += chars[i];
+        rank += ' ';
 
-        // if we are at the end of a rank, we print a newline
+        // if we are at the end of a rank, we print it as one line
         if ((i + 1 & 7) == 0) {
-            std::cout << std::endl;
+            UCI::log(rank);
+            rank.clear();
+        }
+    }
+}
+
+std::string Board::to_fen() const {
+    std::string fen;
+
+    for (int rank = 0; rank < 8; rank++) {
+        int empty = 0;
+
+        for (int file = 0; file < 8; file++) {
+            const uint8_t sq = rank * 8 + file;
+
+            const Color col = is_bit_set(w_occupied, sq) ? COL_WHITE
+                            : is_bit_set(b_occupied, sq) ? COL_BLACK
+                            : COL_NONE;
+
+            if (col == COL_NONE) {
+                empty++;
+                continue;
+            }
+
+            // empty squares are written as a single digit before the next piece
+            if (empty) {
+                fen += static_cast<char>('0' + empty);
+                empty = 0;
+            }
+
+            const char piece = PIECES[piece_at(sq, col)];
+            fen += col == COL_WHITE
+                ? static_cast<char>(std::toupper(piece))
+                : piece;
         }
+
+        if (empty)
+            fen += static_cast<char>('0' + empty);
+
+        if (rank != 7)
+            fen += '/';
     }
+
+    fen += color == COL_WHITE ? " w " : " b ";
+
+    if (castling_rights == CR_NONE) fen += '-';
+    if (has_castling_right(CR_W_KINGSIDE))  fen += 'K';
+    if (has_castling_right(CR_W_QUEENSIDE)) fen += 'Q';
+    if (has_castling_right(CR_B_KINGSIDE))  fen += 'k';
+    if (has_castling_right(CR_B_QUEENSIDE)) fen += 'q';
+
+    fen += ' ';
+
+    if (en_passant_sq == 64) {
+        fen += '-';
+    } else {
+        fen += FILES[en_passant_sq & 7];
+        fen += static_cast<char>('8' - (en_passant_sq >> 3));
+    }
+
+    return fen;
 }
 
 }
@@ -5,8 +5,11 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <bit>
 #include <cstdint>
+#include <string>
 
+#include "zobrist.h"
 #include "global/types.h"
 #include "movegen/move.h"
 
@@ -14,6 +17,33 @@ namespace Kreveta {
 
 struct Move;
 
+// a single piece placed on or removed from a square
+struct PieceSquare {
+    Color     color;
+    PieceType piece;
+    uint8_t   sq;
+};
+
+// all pieces that were changed by a single move. a move can remove at most two
+// pieces (the moving piece and a capture, or the king and rook when castling)
+// and add at most two. incrementally updated evaluation only needs these deltas
+// instead of comparing the whole board before and after the move
+struct DirtyPieces {
+    PieceSquare removed[2];
+    PieceSquare added[2];
+
+    uint8_t removed_count = 0;
+    uint8_t added_count   = 0;
+
+    constexpr void remove(const Color col, const PieceType pt, const uint8_t sq) {
+        removed[removed_count++] = { col, pt, sq };
+    }
+
+    constexpr void add(const Color col, const PieceType pt, const uint8_t sq) {
+        added[added_count++] = { col, pt, sq };
+    }
+};
+
 class Board {
 public:
 
@@ -26,6 +56,12 @@ public:
     uint8_t  castling_rights = CR_ALL;
     Color    color           = COL_WHITE;
 
+    // number of moves since the last capture or pawn move (fifty-move rule)
+    uint8_t  halfmove_clock  = 0;
+
+    // zobrist key of the position, updated incrementally by play_move
+    uint64_t key             = 0ULL;
+
     // return a bitboard with all empty squares on the board
     [[nodiscard]] constexpr uint64_t empty() const {
         return ~(this->w_occupied | this->b_occupied);
@@ -38,6 +74,37 @@ public:
 
     [[nodiscard]] PieceType piece_at(uint8_t sq, Color col) const;
 
+    // each side must have exactly one king and at most 16 pieces. positions
+    // from external files should be checked before being evaluated
+    [[nodiscard]] constexpr bool has_valid_material() const {
+        return std::popcount(pieces[COL_WHITE][PT_KING]) == 1
+            && std::popcount(pieces[COL_BLACK][PT_KING]) == 1
+            && std::popcount(w_occupied) <= 16
+            && std::popcount(b_occupied) <= 16;
+    }
+
+    // neither side can possibly checkmate (only kings and at most one minor piece)
+    [[nodiscard]] constexpr bool has_insufficient_material() const {
+        const uint64_t heavy = pieces[COL_WHITE][PT_PAWN]  | pieces[COL_BLACK][PT_PAWN]
+                             | pieces[COL_WHITE][PT_ROOK]  | pieces[COL_BLACK][PT_ROOK]
+                             | pieces[COL_WHITE][PT_QUEEN] | pieces[COL_BLACK][PT_QUEEN];
+
+        return !heavy && std::popcount(occupied()) <= 3;
+    }
+
+    // the number of pieces of each type and color packed into four bits each (the
+    // kings are left out). positions with the same material have the same key
+    [[nodiscard]] constexpr uint64_t material_key() const {
+        uint64_t k = 0ULL;
+
+        for (int col = 0; col < 2; col++) {
+            for (int pt = 0; pt < 5; pt++)
+                k |= static_cast<uint64_t>(std::popcount(pieces[col][pt])) << (col * 5 + pt) * 4;
+        }
+
+        return k;
+    }
+
     constexpr void add_castling_right(const CastlingRights cr) {
         castling_rights |= cr;
     }
@@ -51,12 +118,45 @@ public:
     }
 
     void play_move(Move move);
+    void play_move(Move move, DirtyPieces &dirty);
     void play_reversible_move(Move move, Color color);
 
-    bool is_move_legal(Move move, Color color);
+    // pass the turn to the opponent without moving (null move pruning)
+    void play_null_move();
+
+    // whether the move doesn't leave the king of the given color in check
+    bool is_move_legal(Move move, Color color) const;
+
+    // compute the zobrist key from scratch. this is only needed when setting up
+    // a new position, since the key is otherwise updated incrementally
+    [[nodiscard]] constexpr uint64_t compute_key() const {
+        uint64_t k = 0ULL;
+
+        for (int col = 0; col < 2; col++) {
+            for (int pt = 0; pt < 6; pt++) {
+                uint64_t bb = pieces[col][pt];
+
+                while (bb) {
+                    k ^= ZOBRIST.pieces[col][pt][std::countr_zero(bb)];
+                    bb &= bb - 1;
+                }
+            }
+        }
+
+        k ^= ZOBRIST.castling[castling_rights];
+
+        if (en_passant_sq != 64) k ^= ZOBRIST.en_passant[en_passant_sq & 7];
+        if (color == COL_BLACK)  k ^= ZOBRIST.side;
+
+        return k;
+    }
 
     void print() const;
 
+    // the first four FEN fields (placement, color, castling, en passant). the
+    // move clocks aren't a part of the board, so they must be appended separately
+    [[nodiscard]] std::string to_fen() const;
+
     [[nodiscard]] Board clone() const {
         return *this;
     }
@@ -84,6 +184,8 @@ public:
         board.en_passant_sq                = 64;
         board.castling_rights              = CR_ALL;
         board.color                        = COL_WHITE;
+        board.halfmove_clock               = 0;
+        board.key                          = board.compute_key();
 
         return board;
     }
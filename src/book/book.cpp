@@ -0,0 +1,231 @@
+#include <format>
+
+#include "book.h"
+
+#include "polyglot_random.h"
+#include "src/bitboard.h"
+#include "src/uci.h"
+#include "src/global/consts.h"
+#include "src/movegen/movegen.h"
+
+namespace Kreveta {
+
+// our squares start from a8, while polyglot starts from a1,
+// so flipping the rank converts between the two (both ways)
+static constexpr uint8_t flip_rank(const uint8_t sq) {
+    return sq ^ 56;
+}
+
+PolyglotEntry PolyglotEntry::read(const unsigned char *data) {
+    const auto be = [&](const int offset, const int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++)
+            value = value << 8 | data[offset + i];
+        return value;
+    };
+
+    return {
+        .key    = be(0, 8),
+        .move   = static_cast<uint16_t>(be(8, 2)),
+        .weight = static_cast<uint16_t>(be(10, 2)),
+        .learn  = static_cast<uint32_t>(be(12, 4))
+    };
+}
+
+void PolyglotEntry::write(unsigned char *data) const {
+    const auto be = [&](const int offset, const int bytes, const uint64_t value) {
+        for (int i = 0; i < bytes; i++)
+            data[offset + i] = static_cast<unsigned char>(value >> (bytes - 1 - i) * 8);
+    };
+
+    be(0,  8, key);
+    be(8,  2, move);
+    be(10, 2, weight);
+    be(12, 4, learn);
+}
+
+bool Book::open(const std::string &path) {
+    if (!file.open(path)) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    if (file.size() % PolyglotEntry::SIZE) {
+        UCI::log(std::format("'{}' is not a polyglot book", path));
+        file.close();
+        return false;
+    }
+
+    return true;
+}
+
+void Book::close() {
+    file.close();
+}
+
+PolyglotEntry Book::entry(const std::size_t index) const {
+    return PolyglotEntry::read(file.data() + index * PolyglotEntry::SIZE);
+}
+
+bool Book::probe(const Board &board, Move &move) {
+    if (!is_open())
+        return false;
+
+    const uint64_t target = key(board);
+
+    // find the first entry of the position
+    std::size_t low  = 0;
+    std::size_t high = size();
+
+    while (low < high) {
+        const std::size_t mid = low + (high - low) / 2;
+
+        if (entry(mid).key < target)
+            low = mid + 1;
+        else high = mid;
+    }
+
+    Move     moves[MAX_MOVES];
+    uint16_t weights[MAX_MOVES];
+
+    int      count = 0;
+    uint32_t total = 0;
+
+    // the book may have been built for a different position with the same key,
+    // so moves that are illegal here are skipped. a position can't have more
+    // legal moves than MAX_MOVES, so neither can it have more book moves
+    for (std::size_t i = low; i < size() && count < MAX_MOVES; i++) {
+        const PolyglotEntry e = entry(i);
+        if (e.key != target)
+            break;
+
+        const Move m = decode_move(e.move, board);
+        if (m == Move())
+            continue;
+
+        moves[count]     = m;
+        weights[count++] = e.weight;
+        total           += e.weight;
+    }
+
+    if (count == 0)
+        return false;
+
+    // some books only store the moves and leave all weights at zero,
+    // in which case all moves are considered to be equally good
+    if (total == 0) {
+        move = moves[std::uniform_int_distribution(0, count - 1)(rng)];
+        return true;
+    }
+
+    uint32_t pick = std::uniform_int_distribution<uint32_t>(0, total - 1)(rng);
+    for (int i = 0; i < count; i++) {
+        if (pick < weights[i]) {
+            move = moves[i];
+            return true;
+        }
+
+        pick -= weights[i];
+    }
+
+    return false;
+}
+
+uint64_t Book::key(const Board &board) {
+    uint64_t k = 0ULL;
+
+    // polyglot orders the pieces as black pawn, white pawn, black knight, ...
+    for (int col = 0; col < 2; col++) {
+        for (int pt = 0; pt < 6; pt++) {
+            uint64_t bb = board.pieces[col][pt];
+            const int kind = pt * 2 + (col == COL_WHITE);
+
+            while (bb) k ^= POLYGLOT_RANDOM[POLYGLOT_PIECES + kind * 64 + flip_rank(ls1b_reset(bb))];
+        }
+    }
+
+    if (board.has_castling_right(CR_W_KINGSIDE))  k ^= POLYGLOT_RANDOM[POLYGLOT_CASTLING];
+    if (board.has_castling_right(CR_W_QUEENSIDE)) k ^= POLYGLOT_RANDOM[POLYGLOT_CASTLING + 1];
+    if (board.has_castling_right(CR_B_KINGSIDE))  k ^= POLYGLOT_RANDOM[POLYGLOT_CASTLING + 2];
+    if (board.has_castling_right(CR_B_QUEENSIDE)) k ^= POLYGLOT_RANDOM[POLYGLOT_CASTLING + 3];
+
+    // unlike our own key, the en passant file is only hashed when a pawn of the
+    // side to move stands right next to the pawn that has just double pushed
+    if (board.en_passant_sq != 64) {
+        const uint8_t file   = board.en_passant_sq & 7;
+        const uint8_t pushed = board.color == COL_WHITE
+            ? board.en_passant_sq + 8
+            : board.en_passant_sq - 8;
+
+        uint64_t adjacent = 0ULL;
+        if (file > 0) adjacent |= 1ULL << (pushed - 1);
+        if (file < 7) adjacent |= 1ULL << (pushed + 1);
+
+        if (board.pieces[board.color][PT_PAWN] & adjacent)
+            k ^= POLYGLOT_RANDOM[POLYGLOT_EN_PASSANT + file];
+    }
+
+    if (board.color == COL_WHITE)
+        k ^= POLYGLOT_RANDOM[POLYGLOT_TURN];
+
+    return k;
+}
+
+Move Book::decode_move(const uint16_t move, const Board &board) {
+    const uint8_t start = flip_rank(move >> 6 & 63);
+    uint8_t       end   = flip_rank(move      & 63);
+    const int     prom  = move >> 12 & 7;
+
+    // castling is stored as the king moving to its own rook,
+    // so we move the target square to where the king lands
+    const uint64_t own = board.color == COL_WHITE ? board.w_occupied : board.b_occupied;
+    if (is_bit_set(board.pieces[board.color][PT_KING], start) && is_bit_set(board.pieces[board.color][PT_ROOK] & own, end))
+        end = end > start ? start + 2 : start - 2;
+
+    char str[5];
+    str[0] = FILES[start & 7];
+    str[1] = static_cast<char>('8' - (start >> 3));
+    str[2] = FILES[end & 7];
+    str[3] = static_cast<char>('8' - (end >> 3));
+
+    if (prom > 4)
+        return {};
+
+    // the knight to queen promotions have the same order as our piece types
+    if (prom) str[4] = PIECES[prom];
+
+    const std::string_view lan{str, prom ? 5u : 4u};
+    if (!Move::is_valid_format(lan))
+        return {};
+
+    const Move m = Move::str_to_move(lan, board);
+
+    // the string is only converted using the pieces on the squares, so it
+    // must still be compared to the actual legal moves in the position
+    Move legal[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, legal);
+
+    for (int i = 0; i < count; i++) {
+        if (legal[i] == m)
+            return m;
+    }
+
+    return {};
+}
+
+uint16_t Book::encode_move(const Move move) {
+    const uint8_t start = move.start();
+    uint8_t       end   = move.end();
+
+    // the king lands on the g or c file when castling, but the rook stands on h or a
+    if (move.promotion() == PT_KING)
+        end = end > start ? end + 1 : end - 2;
+
+    const int prom = move.is_promotion()
+        ? move.promotion()
+        : 0;
+
+    return static_cast<uint16_t>(prom << 12 | flip_rank(start) << 6 | flip_rank(end));
+}
+
+}
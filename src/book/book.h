@@ -0,0 +1,70 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "src/board.h"
+#include "src/io/mapped_file.h"
+#include "src/movegen/move.h"
+
+namespace Kreveta {
+
+// a single entry of a polyglot book. all numbers are stored as big-endian in the
+// file, and the entries are sorted by the key, so all moves of a position are
+// next to each other. the move is packed into 16 bits:
+//
+//   | promotion | from rank | from file | to rank | to file
+//   | 0 0 0     | 0 0 0     | 0 0 0     | 0 0 0   | 0 0 0
+//
+// the ranks start from the first one, promotions are numbered from one (knight)
+// to four (queen) and castling is stored as the king capturing its own rook
+struct PolyglotEntry {
+    uint64_t key    = 0;
+    uint16_t move   = 0;
+    uint16_t weight = 0;
+    uint32_t learn  = 0;
+
+    static constexpr std::size_t SIZE = 16;
+
+    [[nodiscard]] static PolyglotEntry read(const unsigned char *data);
+    void write(unsigned char *data) const;
+};
+
+// polyglot opening book. the file is mapped into memory and never read as
+// a whole, the position is found by a binary search over the sorted entries
+class Book {
+public:
+    bool open(const std::string &path);
+    void close();
+
+    [[nodiscard]] bool is_open() const { return file.is_open(); }
+
+    // number of entries in the book
+    [[nodiscard]] std::size_t size() const { return file.size() / PolyglotEntry::SIZE; }
+
+    // pick a random book move for the position, with the better moves (the
+    // ones with a higher weight) being picked more often. returns false if
+    // the position isn't in the book, or none of its moves are legal here
+    bool probe(const Board &board, Move &move);
+
+    // the key of the position as used by polyglot books, which is different
+    // from our own zobrist key (see polyglot_random.h)
+    [[nodiscard]] static uint64_t key(const Board &board);
+
+    // conversion between our moves and the polyglot move format. a move that
+    // is illegal in the position is converted to a null move
+    [[nodiscard]] static Move     decode_move(uint16_t move, const Board &board);
+    [[nodiscard]] static uint16_t encode_move(Move move);
+
+private:
+    MappedFile      file;
+    std::mt19937_64 rng{std::random_device{}()};
+
+    [[nodiscard]] PolyglotEntry entry(std::size_t index) const;
+};
+
+}
+
+#endif //BOOK_H
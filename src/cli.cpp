@@ -0,0 +1,580 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cli.h"
+
+#include "position.h"
+#include "uci.h"
+#include "utils.h"
+#include "daemon/daemon.h"
+#include "datagen/datagen.h"
+#include "eval/nnue.h"
+#include "search/bench.h"
+#include "search/search.h"
+#include "threads/thread_pool.h"
+#include "threads/work_stealing_queue.h"
+#include "io/packed_position.h"
+
+namespace Kreveta {
+
+int CLI::run(const std::span<const std::string_view> args) {
+    const auto cmd = args[0];
+
+    if (cmd == "evalbatch") {
+        return cmd_evalbatch(args);
+    }
+
+    if (cmd == "pack") {
+        return cmd_pack(args);
+    }
+
+    if (cmd == "unpack") {
+        return cmd_unpack(args);
+    }
+
+    if (cmd == "datagen") {
+        return cmd_datagen(args);
+    }
+
+    if (cmd == "bench") {
+        return Bench::run(args) ? 0 : 1;
+    }
+
+    if (cmd == "analyze") {
+        return cmd_analyze(args);
+    }
+
+    if (cmd == "daemon") {
+        return cmd_daemon(args);
+    }
+
+    UCI::log(std::format("Unknown command line argument '{}'", cmd));
+    return 1;
+}
+
+// evalbatch <input> <output> [threads]. every line of the input must start with a
+// FEN or EPD position. the output has the same lines with the evaluation of the
+// side to move appended as an EPD "ce" (centipawn evaluation) operation, which
+// keeps any labels already present in the input line
+int CLI::cmd_evalbatch(const std::span<const std::string_view> args) {
+    if (args.size() < 3) {
+        UCI::log("Usage: evalbatch <input> <output> [threads]");
+        return 1;
+    }
+
+    int threads = 0;
+    if (args.size() > 3 && !try_parse(args[3], threads)) {
+        UCI::log(std::format("Invalid thread count '{}'", args[3]));
+        return 1;
+    }
+
+    std::ifstream input{std::string(args[1])};
+    std::ofstream output{std::string(args[2])};
+
+    if (!input || !output) {
+        UCI::log("Unable to open the input or output file");
+        return 1;
+    }
+
+    // the file is processed in chunks, so even huge files don't have to fit in memory
+    constexpr std::size_t CHUNK_SIZE = 1 << 18;
+
+    std::vector<std::string> lines;
+    std::vector<Board>       boards;
+    std::vector<int16_t>     scores;
+
+    lines.reserve(CHUNK_SIZE);
+    boards.reserve(CHUNK_SIZE);
+
+    uint64_t evaluated = 0;
+    uint64_t skipped   = 0;
+
+    // the same threads evaluate all chunks
+    ThreadPool pool(threads);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::string line;
+    bool eof = false;
+
+    while (!eof) {
+        lines.clear();
+        boards.clear();
+
+        while (lines.size() < CHUNK_SIZE) {
+            if (!std::getline(input, line)) {
+                eof = true;
+                break;
+            }
+
+            if (is_str_blank(line))
+                continue;
+
+            const auto tokens = str_split(line);
+
+            if (Board board; Position::try_parse_fen(tokens, board) && board.has_valid_material()) {
+                boards.push_back(board);
+                lines.push_back(std::move(line));
+            }
+            else skipped++;
+        }
+
+        scores.resize(boards.size());
+        NNUE::evaluate_batch(boards.data(), boards.size(), scores.data(), pool);
+
+        for (std::size_t i = 0; i < lines.size(); i++)
+            output << lines[i] << " ce " << scores[i] << ";\n";
+
+        evaluated += boards.size();
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    UCI::log(std::format("Evaluated {} positions ({} skipped) in {} ms",
+        format_uint64_t(evaluated), format_uint64_t(skipped), elapsed));
+
+    return 0;
+}
+
+// pack <input> <output>. converts a FEN/EPD file into packed positions. the move
+// clocks are taken from the FEN, the score from an EPD "ce" operation (relative
+// to the side to move, as written by evalbatch) and the result as described above
+int CLI::cmd_pack(const std::span<const std::string_view> args) {
+    if (args.size() < 3) {
+        UCI::log("Usage: pack <input> <output>");
+        return 1;
+    }
+
+    std::ifstream input{std::string(args[1])};
+    if (!input) {
+        UCI::log("Unable to open the input file");
+        return 1;
+    }
+
+    PackedWriter output;
+    if (!output.open(std::string(args[2])))
+        return 1;
+
+    uint64_t skipped = 0;
+
+    std::string line;
+    while (std::getline(input, line)) {
+        if (is_str_blank(line))
+            continue;
+
+        const auto tokens = str_split(line);
+
+        Board board;
+        if (!Position::try_parse_fen(tokens, board) || !board.has_valid_material()) {
+            skipped++;
+            continue;
+        }
+
+        // the move clocks are optional
+        int halfmove = 0, fullmove = 1;
+        if (tokens.size() > 5 && try_parse(tokens[4], halfmove)) {
+            (void)try_parse(tokens[5], fullmove);
+        }
+
+        int        score  = 0;
+        GameResult result = RESULT_UNKNOWN;
+
+        for (std::size_t i = 4; i < tokens.size(); i++) {
+            if (tokens[i] == "ce" && i + 1 < tokens.size()) {
+                auto value = tokens[i + 1];
+                if (value.ends_with(';'))
+                    value.remove_suffix(1);
+
+                if (try_parse(value, score) && board.color == COL_BLACK)
+                    score = -score;
+            }
+
+            if (result == RESULT_UNKNOWN)
+                result = parse_game_result(tokens[i]);
+        }
+
+        output.write(PackedPosition::pack(board,
+            static_cast<int16_t>(std::clamp(score, -32000, 32000)),
+            result,
+            static_cast<uint8_t>(std::clamp(halfmove, 0, 255)),
+            static_cast<uint16_t>(std::clamp(fullmove, 1, 65535))));
+    }
+
+    const bool ok = output.flush();
+
+    UCI::log(std::format("Packed {} positions ({} skipped)",
+        format_uint64_t(output.size()), format_uint64_t(skipped)));
+
+    return ok ? 0 : 1;
+}
+
+// unpack <input> <output>. converts packed positions back into EPD
+int CLI::cmd_unpack(const std::span<const std::string_view> args) {
+    if (args.size() < 3) {
+        UCI::log("Usage: unpack <input> <output>");
+        return 1;
+    }
+
+    PackedReader reader;
+    if (!reader.open(std::string(args[1])))
+        return 1;
+
+    std::ofstream output{std::string(args[2])};
+    if (!output) {
+        UCI::log("Unable to open the output file");
+        return 1;
+    }
+
+    constexpr std::string_view RESULTS[3] = { "0-1", "1/2-1/2", "1-0" };
+
+    std::size_t invalid = 0;
+
+    for (const PackedPosition &packed : reader) {
+        if (!packed.is_valid()) {
+            invalid++;
+            continue;
+        }
+
+        const Board board = packed.to_board();
+
+        const int score = board.color == COL_WHITE
+            ? packed.score
+            : -packed.score;
+
+        output << board.to_fen() << ' ' << +packed.halfmove << ' ' << packed.fullmove
+               << " ce " << score << ';';
+
+        if (packed.result() != RESULT_UNKNOWN)
+            output << " c9 \"" << RESULTS[packed.result()] << "\";";
+
+        output << '\n';
+    }
+
+    UCI::log(std::format("Unpacked {} positions, skipped {} invalid",
+        format_uint64_t(reader.size() - invalid), format_uint64_t(invalid)));
+    return output ? 0 : 1;
+}
+
+// datagen <output> [threads] [nodes] [games]. plays games against itself and
+// appends the quiet positions along with their scores and the game results to
+// the output as packed positions
+int CLI::cmd_datagen(const std::span<const std::string_view> args) {
+    if (args.size() < 2) {
+        UCI::log("Usage: datagen <output> [threads] [nodes] [games]");
+        return 1;
+    }
+
+    DatagenSettings settings;
+    settings.output = std::string(args[1]);
+
+    int threads = 0, nodes = 5000, games = 1000;
+
+    if ((args.size() > 2 && !try_parse(args[2], threads))
+     || (args.size() > 3 && !try_parse(args[3], nodes))
+     || (args.size() > 4 && !try_parse(args[4], games))
+     || threads < 0 || nodes < 1 || games < 1) {
+        UCI::log("Invalid datagen arguments");
+        return 1;
+    }
+
+    settings.threads = threads;
+    settings.nodes   = static_cast<uint64_t>(nodes);
+    settings.games   = static_cast<uint64_t>(games);
+
+    return Datagen::run(settings) ? 0 : 1;
+}
+
+// the moves of an EPD operation (e.g. "bm Nf3 Nc3;") in SAN. the
+// moves which aren't legal in the position are left out
+static std::vector<Move> parse_epd_moves(const std::vector<std::string_view> &tokens, const std::string_view opcode, const Board &board) {
+    std::vector<Move> moves;
+
+    for (std::size_t i = 4; i < tokens.size(); i++) {
+        if (tokens[i] != opcode)
+            continue;
+
+        for (std::size_t j = i + 1; j < tokens.size(); j++) {
+            auto san = tokens[j];
+
+            const bool last = san.ends_with(';');
+            if (last) san.remove_suffix(1);
+
+            if (const Move move = Move::san_to_move(san, board); move != Move())
+                moves.push_back(move);
+
+            if (last) break;
+        }
+    }
+
+    return moves;
+}
+
+// analyze --epd <file> [--output <file>] [--threads N] [--depth D | --movetime MS] [--hash MB].
+// every position is searched by a single thread, and the threads search different
+// positions at once, which scales much better than searching one position with all
+// of them. the input lines are written again with the results appended as EPD
+// operations: "acd" (depth), "acn" (nodes), "ce" (score) and "pm" (the best move)
+int CLI::cmd_analyze(const std::span<const std::string_view> args) {
+    std::string input_path;
+    std::string output_path;
+
+    int threads  = 0;
+    int depth    = 0;
+    int movetime = 0;
+    int hash     = 16;
+
+    for (std::size_t i = 1; i < args.size(); i++) {
+        if (i + 1 >= args.size()) {
+            UCI::log(std::format("Missing value of '{}'", args[i]));
+            return 1;
+        }
+
+        const auto name  = args[i];
+        const auto value = args[++i];
+
+        bool valid = true;
+
+        if      (name == "--epd")      input_path  = value;
+        else if (name == "--output")   output_path = value;
+        else if (name == "--threads")  valid = try_parse(value, threads)  && threads  >= 0;
+        else if (name == "--depth")    valid = try_parse(value, depth)    && depth    >= 1 && depth < MAX_PLY;
+        else if (name == "--movetime") valid = try_parse(value, movetime) && movetime >= 1;
+        else if (name == "--hash")     valid = try_parse(value, hash)     && hash     >= 1;
+        else valid = false;
+
+        if (!valid) {
+            UCI::log(std::format("Invalid argument '{} {}'", name, value));
+            return 1;
+        }
+    }
+
+    if (input_path.empty()) {
+        UCI::log("Usage: analyze --epd <file> [--output <file>] [--threads N] [--depth D | --movetime MS] [--hash MB]");
+        return 1;
+    }
+
+    std::ifstream input(input_path);
+    if (!input) {
+        UCI::log(std::format("Unable to open '{}'", input_path));
+        return 1;
+    }
+
+    // without an output file, the results are printed
+    std::ofstream output;
+    if (!output_path.empty()) {
+        output.open(output_path);
+
+        if (!output) {
+            UCI::log(std::format("Unable to open '{}'", output_path));
+            return 1;
+        }
+    }
+
+    SearchLimits limits;
+    limits.depth    = depth ? depth : (movetime ? MAX_PLY : 10);
+    limits.movetime = movetime;
+
+    ThreadPool pool(threads);
+
+    // every thread has its own table, so the searches don't affect each other
+    std::vector<std::unique_ptr<TranspositionTable>> tables;
+    std::vector<std::unique_ptr<Searcher>>           searchers;
+
+    for (int i = 0; i < pool.size(); i++) {
+        tables.push_back(std::make_unique<TranspositionTable>(hash));
+        searchers.push_back(std::make_unique<Searcher>(*tables.back()));
+        searchers.back()->silent = true;
+    }
+
+    struct Task {
+        std::string  line;
+        Board        board;
+        SearchResult result;
+        bool         done = false;
+
+        // the moves of the "bm" and "am" operations
+        std::vector<Move> best_moves;
+        std::vector<Move> avoid_moves;
+    };
+
+    // the file is streamed, so even huge files don't have to fit in memory. the
+    // reader stays at most this many positions ahead of the oldest unwritten one
+    const std::size_t WINDOW_SIZE = static_cast<std::size_t>(pool.size()) * 64;
+
+    // the positions in the order of the input. the searches finish in any order,
+    // but only the finished ones at the front are written, so the order is kept
+    std::deque<std::unique_ptr<Task>> window;
+
+    WorkStealingQueue<Task *> queue(pool.size());
+
+    std::mutex              mutex;
+    std::condition_variable task_ready;
+    std::condition_variable window_free;
+
+    // the tasks in the queues, which haven't been taken by any thread yet
+    std::size_t available = 0;
+    bool        eof       = false;
+
+    uint64_t analyzed = 0;
+    uint64_t skipped  = 0;
+    uint64_t nodes    = 0;
+    uint64_t tests    = 0;
+    uint64_t solved   = 0;
+
+    // write the finished tasks from the front of the window (under the mutex)
+    const auto flush = [&] {
+        while (!window.empty() && window.front()->done) {
+            const Task &task = *window.front();
+
+            const std::string result = std::format("{} acd {}; acn {}; ce {}; pm {};", task.line, task.result.depth,
+                task.result.nodes, task.result.score, Move::to_str(task.result.best));
+
+            if (output.is_open()) output << result << '\n';
+            else                  UCI::log(result);
+
+            nodes += task.result.nodes;
+            analyzed++;
+
+            // the best move must be one of "bm", and mustn't be any of "am"
+            if (!task.best_moves.empty() || !task.avoid_moves.empty()) {
+                const Move best = task.result.best;
+                tests++;
+
+                if ((task.best_moves.empty() || std::ranges::find(task.best_moves, best) != task.best_moves.end())
+                    && std::ranges::find(task.avoid_moves, best) == task.avoid_moves.end())
+                    solved++;
+            }
+
+            window.pop_front();
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // the positions are read while the others are being searched, so the threads
+    // never wait for each other. they are dealt out like cards, and the threads
+    // finishing early steal the rest from the others
+    std::thread reader([&] {
+        std::string line;
+        int next_queue = 0;
+
+        while (std::getline(input, line)) {
+            if (is_str_blank(line))
+                continue;
+
+            const auto tokens = str_split(line);
+
+            Board board;
+            if (!Position::try_parse_fen(tokens, board) || !board.has_valid_material()) {
+                skipped++;
+                continue;
+            }
+
+            auto task = std::make_unique<Task>();
+            task->board       = board;
+            task->best_moves  = parse_epd_moves(tokens, "bm", board);
+            task->avoid_moves = parse_epd_moves(tokens, "am", board);
+            task->line        = std::move(line);
+
+            Task *queued = task.get();
+
+            std::unique_lock lock(mutex);
+            window_free.wait(lock, [&] { return window.size() < WINDOW_SIZE; });
+
+            window.push_back(std::move(task));
+            queue.push(next_queue++ % pool.size(), queued);
+            available++;
+
+            task_ready.notify_one();
+        }
+
+        std::lock_guard lock(mutex);
+        eof = true;
+        task_ready.notify_all();
+    });
+
+    pool.run([&](const int thread) {
+        Searcher &searcher = *searchers[thread];
+
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                task_ready.wait(lock, [&] { return available > 0 || eof; });
+
+                if (available == 0)
+                    break;
+
+                available--;
+            }
+
+            // a task has been reserved above, so one of the queues must have it
+            Task *task = nullptr;
+            queue.pop(thread, task);
+
+            tables[thread]->clear();
+            searcher.clear();
+            searcher.reset_stop();
+
+            task->result = searcher.search(task->board, {}, limits);
+
+            std::lock_guard lock(mutex);
+            task->done = true;
+
+            flush();
+            window_free.notify_one();
+        }
+    });
+
+    reader.join();
+
+    const auto elapsed = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count(), 1);
+
+    UCI::log(std::format("Analyzed {} positions ({} skipped) in {} ms, {} nodes ({} nps)",
+        format_uint64_t(analyzed), format_uint64_t(skipped), elapsed, format_uint64_t(nodes),
+        format_uint64_t(nodes * 1000 / elapsed)));
+
+    if (tests) {
+        UCI::log(std::format("Solved {} of {} bm/am positions ({}%)",
+            solved, tests, solved * 100 / tests));
+    }
+
+    return 0;
+}
+
+// daemon <socket> [threads] [hash]. the daemon runs until it's interrupted
+int CLI::cmd_daemon(const std::span<const std::string_view> args) {
+    if (args.size() < 2) {
+        UCI::log("Usage: daemon <socket> [threads] [hash]");
+        return 1;
+    }
+
+    DaemonSettings settings;
+    settings.socket = std::string(args[1]);
+
+    int threads = 0, hash = 256;
+
+    if ((args.size() > 2 && !try_parse(args[2], threads))
+     || (args.size() > 3 && !try_parse(args[3], hash))
+     || threads < 0 || hash < 1) {
+        UCI::log("Invalid daemon arguments");
+        return 1;
+    }
+
+    settings.threads = threads;
+    settings.hash    = static_cast<std::size_t>(hash);
+
+    return Daemon::run(settings) ? 0 : 1;
+}
+
+}
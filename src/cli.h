@@ -0,0 +1,29 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <span>
+#include <string_view>
+
+namespace Kreveta {
+
+// offline tools, which are run directly from the command line
+// (e.g. "Kreveta_2 evalbatch positions.epd scores.epd") instead
+// of going through the UCI loop
+class CLI {
+public:
+
+    // returns the exit code of the program
+    static int run(std::span<const std::string_view> args);
+
+private:
+    static int cmd_evalbatch(std::span<const std::string_view> args);
+    static int cmd_pack(std::span<const std::string_view> args);
+    static int cmd_unpack(std::span<const std::string_view> args);
+    static int cmd_datagen(std::span<const std::string_view> args);
+    static int cmd_analyze(std::span<const std::string_view> args);
+    static int cmd_daemon(std::span<const std::string_view> args);
+};
+
+}
+
+#endif //CLI_H
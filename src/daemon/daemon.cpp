@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <format>
+#include <span>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "daemon.h"
+
+#include "src/position.h"
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/movegen/movegen.h"
+
+namespace Kreveta {
+
+std::unique_ptr<TranspositionTable> Daemon::tt;
+std::mutex                          Daemon::mutex;
+std::condition_variable             Daemon::job_ready;
+std::deque<Daemon::Job>             Daemon::jobs;
+std::list<Daemon::Connection>       Daemon::connections;
+int                                 Daemon::running = 0;
+std::chrono::steady_clock::time_point Daemon::aged;
+std::atomic<bool>                   Daemon::stopping = false;
+std::atomic<int>                    Daemon::wake_fd  = -1;
+int                                 Daemon::wake_read = -1;
+
+// a single connected client. everything except the socket and the position
+// is guarded by the daemon's mutex, since the search threads use it too
+struct Daemon::Session {
+    explicit Session(const int fd) : fd(fd) {}
+
+    const int  fd;
+    std::mutex write_mutex;
+
+    Board                 board = Board::make_startpos();
+    std::vector<uint64_t> history;
+
+    // the search is either waiting in the queue or taken by a search thread.
+    // a taken search may still have no searcher, when it's answered by the table
+    bool      searching = false;
+    bool      dequeued  = false;
+    Searcher *searcher  = nullptr;
+
+    std::condition_variable finished;
+
+    void send(const std::string &line);
+};
+
+#ifdef _WIN32
+
+bool Daemon::run(const DaemonSettings &) {
+    UCI::log("The daemon is only supported on unix systems");
+    return false;
+}
+
+void Daemon::stop() {}
+
+#else
+
+void Daemon::Session::send(const std::string &line) {
+    const std::string data = line + '\n';
+    std::lock_guard lock(write_mutex);
+
+    // a disconnected client is noticed by the reading thread, so errors are ignored here
+    for (std::size_t sent = 0; sent < data.size();) {
+        const ssize_t count = write(fd, data.data() + sent, data.size() - sent);
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        if (count <= 0)
+            return;
+
+        sent += static_cast<std::size_t>(count);
+    }
+}
+
+bool Daemon::run(const DaemonSettings &settings) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (settings.socket.empty() || settings.socket.size() >= sizeof(address.sun_path)) {
+        UCI::log(std::format("Invalid socket path '{}'", settings.socket));
+        return false;
+    }
+
+    std::ranges::copy(settings.socket, address.sun_path);
+
+    const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        UCI::log("Unable to create the socket");
+        return false;
+    }
+
+    // a socket left behind by a previous daemon would make bind fail
+    unlink(settings.socket.c_str());
+
+    if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(server, 64) != 0) {
+        UCI::log(std::format("Unable to listen on '{}'", settings.socket));
+        close(server);
+        return false;
+    }
+
+    if (wake_fd < 0) {
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0) {
+            UCI::log("Unable to create the wake-up pipe");
+            close(server);
+            unlink(settings.socket.c_str());
+            return false;
+        }
+
+        // stop may be called from a signal handler, which mustn't block
+        fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(pipe_fds[1], F_SETFL, O_NONBLOCK);
+
+        wake_read = pipe_fds[0];
+        wake_fd   = pipe_fds[1];
+    }
+
+    // writing to a disconnected client mustn't kill the whole daemon
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const auto old_sigint  = std::signal(SIGINT,  [](int) { stop(); });
+    const auto old_sigterm = std::signal(SIGTERM, [](int) { stop(); });
+
+    tt = std::make_unique<TranspositionTable>(settings.hash);
+
+    const int threads = settings.threads > 0
+        ? settings.threads
+        : std::max<int>(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(search_worker, i);
+
+    UCI::log(std::format("Listening on '{}' with {} search threads and {} MB hash",
+        settings.socket, threads, tt->size_mb()));
+
+    const bool stopped = accept_loop(server);
+
+    // closing the sessions stops their searches and takes their jobs out of the
+    // queue, so the search threads only have to be woken up to see they should exit
+    close_connections();
+
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    job_ready.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+
+    std::signal(SIGINT,  old_sigint);
+    std::signal(SIGTERM, old_sigterm);
+
+    close(server);
+    unlink(settings.socket.c_str());
+
+    tt.reset();
+    stopping = false;
+
+    return stopped;
+}
+
+void Daemon::stop() {
+    stopping = true;
+
+    // only async-signal-safe calls from here on
+    if (const int fd = wake_fd; fd >= 0) {
+        const char byte = 0;
+        (void)!write(fd, &byte, 1);
+    }
+}
+
+// every session is read by its own thread, which only waits for commands,
+// so the number of sessions isn't limited by the number of search threads
+bool Daemon::accept_loop(const int server) {
+    pollfd fds[2] = {
+        { .fd = server,    .events = POLLIN, .revents = 0 },
+        { .fd = wake_read, .events = POLLIN, .revents = 0 }
+    };
+
+    // the wake-ups left over from a previous run are drained first. a stop
+    // called before this one is still noticed, since it sets the flag first
+    const auto drain = [] {
+        char bytes[64];
+        while (read(wake_read, bytes, sizeof(bytes)) > 0) {}
+    };
+
+    drain();
+
+    while (!stopping) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+
+            UCI::log("Unable to wait for connections");
+            return false;
+        }
+
+        if (fds[1].revents) {
+            drain();
+            continue;
+        }
+
+        if (!(fds[0].revents & POLLIN))
+            continue;
+
+        const int fd = accept(server, nullptr, nullptr);
+
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            UCI::log("Unable to accept a connection");
+            return false;
+        }
+
+        std::lock_guard lock(mutex);
+
+        // the threads of closed sessions are joined here, so they don't pile up
+        std::erase_if(connections, [](Connection &connection) {
+            if (connection.done)
+                connection.thread.join();
+
+            return connection.done;
+        });
+
+        Connection &connection = connections.emplace_back(fd);
+        connection.thread = std::thread(serve, std::ref(connection));
+    }
+
+    return true;
+}
+
+void Daemon::close_connections() {
+    {
+        std::lock_guard lock(mutex);
+
+        // the reading threads notice the shut down sockets and close their sessions.
+        // the sockets of closed sessions are already closed, and their numbers reused
+        for (const Connection &connection : connections) {
+            if (!connection.done)
+                shutdown(connection.fd, SHUT_RDWR);
+        }
+    }
+
+    // nothing else modifies the list once the accepting thread is done
+    for (Connection &connection : connections)
+        connection.thread.join();
+
+    connections.clear();
+}
+
+void Daemon::search_worker(int) {
+
+    // the table is shared by all searches, so it's aged by the
+    // daemon whenever a search leaves the queue, not by the searchers
+    const auto searcher = std::make_unique<Searcher>(*tt);
+    searcher->silent = true;
+    searcher->age_tt = false;
+
+    while (true) {
+        std::unique_lock lock(mutex);
+        job_ready.wait(lock, [] { return !jobs.empty() || stopping; });
+
+        // the sessions are closed before the search threads are stopped, so no job is left
+        if (jobs.empty())
+            return;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+
+        // guarded by the mutex, so the age is increased by one thread at a time.
+        // aging on every job would make the entries of all running searches old
+        if (const auto now = std::chrono::steady_clock::now(); running == 0 || now - aged >= AGE_INTERVAL) {
+            tt->new_search();
+            aged = now;
+        }
+
+        running++;
+
+        Session &session = *job.session;
+        session.dequeued = true;
+
+        const bool expired = !spend_queue_time(job);
+
+        if (!expired) {
+            searcher->reset_stop();
+            session.searcher = searcher.get();
+        }
+
+        lock.unlock();
+
+        if (expired) {
+            session.send(std::format("bestmove {}", Move::to_str(quick_move(job.board))));
+        }
+        else {
+            const SearchResult result = searcher->search(job.board, job.history, job.limits);
+
+            session.send(std::format("info depth {} score {} nodes {}",
+                result.depth, Searcher::score_to_str(result.score), result.nodes));
+            session.send(std::format("bestmove {}", Move::to_str(result.best)));
+        }
+
+        lock.lock();
+
+        running--;
+
+        session.searcher  = nullptr;
+        session.dequeued  = false;
+        session.searching = false;
+        session.finished.notify_all();
+    }
+}
+
+bool Daemon::spend_queue_time(Job &job) {
+    SearchLimits &limits = job.limits;
+
+    if (limits.infinite)
+        return true;
+
+    const int64_t waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - job.received).count();
+
+    if (limits.movetime) {
+        if (limits.movetime <= waited)
+            return false;
+
+        limits.movetime -= waited;
+        return true;
+    }
+
+    int64_t &time = limits.time[job.board.color];
+    if (time) {
+        if (time <= waited)
+            return false;
+
+        time -= waited;
+    }
+
+    return true;
+}
+
+void Daemon::serve(Connection &connection) {
+    const int  fd      = connection.fd;
+    const auto session = std::make_shared<Session>(fd);
+
+    char        buffer[4096];
+    std::string pending;
+
+    std::vector<std::string_view> tokens;
+    bool quit = false;
+
+    while (!quit) {
+        const ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+            continue;
+
+        if (count <= 0)
+            break;
+
+        pending.append(buffer, static_cast<std::size_t>(count));
+
+        std::size_t newline;
+        while (!quit && (newline = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+
+            str_split(line, tokens);
+
+            if (tokens.empty())
+                continue;
+
+            if (tokens[0] == "quit") quit = true;
+            else handle_command(session, tokens);
+        }
+    }
+
+    // the search threads may still be writing into the socket
+    cmd_stop(*session);
+
+    // the socket is closed under the lock, so stop never shuts down a reused number
+    std::lock_guard lock(mutex);
+
+    close(fd);
+    connection.done = true;
+}
+
+void Daemon::handle_command(const std::shared_ptr<Session> &session, const std::vector<std::string_view> &tokens) {
+    const auto cmd = tokens[0];
+
+    if (cmd == "uci") {
+        session->send(std::format("id name {}-{}\nid author {}\nuciok",
+            UCI::ENGINE_NAME, UCI::ENGINE_VERSION, UCI::ENGINE_AUTHOR));
+    }
+
+    else if (cmd == "isready") {
+        session->send("readyok");
+    }
+
+    // the table is shared with the other sessions, so it isn't cleared
+    else if (cmd == "ucinewgame") {
+        cmd_stop(*session);
+    }
+
+    else if (cmd == "position") {
+        cmd_position(*session, tokens);
+    }
+
+    else if (cmd == "go") {
+        cmd_go(session, tokens);
+    }
+
+    else if (cmd == "stop") {
+        cmd_stop(*session);
+    }
+
+    else if (cmd == "setoption") {
+        session->send("info string Options are set when starting the daemon");
+    }
+
+    else session->send(std::format("info string Unknown command '{}'", cmd));
+}
+
+// the position is only changed when the whole command is valid. the details
+// of invalid positions are written into the log of the daemon
+void Daemon::cmd_position(Session &session, const std::vector<std::string_view> &tokens) {
+    Board board;
+
+    if (tokens.size() >= 2 && tokens[1] == "startpos") {
+        board = Board::make_startpos();
+    }
+    else if (tokens.size() < 6 || tokens[1] != "fen" || !Position::try_parse_fen(std::span(tokens).subspan(2), board)) {
+        session.send("info string Invalid position");
+        return;
+    }
+
+    std::vector<uint64_t> history;
+    if (!Position::try_play_moves(tokens, board, history)) {
+        session.send("info string Invalid moves");
+        return;
+    }
+
+    session.board   = board;
+    session.history = std::move(history);
+}
+
+void Daemon::cmd_go(const std::shared_ptr<Session> &session, const std::vector<std::string_view> &tokens) {
+    const auto received = std::chrono::steady_clock::now();
+
+    // a new search can't start before the previous one is finished
+    cmd_stop(*session);
+
+    const SearchLimits limits = UCI::parse_limits(tokens);
+
+    std::lock_guard lock(mutex);
+
+    session->searching = true;
+
+    jobs.push_back({ session, session->board, session->history, limits, received });
+    job_ready.notify_one();
+}
+
+void Daemon::cmd_stop(Session &session) {
+    std::unique_lock lock(mutex);
+
+    if (!session.searching)
+        return;
+
+    // once a search thread took the job, the session must wait for its bestmove,
+    // even when there's no searcher to stop, because the job is answered by the table
+    if (session.dequeued) {
+        if (session.searcher)
+            session.searcher->stop();
+
+        session.finished.wait(lock, [&] { return !session.searching; });
+        return;
+    }
+
+    // the search is still waiting for a free thread, which might take long,
+    // so it's taken out of the queue and answered by the table instead
+    const auto job = std::ranges::find_if(jobs, [&](const Job &j) { return j.session.get() == &session; });
+    const Board board = job->board;
+
+    jobs.erase(job);
+    session.searching = false;
+
+    lock.unlock();
+
+    session.send(std::format("bestmove {}", Move::to_str(quick_move(board))));
+}
+
+Move Daemon::quick_move(const Board &board) {
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    if (count == 0)
+        return {};
+
+    TTData data;
+    if (tt->probe(board.key, data)) {
+        const Move move = Move::from_raw(data.move);
+
+        if (std::find(moves, moves + count, move) != moves + count)
+            return move;
+    }
+
+    return moves[0];
+}
+
+
+#endif
+
+}
@@ -0,0 +1,113 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "src/board.h"
+#include "src/search/search.h"
+#include "src/search/tt.h"
+
+namespace Kreveta {
+
+struct DaemonSettings {
+    std::string socket;
+
+    // zero threads means one thread per hardware core
+    int         threads = 0;
+    std::size_t hash    = 256;
+};
+
+// serves many UCI sessions from a single process over a unix domain socket. all sessions
+// share the move tables, the network and one large transposition table, so a new session
+// doesn't have to load or warm up anything. the searches of all sessions are run by a
+// fixed number of search threads, each of them searching one position at a time
+class Daemon {
+public:
+
+    // returns once the daemon is stopped, after all sessions are closed and all threads joined
+    static bool run(const DaemonSettings &settings);
+
+    // may be called from any thread or a signal handler, the daemon stops as soon as possible
+    static void stop();
+
+private:
+    struct Session;
+
+    // the reading thread of a session. it's joined by the accepting thread once it's done
+    struct Connection {
+        int         fd;
+        bool        done = false;
+        std::thread thread;
+    };
+
+    // a session has at most one search waiting or running, so serving the
+    // searches in the order they arrived is fair to all sessions
+    struct Job {
+        std::shared_ptr<Session> session;
+        Board                    board;
+        std::vector<uint64_t>    history;
+        SearchLimits             limits;
+
+        // the clock of the client keeps running while the job waits for a thread
+        std::chrono::steady_clock::time_point received;
+    };
+
+    static std::unique_ptr<TranspositionTable> tt;
+
+    static std::mutex              mutex;
+    static std::condition_variable job_ready;
+    static std::deque<Job>         jobs;
+
+    // guarded by the mutex
+    static std::list<Connection>   connections;
+
+    // the shared table is aged when a search starts while no other search is running.
+    // with many busy sessions, it's aged at most once per interval, so the entries of
+    // a running search only become old once it has been running for a while
+    static constexpr std::chrono::seconds AGE_INTERVAL{5};
+
+    // guarded by the mutex
+    static int                                   running;
+    static std::chrono::steady_clock::time_point aged;
+
+    // stop writes into the pipe to wake up the accepting thread. the pipe is never
+    // closed, so stop can't write into a file, which reused the number of its end
+    static std::atomic<bool>       stopping;
+    static std::atomic<int>        wake_fd;
+    static int                     wake_read;
+
+    static void search_worker(int index);
+    [[nodiscard]] static bool accept_loop(int server);
+    static void close_connections();
+
+    // subtracts the time spent in the queue from the time limits of the job,
+    // returns false when there is no time left to search at all
+    [[nodiscard]] static bool spend_queue_time(Job &job);
+
+    static void serve(Connection &connection);
+    static void handle_command(const std::shared_ptr<Session> &session, const std::vector<std::string_view> &tokens);
+
+    static void cmd_position(Session &session, const std::vector<std::string_view> &tokens);
+    static void cmd_go(const std::shared_ptr<Session> &session, const std::vector<std::string_view> &tokens);
+
+    // returns once the search of the session is finished
+    static void cmd_stop(Session &session);
+
+    // the move from the table (or any legal move), when there's no time to search
+    [[nodiscard]] static Move quick_move(const Board &board);
+};
+
+}
+
+#endif //DAEMON_H
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#include "datagen.h"
+
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/io/packed_position.h"
+#include "src/movegen/movegen.h"
+#include "src/search/search.h"
+
+namespace Kreveta {
+
+// openings, which are already decided after the random moves, are thrown away
+constexpr int MAX_OPENING_SCORE = 400;
+
+// a game is adjudicated as won, once the score stays above this for a few moves,
+// and as drawn, once the score stays close to zero for long enough later in the game
+constexpr int WIN_SCORE       = 2000;
+constexpr int WIN_PLIES       = 4;
+constexpr int DRAW_SCORE      = 10;
+constexpr int DRAW_PLIES      = 10;
+constexpr int DRAW_START_PLY  = 80;
+constexpr int MAX_GAME_PLIES  = 400;
+
+bool Datagen::run(const DatagenSettings &settings) {
+    const int threads = settings.threads > 0
+        ? settings.threads
+        : static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+
+    UCI::log(std::format("Generating {} games at {} nodes on {} threads",
+        format_uint64_t(settings.games), format_uint64_t(settings.nodes), threads));
+
+    Progress progress;
+    std::vector<std::thread> workers;
+
+    // the games are split evenly, the first threads play the remainder
+    for (int i = 0; i < threads; i++) {
+        const uint64_t games = settings.games / threads + (i < static_cast<int>(settings.games % threads));
+        workers.emplace_back(worker, std::cref(settings), i, games, std::ref(progress));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto last_report = start;
+
+    while (progress.finished.load(std::memory_order_relaxed) != threads) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_report < std::chrono::seconds(10))
+            continue;
+
+        last_report = now;
+
+        const auto elapsed   = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+        const auto positions = progress.positions.load(std::memory_order_relaxed);
+
+        UCI::log(std::format("games {} positions {} ({} pos/s)",
+            format_uint64_t(progress.games.load(std::memory_order_relaxed)),
+            format_uint64_t(positions),
+            format_uint64_t(positions * 1000 / std::max<int64_t>(elapsed, 1))));
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+
+    // append the files of all threads to the output. the output may already
+    // contain positions from earlier runs, which are kept
+    std::ofstream output{settings.output, std::ios::binary | std::ios::app};
+    if (!output) {
+        UCI::log(std::format("Unable to open '{}'", settings.output));
+        return false;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        const std::string path = part_path(settings.output, i);
+
+        if (std::ifstream part{path, std::ios::binary}; part && part.peek() != std::char_traits<char>::eof())
+            output << part.rdbuf();
+
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    UCI::log(std::format("Generated {} positions from {} games in {} ms",
+        format_uint64_t(progress.positions.load()), format_uint64_t(progress.games.load()), elapsed));
+
+    return static_cast<bool>(output);
+}
+
+void Datagen::worker(const DatagenSettings &settings, const int index, const uint64_t games, Progress &progress) {
+    PackedWriter writer;
+
+    if (writer.open(part_path(settings.output, index))) {
+        TranspositionTable tt(16);
+
+        const auto searcher = std::make_unique<Searcher>(tt);
+        searcher->silent = true;
+
+        SearchLimits limits;
+        limits.nodes = settings.nodes;
+
+        // every thread needs its own generator, otherwise they would need a lock
+        std::mt19937_64 rng(std::random_device{}() + static_cast<uint64_t>(index) * 0x9E3779B97F4A7C15ULL);
+
+        std::vector<uint64_t>       history;
+        std::vector<PackedPosition> positions;
+
+        for (uint64_t game = 0; game < games;) {
+            Board board = Board::make_startpos();
+            history.clear();
+
+            if (!play_opening(board, history, rng, settings.random_plies + static_cast<int>(rng() & 1)))
+                continue;
+
+            tt.clear();
+            searcher->clear();
+
+            if (std::abs(searcher->search(board, history, limits).score) > MAX_OPENING_SCORE)
+                continue;
+
+            positions.clear();
+
+            GameResult result = RESULT_UNKNOWN;
+            int win_plies  = 0;
+            int draw_plies = 0;
+
+            while (result == RESULT_UNKNOWN) {
+                const bool in_check = Movegen::is_in_check(board, board.color);
+
+                Move moves[MAX_MOVES];
+                if (Movegen::get_legal_moves(board, moves) == 0) {
+                    result = !in_check              ? RESULT_DRAW
+                           : board.color == COL_WHITE ? RESULT_BLACK_WIN
+                           : RESULT_WHITE_WIN;
+                    break;
+                }
+
+                if (board.halfmove_clock >= 100 || board.has_insufficient_material()
+                    || is_threefold(board, history) || history.size() >= MAX_GAME_PLIES) {
+                    result = RESULT_DRAW;
+                    break;
+                }
+
+                const SearchResult search = searcher->search(board, history, limits);
+
+                const int white_score = board.color == COL_WHITE
+                    ? search.score
+                    : -search.score;
+
+                win_plies  = std::abs(search.score) >= WIN_SCORE ? win_plies + 1 : 0;
+                draw_plies = history.size() >= DRAW_START_PLY && std::abs(search.score) <= DRAW_SCORE
+                    ? draw_plies + 1 : 0;
+
+                if (win_plies >= WIN_PLIES) {
+                    result = white_score > 0 ? RESULT_WHITE_WIN : RESULT_BLACK_WIN;
+                    break;
+                }
+
+                if (draw_plies >= DRAW_PLIES) {
+                    result = RESULT_DRAW;
+                    break;
+                }
+
+                // positions in check or with a tactical best move are noisy, since their
+                // static evaluation can be far from the search score, so they are skipped
+                if (!in_check && !search.best.is_capture() && !search.best.is_promotion()
+                    && std::abs(search.score) < MATE_BOUND) {
+
+                    positions.push_back(PackedPosition::pack(board,
+                        static_cast<int16_t>(white_score),
+                        RESULT_UNKNOWN,
+                        board.halfmove_clock,
+                        static_cast<uint16_t>(history.size() / 2 + 1)));
+                }
+
+                history.push_back(board.key);
+                board.play_move(search.best);
+            }
+
+            for (PackedPosition &packed : positions) {
+                packed.set_result(result);
+                writer.write(packed);
+            }
+
+            progress.positions.fetch_add(positions.size(), std::memory_order_relaxed);
+            progress.games.fetch_add(1, std::memory_order_relaxed);
+            game++;
+        }
+
+        writer.flush();
+    }
+
+    progress.finished.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Datagen::play_opening(Board &board, std::vector<uint64_t> &history, std::mt19937_64 &rng, const int plies) {
+    for (int i = 0; i < plies; i++) {
+        Move moves[MAX_MOVES];
+        const int count = Movegen::get_legal_moves(board, moves);
+
+        // the game ended during the random moves
+        if (count == 0)
+            return false;
+
+        history.push_back(board.key);
+        board.play_move(moves[rng() % count]);
+    }
+
+    Move moves[MAX_MOVES];
+    return Movegen::get_legal_moves(board, moves) != 0;
+}
+
+bool Datagen::is_threefold(const Board &board, const std::vector<uint64_t> &history) {
+    const int size = static_cast<int>(history.size());
+    const int last = std::max(size - board.halfmove_clock, 0);
+
+    int repetitions = 0;
+    for (int i = size - 2; i >= last; i -= 2) {
+        if (history[i] == board.key && ++repetitions == 2)
+            return true;
+    }
+
+    return false;
+}
+
+std::string Datagen::part_path(const std::string &output, const int index) {
+    return std::format("{}.part{}", output, index);
+}
+
+}
@@ -0,0 +1,51 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "src/board.h"
+
+namespace Kreveta {
+
+struct DatagenSettings {
+    std::string output;
+
+    // zero threads means one thread per hardware core
+    int      threads      = 0;
+    uint64_t nodes        = 5000;
+    uint64_t games        = 1000;
+
+    // number of random moves played at the start of every game
+    int      random_plies = 8;
+};
+
+// generates training data by playing games against itself. every thread plays its own
+// games with its own search and transposition table, and writes the positions into its
+// own file, so the threads never have to wait for each other. the files are joined
+// into the output once all games are finished
+class Datagen {
+public:
+    static bool run(const DatagenSettings &settings);
+
+private:
+    struct Progress {
+        std::atomic<uint64_t> games     = 0;
+        std::atomic<uint64_t> positions = 0;
+        std::atomic<int>      finished  = 0;
+    };
+
+    static void worker(const DatagenSettings &settings, int index, uint64_t games, Progress &progress);
+
+    static bool play_opening(Board &board, std::vector<uint64_t> &history, std::mt19937_64 &rng, int plies);
+    static bool is_threefold(const Board &board, const std::vector<uint64_t> &history);
+
+    [[nodiscard]] static std::string part_path(const std::string &output, int index);
+};
+
+}
+
+#endif //DATAGEN_H
@@ -0,0 +1,15 @@
+#ifndef EMBEDDED_NET_H
+#define EMBEDDED_NET_H
+
+#include <cstddef>
+
+namespace Kreveta {
+
+// the contents of the network file passed to CMake through KREVETA_EVALFILE.
+// the definition is generated at configure time (see cmake/embed_net.cmake)
+extern const unsigned char EMBEDDED_NET[];
+extern const std::size_t   EMBEDDED_NET_SIZE;
+
+}
+
+#endif //EMBEDDED_NET_H
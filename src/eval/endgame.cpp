@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "endgame.h"
+#include "kpk.h"
+
+#include "src/bitboard.h"
+
+namespace Kreveta {
+
+std::unordered_map<uint64_t, EndgameEntry> Endgames::table;
+
+// remaining piece values used by the endgame evaluations
+constexpr int ROOK_VALUE  = 500;
+constexpr int QUEEN_VALUE = 900;
+
+static int distance(const uint8_t a, const uint8_t b) {
+    return std::max(std::abs((a >> 3) - (b >> 3)), std::abs((a & 7) - (b & 7)));
+}
+
+// higher for squares closer to the edges and corners of the board
+static int push_to_edge(const uint8_t sq) {
+    const int file = sq & 7;
+    const int rank = sq >> 3;
+
+    return (3 - std::min(file, 7 - file)) * 20 + (3 - std::min(rank, 7 - rank)) * 20;
+}
+
+// higher when the kings are closer together
+static int push_close(const uint8_t a, const uint8_t b) {
+    return (7 - distance(a, b)) * 20;
+}
+
+static bool is_light_square(const uint8_t sq) {
+    return (((sq >> 3) + (sq & 7)) & 1) == 0;
+}
+
+// the lone king is mated by pushing it to the edge with the other king's help
+static int eval_kxk(const Board &board, const Color strong) {
+    const uint8_t strong_king = ls1b(board.pieces[strong][PT_KING]);
+    const uint8_t weak_king   = ls1b(board.pieces[col_flip(strong)][PT_KING]);
+
+    const int material = popc(board.pieces[strong][PT_QUEEN]) * QUEEN_VALUE
+                       + popc(board.pieces[strong][PT_ROOK])  * ROOK_VALUE;
+
+    return ENDGAME_WIN + material + push_to_edge(weak_king) + push_close(strong_king, weak_king);
+}
+
+// the mate is only possible in a corner of the bishop's color, so the weak
+// king is driven into one of those instead of just any corner
+static int eval_kbnk(const Board &board, const Color strong) {
+    const uint8_t strong_king = ls1b(board.pieces[strong][PT_KING]);
+    const uint8_t weak_king   = ls1b(board.pieces[col_flip(strong)][PT_KING]);
+    const uint8_t bishop      = ls1b(board.pieces[strong][PT_BISHOP]);
+
+    // a8 and h1 are light, h8 and a1 dark
+    const int corner_dist = is_light_square(bishop)
+        ? std::min(distance(weak_king, 0), distance(weak_king, 63))
+        : std::min(distance(weak_king, 7), distance(weak_king, 56));
+
+    return ENDGAME_WIN + (7 - corner_dist) * 40 + push_close(strong_king, weak_king);
+}
+
+// usually won, but much slower than a plain queen, so capturing
+// the rook must always look better than keeping this endgame
+static int eval_kqkr(const Board &board, const Color strong) {
+    const uint8_t strong_king = ls1b(board.pieces[strong][PT_KING]);
+    const uint8_t weak_king   = ls1b(board.pieces[col_flip(strong)][PT_KING]);
+
+    return QUEEN_VALUE - ROOK_VALUE + push_to_edge(weak_king) + push_close(strong_king, weak_king);
+}
+
+// two knights can't force a mate
+static int eval_draw(const Board &, const Color) {
+    return 0;
+}
+
+// the bitbase returns the score for the side to move
+static int eval_kpk(const Board &board, const Color strong) {
+    const int score = KPK::evaluate(board);
+    return board.color == strong ? score : -score;
+}
+
+// with only bishops of opposite colors left, even a few extra pawns are usually not
+// enough to win, since the defending bishop can't be driven away from the pawns
+static int scale_opposite_bishops(const Board &board, const Color strong) {
+    const uint8_t strong_bishop = ls1b(board.pieces[strong][PT_BISHOP]);
+    const uint8_t weak_bishop   = ls1b(board.pieces[col_flip(strong)][PT_BISHOP]);
+
+    if (is_light_square(strong_bishop) == is_light_square(weak_bishop))
+        return SCALE_NORMAL;
+
+    const int pawn_diff = popc(board.pieces[strong][PT_PAWN]) - popc(board.pieces[col_flip(strong)][PT_PAWN]);
+    return pawn_diff <= 1 ? 8 : 24;
+}
+
+// rook pawns with a bishop, which doesn't control the promotion square, can't
+// win once the defending king reaches the corner in front of them
+static int scale_wrong_rook_pawn(const Board &board, const Color strong) {
+    constexpr uint64_t A_FILE = 0x0101010101010101ULL;
+    constexpr uint64_t H_FILE = 0x8080808080808080ULL;
+
+    const uint64_t pawns = board.pieces[strong][PT_PAWN];
+
+    const bool on_a_file = !(pawns & ~A_FILE);
+    const bool on_h_file = !(pawns & ~H_FILE);
+
+    if (!on_a_file && !on_h_file)
+        return SCALE_NORMAL;
+
+    // the promotion square is on the first row (rank 8) for white and the last for black
+    const uint8_t promo = static_cast<uint8_t>((on_a_file ? 0 : 7) + (strong == COL_WHITE ? 0 : 56));
+
+    const uint8_t bishop    = ls1b(board.pieces[strong][PT_BISHOP]);
+    const uint8_t weak_king = ls1b(board.pieces[col_flip(strong)][PT_KING]);
+
+    if (is_light_square(bishop) != is_light_square(promo) && distance(weak_king, promo) <= 1)
+        return SCALE_DRAW;
+
+    return SCALE_NORMAL;
+}
+
+void Endgames::init() {
+    table.clear();
+
+    add("KP",  "K",  eval_kpk,  nullptr);
+    add("KQ",  "K",  eval_kxk,  nullptr);
+    add("KR",  "K",  eval_kxk,  nullptr);
+    add("KBN", "K",  eval_kbnk, nullptr);
+    add("KQ",  "KR", eval_kqkr, nullptr);
+    add("KNN", "K",  eval_draw, nullptr);
+
+    std::string pawns;
+    for (int count = 1; count <= 8; count++) {
+        pawns += 'P';
+
+        add("KB" + pawns, "K", nullptr, scale_wrong_rook_pawn);
+
+        // the weaker side is the one with fewer pawns
+        std::string weak_pawns;
+        for (int weak = 0; weak <= count; weak++) {
+            add("KB" + pawns, "KB" + weak_pawns, nullptr, scale_opposite_bishops);
+            weak_pawns += 'P';
+        }
+    }
+}
+
+void Endgames::add(const std::string_view strong, const std::string_view weak, const EndgameEval eval, const EndgameScale scale) {
+    constexpr std::string_view NAMES = "PNBRQ";
+
+    // the same key as Board::material_key (the kings are left out)
+    const auto key = [&](const Color strong_col) {
+        uint64_t k = 0ULL;
+
+        for (const char c : strong) {
+            if (const auto pt = NAMES.find(c); pt != std::string_view::npos)
+                k += 1ULL << (strong_col * 5 + pt) * 4;
+        }
+
+        for (const char c : weak) {
+            if (const auto pt = NAMES.find(c); pt != std::string_view::npos)
+                k += 1ULL << (col_flip(strong_col) * 5 + pt) * 4;
+        }
+
+        return k;
+    };
+
+    // with the same material on both sides, the first registered color is kept
+    table.try_emplace(key(COL_WHITE), EndgameEntry{ eval, scale, COL_WHITE });
+    table.try_emplace(key(COL_BLACK), EndgameEntry{ eval, scale, COL_BLACK });
+}
+
+}
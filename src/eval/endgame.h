@@ -0,0 +1,54 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "src/board.h"
+
+namespace Kreveta {
+
+// the base score of endgames, which are won by pushing the lone king into a corner.
+// it's far above anything the network returns, but below the tablebase and mate scores
+constexpr int ENDGAME_WIN = 5000;
+
+// scale factors are in 1/64, so the network's evaluation is kept as it is with 64
+constexpr int SCALE_NORMAL = 64;
+constexpr int SCALE_DRAW   = 0;
+
+// both return the score (or scale factor) from the point of view of the stronger side
+using EndgameEval  = int (*)(const Board &board, Color strong);
+using EndgameScale = int (*)(const Board &board, Color strong);
+
+// an endgame either has its own evaluation, which replaces the network, or a
+// scale factor, which shrinks the network's evaluation in drawish positions
+struct EndgameEntry {
+    EndgameEval  eval   = nullptr;
+    EndgameScale scale  = nullptr;
+    Color        strong = COL_WHITE;
+};
+
+// specialized knowledge about endgames, which the network doesn't handle well. the
+// endgames are found by the material key, so there is only a single lookup per evaluation
+class Endgames {
+public:
+    static void init();
+
+    // null if there is no special knowledge about the material
+    [[nodiscard]] static const EndgameEntry *probe(const Board &board) {
+        const auto it = table.find(board.material_key());
+        return it != table.end() ? &it->second : nullptr;
+    }
+
+private:
+    static std::unordered_map<uint64_t, EndgameEntry> table;
+
+    // the material is given as the pieces of both sides, e.g. "KBN" and "K". the
+    // endgame is added for both colors of the stronger side
+    static void add(std::string_view strong, std::string_view weak, EndgameEval eval, EndgameScale scale);
+};
+
+}
+
+#endif //ENDGAME_H
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "kpk.h"
+
+#include "src/bitboard.h"
+#include "src/movegen/movetables.h"
+
+namespace Kreveta {
+
+uint64_t KPK::bitbase[POSITIONS / 64];
+
+// the results are flags, so the results of all moves can be combined with or
+enum KPKResult : uint8_t {
+    KPK_INVALID = 0,
+    KPK_UNKNOWN = 1,
+    KPK_DRAW    = 2,
+    KPK_WON     = 4
+};
+
+static int distance(const uint8_t a, const uint8_t b) {
+    return std::max(std::abs((a >> 3) - (b >> 3)), std::abs((a & 7) - (b & 7)));
+}
+
+static uint64_t king_attacks(const uint8_t sq) {
+    return MoveTables::get_king_targets(1ULL << sq, ~0ULL);
+}
+
+static uint64_t pawn_attacks(const uint8_t sq) {
+    return MoveTables::get_pawn_capt_targets(1ULL << sq, ~0ULL, 64, COL_WHITE);
+}
+
+// the result, which is known without looking at any moves
+static KPKResult initial_result(const bool white_to_move, const uint8_t bk, const uint8_t wk, const uint8_t pawn) {
+
+    // the kings are touching or standing on the pawn, or black is in check with white to move
+    if (distance(wk, bk) <= 1 || wk == pawn || bk == pawn
+        || (white_to_move && (pawn_attacks(pawn) & 1ULL << bk)))
+        return KPK_INVALID;
+
+    // the pawn promotes, and the new queen can't be captured
+    if (white_to_move && pawn >> 3 == 1) {
+        const uint8_t promo = pawn - 8;
+
+        if (wk != promo && bk != promo && (distance(bk, promo) > 1 || distance(wk, promo) == 1))
+            return KPK_WON;
+    }
+
+    if (!white_to_move) {
+        const uint64_t safe = king_attacks(bk) & ~(king_attacks(wk) | pawn_attacks(pawn));
+
+        // stalemate, or the pawn is captured
+        if (!safe || (king_attacks(bk) & ~king_attacks(wk) & 1ULL << pawn))
+            return KPK_DRAW;
+    }
+
+    return KPK_UNKNOWN;
+}
+
+void KPK::init() {
+    std::vector<uint8_t> results(POSITIONS);
+
+    const auto for_each_position = [](const auto &func) {
+        for (uint8_t pawn = 8; pawn < 56; pawn++) {
+            if ((pawn & 7) > 3)
+                continue;
+
+            for (uint8_t wk = 0; wk < 64; wk++) {
+                for (uint8_t bk = 0; bk < 64; bk++) {
+                    func(true,  bk, wk, pawn);
+                    func(false, bk, wk, pawn);
+                }
+            }
+        }
+    };
+
+    for_each_position([&](const bool white_to_move, const uint8_t bk, const uint8_t wk, const uint8_t pawn) {
+        results[index(white_to_move, bk, wk, pawn)] = initial_result(white_to_move, bk, wk, pawn);
+    });
+
+    // white needs at least one winning move, while black needs at least one drawing
+    // move. we keep going through the unknown positions until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for_each_position([&](const bool white_to_move, const uint8_t bk, const uint8_t wk, const uint8_t pawn) {
+            uint8_t &result = results[index(white_to_move, bk, wk, pawn)];
+
+            if (result != KPK_UNKNOWN)
+                return;
+
+            uint8_t r = KPK_INVALID;
+
+            if (white_to_move) {
+                uint64_t targets = king_attacks(wk);
+                while (targets) r |= results[index(false, bk, ls1b_reset(targets), pawn)];
+
+                // the pawn pushes. the initial result only resolves the winning
+                // promotions. the others get here, but promoting adds nothing,
+                // since the new queen is lost
+                if (pawn >> 3 > 1)
+                    r |= results[index(false, bk, wk, pawn - 8)];
+
+                if (pawn >> 3 == 6 && pawn - 8 != wk && pawn - 8 != bk)
+                    r |= results[index(false, bk, wk, pawn - 16)];
+            }
+            else {
+                uint64_t targets = king_attacks(bk);
+                while (targets) r |= results[index(true, ls1b_reset(targets), wk, pawn)];
+            }
+
+            const KPKResult good = white_to_move ? KPK_WON  : KPK_DRAW;
+            const KPKResult bad  = white_to_move ? KPK_DRAW : KPK_WON;
+
+            const uint8_t new_result = r & good ? good : r & KPK_UNKNOWN ? KPK_UNKNOWN : bad;
+
+            if (new_result != KPK_UNKNOWN) {
+                result  = new_result;
+                changed = true;
+            }
+        });
+    }
+
+    // everything still unknown can't be won
+    std::fill(std::begin(bitbase), std::end(bitbase), 0ULL);
+
+    for (int i = 0; i < POSITIONS; i++) {
+        if (results[i] == KPK_WON)
+            bitbase[i >> 6] |= 1ULL << (i & 63);
+    }
+}
+
+bool KPK::probe(uint8_t strong_king, uint8_t pawn, uint8_t weak_king, const bool strong_to_move) {
+
+    // the bitbase only stores pawns on the a-d files
+    if ((pawn & 7) > 3) {
+        strong_king ^= 7;
+        pawn        ^= 7;
+        weak_king   ^= 7;
+    }
+
+    const int idx = index(strong_to_move, weak_king, strong_king, pawn);
+    return bitbase[idx >> 6] >> (idx & 63) & 1;
+}
+
+int KPK::evaluate(const Board &board) {
+    const Color strong = board.pieces[COL_WHITE][PT_PAWN] ? COL_WHITE : COL_BLACK;
+    const Color weak   = col_flip(strong);
+
+    // black pawns are flipped vertically, so they move up the board as well
+    const uint8_t flip = strong == COL_WHITE ? 0 : 56;
+
+    const uint8_t pawn        = ls1b(board.pieces[strong][PT_PAWN]) ^ flip;
+    const uint8_t strong_king = ls1b(board.pieces[strong][PT_KING]) ^ flip;
+    const uint8_t weak_king   = ls1b(board.pieces[weak][PT_KING])   ^ flip;
+
+    if (!probe(strong_king, pawn, weak_king, board.color == strong))
+        return 0;
+
+    // the rank of the pawn from its owner's point of view (2 to 7)
+    const int rank  = 8 - (pawn >> 3);
+    const int score = KPK_WIN + rank * 50;
+
+    return board.color == strong ? score : -score;
+}
+
+}
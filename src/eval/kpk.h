@@ -0,0 +1,50 @@
+#ifndef KPK_H
+#define KPK_H
+
+#include <cstdint>
+
+#include "src/board.h"
+
+namespace Kreveta {
+
+// the base score of a won king and pawn endgame. the pawn adds more the closer it is
+// to promotion, but a won position must still score less than the new queen, or the
+// search would never promote
+constexpr int KPK_WIN = 400;
+
+// exact results of all king and pawn versus king positions. the positions are always
+// normalized, so the pawn is white and on the a-d files, which leaves 24 pawn squares
+// x 64 x 64 king squares x 2 sides to move. a single bit per position tells whether
+// white wins, so the whole bitbase fits into 24 KB. it's generated by a retrograde
+// analysis at startup, which must happen after the move tables are initialized
+class KPK {
+public:
+    static void init();
+
+    // whether the side with the pawn wins. all squares are from white's point of
+    // view, so a position with a black pawn must be flipped before probing
+    [[nodiscard]] static bool probe(uint8_t strong_king, uint8_t pawn, uint8_t weak_king, bool strong_to_move);
+
+    // a board with only the kings and one pawn. the score is from the point of view
+    // of the side to move, zero for draws. pawns closer to promotion score higher
+    [[nodiscard]] static int evaluate(const Board &board);
+
+    [[nodiscard]] static bool is_kpk(const Board &board) {
+        return std::popcount(board.occupied()) == 3
+            && (board.pieces[COL_WHITE][PT_PAWN] | board.pieces[COL_BLACK][PT_PAWN]);
+    }
+
+private:
+    static constexpr int POSITIONS = 24 * 64 * 64 * 2;
+
+    static uint64_t bitbase[POSITIONS / 64];
+
+    // the pawn square goes last, so pawns on the same rank are next to each other
+    [[nodiscard]] static constexpr int index(const bool white_to_move, const uint8_t bk, const uint8_t wk, const uint8_t pawn) {
+        return white_to_move | bk << 1 | wk << 7 | (pawn & 7) << 13 | ((pawn >> 3) - 1) << 15;
+    }
+};
+
+}
+
+#endif //KPK_H
@@ -0,0 +1,786 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "nnue.h"
+#include "endgame.h"
+#include "psqt.h"
+
+#include "src/bitboard.h"
+#include "src/position.h"
+#include "src/trace.h"
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/global/consts.h"
+#include "src/movegen/movegen.h"
+#include "src/threads/thread_pool.h"
+
+#ifdef KREVETA_EMBEDDED_NET
+#include "embedded_net.h"
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NNUE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace Kreveta {
+
+const Network *NNUE::net    = nullptr;
+NNUEKernel     NNUE::kernel = KERNEL_SCALAR;
+MappedFile     NNUE::file;
+
+// king buckets are based on the relative rank of the king. the king is also
+// mirrored horizontally, so the network doesn't have to learn everything twice
+constexpr uint8_t KING_BUCKET_RANKS[8] = { 0, 1, 2, 2, 3, 3, 3, 3 };
+
+constexpr std::string_view KERNEL_NAMES[KERNEL_COUNT] = { "scalar", "sse4.1", "avx2" };
+
+uint8_t NNUE::king_bucket(const Board &board, const Color persp) {
+    const uint8_t king_sq = ls1b(board.pieces[persp][PT_KING]);
+
+    // our squares are indexed from a8, so white has to flip the ranks
+    const uint8_t rel_sq = persp == COL_WHITE
+        ? king_sq ^ 56
+        : king_sq;
+
+    // the lowest bit tells us whether the board is mirrored
+    return static_cast<uint8_t>(KING_BUCKET_RANKS[rel_sq >> 3] << 1 | ((rel_sq & 7) >= 4));
+}
+
+int NNUE::feature_index(const Color persp, const uint8_t bucket, const Color col, const PieceType pt, const uint8_t sq) {
+    uint8_t rel_sq = persp == COL_WHITE
+        ? sq ^ 56
+        : sq;
+
+    if (bucket & 1)
+        rel_sq ^= 7;
+
+    return (bucket >> 1) * NNUE_INPUTS
+        + (col != persp) * 384
+        + pt * 64
+        + rel_sq;
+}
+
+// return the first layer weights of a single feature
+static const int16_t *feature_weights(const Network *net, const int index) {
+    return net->ft_weights + index * NNUE_HIDDEN_SIZE;
+}
+
+// ---ACCUMULATOR KERNELS-------------------------------------------------------
+// adding or subtracting the weights of a single feature is what every incremental
+// update and refresh consists of. the build may not target any SIMD extensions,
+// so these are dispatched by the same kernel as the output layer
+
+static void add_feature_scalar(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++)
+        acc[i] += w[i];
+}
+
+static void sub_feature_scalar(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++)
+        acc[i] -= w[i];
+}
+
+#ifdef NNUE_X86_KERNELS
+
+__attribute__((target("sse4.1")))
+static void add_feature_sse41(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i += 8) {
+        auto *a = reinterpret_cast<__m128i *>(acc + i);
+        _mm_store_si128(a, _mm_add_epi16(_mm_load_si128(a), _mm_load_si128(reinterpret_cast<const __m128i *>(w + i))));
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void sub_feature_sse41(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i += 8) {
+        auto *a = reinterpret_cast<__m128i *>(acc + i);
+        _mm_store_si128(a, _mm_sub_epi16(_mm_load_si128(a), _mm_load_si128(reinterpret_cast<const __m128i *>(w + i))));
+    }
+}
+
+__attribute__((target("avx2")))
+static void add_feature_avx2(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i += 16) {
+        auto *a = reinterpret_cast<__m256i *>(acc + i);
+        _mm256_store_si256(a, _mm256_add_epi16(_mm256_load_si256(a), _mm256_load_si256(reinterpret_cast<const __m256i *>(w + i))));
+    }
+}
+
+__attribute__((target("avx2")))
+static void sub_feature_avx2(int16_t *acc, const int16_t *w) {
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i += 16) {
+        auto *a = reinterpret_cast<__m256i *>(acc + i);
+        _mm256_store_si256(a, _mm256_sub_epi16(_mm256_load_si256(a), _mm256_load_si256(reinterpret_cast<const __m256i *>(w + i))));
+    }
+}
+
+#endif
+
+void NNUE::add_feature(int16_t *acc, const int16_t *w) {
+    switch (kernel) {
+#ifdef NNUE_X86_KERNELS
+        case KERNEL_AVX2:  add_feature_avx2 (acc, w); break;
+        case KERNEL_SSE41: add_feature_sse41(acc, w); break;
+#endif
+        default:           add_feature_scalar(acc, w); break;
+    }
+}
+
+void NNUE::sub_feature(int16_t *acc, const int16_t *w) {
+    switch (kernel) {
+#ifdef NNUE_X86_KERNELS
+        case KERNEL_AVX2:  sub_feature_avx2 (acc, w); break;
+        case KERNEL_SSE41: sub_feature_sse41(acc, w); break;
+#endif
+        default:           sub_feature_scalar(acc, w); break;
+    }
+}
+
+// ---OUTPUT KERNELS------------------------------------------------------------
+// all kernels compute exactly the same thing - clip both accumulators into
+// [0, QA] and take a dot product with the int8 output weights. the clipped
+// values always fit into 8 bits, which is what the SIMD kernels rely on
+
+static int32_t output_scalar(const int16_t *us, const int16_t *them, const int8_t *weights) {
+    int32_t sum = 0;
+
+    for (int i = 0; i < NNUE_HIDDEN_SIZE; i++) {
+        sum += std::clamp<int16_t>(us[i],   0, NNUE_QA) * weights[i];
+        sum += std::clamp<int16_t>(them[i], 0, NNUE_QA) * weights[i + NNUE_HIDDEN_SIZE];
+    }
+
+    return sum;
+}
+
+#ifdef NNUE_X86_KERNELS
+
+__attribute__((target("sse4.1")))
+static int32_t output_sse41(const int16_t *us, const int16_t *them, const int8_t *weights) {
+    const __m128i max  = _mm_set1_epi16(NNUE_QA);
+    const __m128i ones = _mm_set1_epi16(1);
+
+    __m128i sum = _mm_setzero_si128();
+
+    for (const int16_t *acc : { us, them }) {
+        for (int i = 0; i < NNUE_HIDDEN_SIZE; i += 16) {
+            const __m128i a = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(acc + i)),     max);
+            const __m128i b = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(acc + i + 8)), max);
+
+            // packing with unsigned saturation also clips the negative values
+            const __m128i act = _mm_packus_epi16(a, b);
+            const __m128i w   = _mm_load_si128(reinterpret_cast<const __m128i *>(weights + i));
+
+            // the products can't overflow, because the activations are at most QA
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(act, w), ones));
+        }
+
+        weights += NNUE_HIDDEN_SIZE;
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2")))
+static int32_t output_avx2(const int16_t *us, const int16_t *them, const int8_t *weights) {
+    const __m256i max  = _mm256_set1_epi16(NNUE_QA);
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    __m256i sum = _mm256_setzero_si256();
+
+    for (const int16_t *acc : { us, them }) {
+        for (int i = 0; i < NNUE_HIDDEN_SIZE; i += 32) {
+            const __m256i a = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i)),      max);
+            const __m256i b = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(acc + i + 16)), max);
+
+            // packing works within 128-bit lanes, so the result must be permuted
+            // back into the original order to match the weights
+            const __m256i act = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+            const __m256i w   = _mm256_load_si256(reinterpret_cast<const __m256i *>(weights + i));
+
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(act, w), ones));
+        }
+
+        weights += NNUE_HIDDEN_SIZE;
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+
+#endif
+
+int32_t NNUE::output_sum(const int16_t *us, const int16_t *them, const NNUEKernel kernel) {
+    switch (kernel) {
+#ifdef NNUE_X86_KERNELS
+        case KERNEL_AVX2:  return output_avx2 (us, them, net->out_weights);
+        case KERNEL_SSE41: return output_sse41(us, them, net->out_weights);
+#endif
+        default:           return output_scalar(us, them, net->out_weights);
+    }
+}
+
+int NNUE::output(const int16_t *us, const int16_t *them) {
+    const int32_t sum = output_sum(us, them, kernel);
+
+    // a large sum times the scale doesn't fit into 32 bits
+    return static_cast<int>((static_cast<int64_t>(sum) + net->out_bias) * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+}
+
+// ---ACCUMULATORS--------------------------------------------------------------
+
+void AccumulatorStack::reset(const Board &board) {
+    top = 0;
+
+    // the refresh cache must start from an empty board, which has the biases only
+    for (auto &persp_entries : cache) {
+        for (auto &entry : persp_entries) {
+            std::memcpy(entry.values, NNUE::net->ft_biases, sizeof(entry.values));
+            std::memset(entry.pieces, 0, sizeof(entry.pieces));
+        }
+    }
+
+    for (const Color persp : { COL_WHITE, COL_BLACK }) {
+        stack[0].bucket[persp] = NNUE::king_bucket(board, persp);
+        refresh(board, persp);
+    }
+}
+
+void AccumulatorStack::push(const Board &board, const DirtyPieces &dirty) {
+    Accumulator &acc = stack[++top];
+
+    acc.dirty = dirty;
+
+    for (const Color persp : { COL_WHITE, COL_BLACK }) {
+        acc.bucket[persp]   = NNUE::king_bucket(board, persp);
+        acc.computed[persp] = false;
+    }
+}
+
+void AccumulatorStack::pop() {
+    top--;
+}
+
+int AccumulatorStack::evaluate(const Board &board) {
+    const EndgameEntry *endgame = Endgames::probe(board);
+
+    // the endgame is known well enough, so there is no need to ask the network
+    if (endgame && endgame->eval) {
+        const int score = endgame->eval(board, endgame->strong);
+        return board.color == endgame->strong ? score : -score;
+    }
+
+    const Accumulator &acc = current(board);
+
+    const int score = NNUE::output(
+        acc.values[board.color],
+        acc.values[col_flip(board.color)]);
+
+    return endgame ? score * endgame->scale(board, endgame->strong) / SCALE_NORMAL : score;
+}
+
+const Accumulator &AccumulatorStack::current(const Board &board) {
+    for (const Color persp : { COL_WHITE, COL_BLACK }) {
+        if (!stack[top].computed[persp])
+            update(board, persp);
+    }
+
+    return stack[top];
+}
+
+void AccumulatorStack::update(const Board &board, const Color persp) {
+    const Network *net = NNUE::net;
+
+    // find the last computed accumulator. the first accumulator is
+    // always computed, so we are guaranteed to stop somewhere
+    int last = top;
+    while (!stack[last].computed[persp]) {
+
+        // the king has moved into another bucket, which changes all features
+        // of this perspective, so we have to refresh instead of updating
+        if (stack[last].bucket[persp] != stack[last - 1].bucket[persp]) {
+            refresh(board, persp);
+            return;
+        }
+
+        last--;
+    }
+
+    // now apply the dirty pieces of every move since then
+    for (int i = last + 1; i <= top; i++) {
+        const DirtyPieces &dirty = stack[i].dirty;
+        const uint8_t bucket     = stack[i].bucket[persp];
+
+        int16_t *values = stack[i].values[persp];
+        std::memcpy(values, stack[i - 1].values[persp], sizeof(stack[i].values[persp]));
+
+        for (int j = 0; j < dirty.removed_count; j++) {
+            const auto &[col, pt, sq] = dirty.removed[j];
+            NNUE::sub_feature(values, feature_weights(net, NNUE::feature_index(persp, bucket, col, pt, sq)));
+        }
+
+        for (int j = 0; j < dirty.added_count; j++) {
+            const auto &[col, pt, sq] = dirty.added[j];
+            NNUE::add_feature(values, feature_weights(net, NNUE::feature_index(persp, bucket, col, pt, sq)));
+        }
+
+        stack[i].computed[persp] = true;
+    }
+}
+
+void AccumulatorStack::refresh(const Board &board, const Color persp) {
+    const Network *net   = NNUE::net;
+    const uint8_t bucket = stack[top].bucket[persp];
+
+    RefreshEntry &entry = cache[persp][bucket];
+
+    // only the pieces, which differ from the cached board, need to be updated
+    for (const Color col : { COL_WHITE, COL_BLACK }) {
+        for (int pt = PT_PAWN; pt <= PT_KING; pt++) {
+            const uint64_t cur = board.pieces[col][pt];
+            const uint64_t old = entry.pieces[col][pt];
+
+            uint64_t added   = cur & ~old;
+            uint64_t removed = old & ~cur;
+
+            while (added) {
+                const uint8_t sq = ls1b_reset(added);
+                NNUE::add_feature(entry.values, feature_weights(net,
+                    NNUE::feature_index(persp, bucket, col, static_cast<PieceType>(pt), sq)));
+            }
+
+            while (removed) {
+                const uint8_t sq = ls1b_reset(removed);
+                NNUE::sub_feature(entry.values, feature_weights(net,
+                    NNUE::feature_index(persp, bucket, col, static_cast<PieceType>(pt), sq)));
+            }
+
+            entry.pieces[col][pt] = cur;
+        }
+    }
+
+    std::memcpy(stack[top].values[persp], entry.values, sizeof(entry.values));
+    stack[top].computed[persp] = true;
+}
+
+// ---NETWORK-------------------------------------------------------------------
+
+void NNUE::init() {
+    kernel = best_kernel();
+    load_default();
+}
+
+void NNUE::load_default() {
+#ifdef KREVETA_EMBEDDED_NET
+    if (const Network *embedded = validate(EMBEDDED_NET, EMBEDDED_NET_SIZE)) {
+        net = embedded;
+        file.close();
+        return;
+    }
+
+    UCI::log("Embedded network is invalid, using the bootstrap network");
+#endif
+
+    // the bootstrap network is large, so it must not live on the stack. it
+    // is only built once, even if we switch between networks multiple times
+    static const auto bootstrap = [] {
+        auto network = std::make_unique<Network>();
+        build_bootstrap_net(*network);
+        return network;
+    }();
+
+    net = bootstrap.get();
+    file.close();
+}
+
+bool NNUE::load(const std::string &path) {
+    MappedFile new_file;
+
+    if (!new_file.open(path)) {
+        UCI::log(std::format("Unable to open network file '{}'", path));
+        return false;
+    }
+
+    const Network *network = validate(new_file.data(), new_file.size());
+    if (!network) {
+        UCI::log(std::format("Invalid network file '{}'", path));
+        return false;
+    }
+
+    // the parameters are used right from the mapped pages, so
+    // the previous file can only be unmapped after the switch
+    net  = network;
+    file = std::move(new_file);
+    return true;
+}
+
+bool NNUE::save(const std::string &path, const Network &network) {
+    NetworkHeader header{};
+
+    std::memcpy(header.magic, NNUE_MAGIC.data(), sizeof(header.magic));
+    header.version      = NNUE_VERSION;
+    header.inputs       = NNUE_INPUTS;
+    header.king_buckets = NNUE_KING_BUCKETS;
+    header.hidden_size  = NNUE_HIDDEN_SIZE;
+    header.checksum     = checksum(reinterpret_cast<const unsigned char *>(&network), sizeof(Network));
+
+    std::ofstream out{path, std::ios::binary};
+    if (!out) {
+        UCI::log(std::format("Unable to open network file '{}'", path));
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(&network), sizeof(Network));
+
+    return static_cast<bool>(out);
+}
+
+const Network *NNUE::validate(const unsigned char *data, const std::size_t size) {
+    if (size != sizeof(NetworkHeader) + sizeof(Network))
+        return nullptr;
+
+    const auto *header = reinterpret_cast<const NetworkHeader *>(data);
+
+    if (std::string_view(header->magic, 8) != NNUE_MAGIC
+        || header->version      != NNUE_VERSION
+        || header->inputs       != NNUE_INPUTS
+        || header->king_buckets != NNUE_KING_BUCKETS
+        || header->hidden_size  != NNUE_HIDDEN_SIZE)
+        return nullptr;
+
+    // the parameters themselves could still be truncated or corrupted
+    if (header->checksum != checksum(data + sizeof(NetworkHeader), sizeof(Network)))
+        return nullptr;
+
+    return reinterpret_cast<const Network *>(data + sizeof(NetworkHeader));
+}
+
+// 64-bit FNV-1a hash. it is only meant to detect damaged files, not to be secure
+uint64_t NNUE::checksum(const unsigned char *data, const std::size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+// when the build doesn't embed a trained network, we use this one instead. every piece
+// type of each side has its own group of hidden neurons, which sums up the values of
+// those pieces from the piece-square table, so it is just a piece-square evaluation
+// expressed as a network
+void NNUE::build_bootstrap_net(Network &network) {
+    constexpr int GROUP_SIZE = 20;
+
+    // a single unit in the accumulator of a group is worth
+    // OUT_WEIGHT * SCALE / (QA * QB) centipawns (about 1.6)
+    constexpr int OUT_WEIGHT = 32;
+
+    static_assert(12 * GROUP_SIZE <= NNUE_HIDDEN_SIZE, "the bootstrap network needs a group for each piece");
+
+    std::memset(&network, 0, sizeof(Network));
+
+    // the accumulator is clipped at zero, so the values can't be negative. there is
+    // always one king on each side, so the king values can be shifted freely
+    const int king_min = *std::ranges::min_element(PSQT_VALUES[PT_KING]);
+
+    for (int side = 0; side < 2; side++) {
+        for (int pt = PT_PAWN; pt <= PT_KING; pt++) {
+            const int first = (side * 6 + pt) * GROUP_SIZE;
+
+            for (int sq = 0; sq < 64; sq++) {
+
+                // the table is relative to the owner of the piece, while the
+                // features are relative to the perspective, so the opponent's
+                // pieces must be flipped back
+                const int value = PSQT_VALUES[pt][psqt_index(side == 0 ? sq : sq ^ 56)]
+                    - (pt == PT_KING ? king_min : 0);
+
+                const int units = (std::max(value, 0) * NNUE_QA * NNUE_QB + OUT_WEIGHT * NNUE_SCALE / 2)
+                    / (OUT_WEIGHT * NNUE_SCALE);
+
+                // the units are spread evenly over the group, so many pieces
+                // of the same type still fit into the clipped range
+                for (int bucket = 0; bucket < NNUE_KING_BUCKETS; bucket++) {
+                    const int index = bucket * NNUE_INPUTS + side * 384 + pt * 64 + sq;
+
+                    for (int n = 0; n < GROUP_SIZE; n++) {
+                        network.ft_weights[index * NNUE_HIDDEN_SIZE + first + n] =
+                            static_cast<int16_t>(units / GROUP_SIZE + (n < units % GROUP_SIZE));
+                    }
+                }
+            }
+
+            // only our own perspective is used, the other one would just double it
+            for (int n = first; n < first + GROUP_SIZE; n++) {
+                network.out_weights[n] = static_cast<int8_t>(side == 0
+                    ? OUT_WEIGHT
+                    : -OUT_WEIGHT);
+            }
+        }
+    }
+}
+
+int NNUE::evaluate(const Board &board) {
+
+    // the accumulator stack is quite large, so every thread keeps one around
+    thread_local auto stack = std::make_unique<AccumulatorStack>();
+
+    stack->reset(board);
+    return stack->evaluate(board);
+}
+
+// ---BATCH---------------------------------------------------------------------
+
+// number of positions processed together. all the per-position data of a block
+// stays in L1, and the block is large enough for the loops over it to vectorize
+constexpr int BATCH_BLOCK = 32;
+
+void NNUE::evaluate_batch(const Board *boards, const std::size_t count, int16_t *out, ThreadPool &pool) {
+
+    // a single chunk contains multiple blocks, so the threads don't fight
+    // over the shared counter after every few positions
+    pool.parallel_for(count, BATCH_BLOCK * 64, [&](const std::size_t begin, const std::size_t end, int) {
+        for (std::size_t i = begin; i < end; i += BATCH_BLOCK) {
+            evaluate_block(boards + i, static_cast<int>(std::min<std::size_t>(BATCH_BLOCK, end - i)), out + i);
+        }
+    });
+}
+
+// the block is stored as a structure of arrays. instead of walking the boards one
+// by one, every step (king buckets, square orientation, feature indices) is done
+// for the whole block at once, which turns it into simple loops over arrays
+void NNUE::evaluate_block(const Board *boards, const int block_size, int16_t *out) {
+
+    // boards with more pieces than there is room for features (or without both
+    // kings) can't be evaluated, so they are scored as zero and left out. known
+    // endgames are evaluated like in the search, so they skip the network too
+    int index[BATCH_BLOCK];
+    int count = 0;
+
+    const EndgameEntry *endgames[BATCH_BLOCK];
+
+    for (int i = 0; i < block_size; i++) {
+        if (!boards[i].has_valid_material()) {
+            out[i] = 0;
+            continue;
+        }
+
+        const EndgameEntry *endgame = Endgames::probe(boards[i]);
+
+        if (endgame && endgame->eval) {
+            const int score = endgame->eval(boards[i], endgame->strong);
+            out[i] = static_cast<int16_t>(boards[i].color == endgame->strong ? score : -score);
+            continue;
+        }
+
+        endgames[count] = endgame;
+        index[count++]  = i;
+    }
+
+    alignas(64) uint64_t pieces[2][6][BATCH_BLOCK];
+    alignas(64) uint8_t  king_sq[2][BATCH_BLOCK];
+
+    // the feature index of a piece is base + side offset + piece offset + (square ^ orient)
+    alignas(64) uint16_t base[2][BATCH_BLOCK];
+    alignas(64) uint8_t  orient[2][BATCH_BLOCK];
+
+    // the square, piece type offset (pt * 64) and side offset (384 for black pieces)
+    // of every piece. a board has at most 32 pieces, the unused slots are zero
+    alignas(64) uint8_t  squares[BATCH_BLOCK][32];
+    alignas(64) uint16_t piece_offset[BATCH_BLOCK][32];
+    alignas(64) uint16_t side_offset[BATCH_BLOCK][32];
+    alignas(64) uint8_t  feature_count[BATCH_BLOCK]{};
+
+    alignas(64) uint16_t features[2][BATCH_BLOCK][32];
+
+    for (int col = 0; col < 2; col++) {
+        for (int pt = 0; pt < 6; pt++) {
+            for (int i = 0; i < count; i++)
+                pieces[col][pt][i] = boards[index[i]].pieces[col][pt];
+        }
+    }
+
+    for (const Color persp : { COL_WHITE, COL_BLACK }) {
+        const uint8_t rank_flip = persp == COL_WHITE ? 56 : 0;
+
+        for (int i = 0; i < count; i++)
+            king_sq[persp][i] = ls1b(pieces[persp][PT_KING][i]) ^ rank_flip;
+
+        for (int i = 0; i < count; i++) {
+            const uint8_t rel_sq = king_sq[persp][i];
+            const bool    mirror = (rel_sq & 7) >= 4;
+
+            base[persp][i]   = KING_BUCKET_RANKS[rel_sq >> 3] * NNUE_INPUTS;
+            orient[persp][i] = rank_flip ^ (mirror ? 7 : 0);
+        }
+    }
+
+    // the bits can only be extracted one by one, so this pass does nothing else
+    for (int col = 0; col < 2; col++) {
+        for (int pt = 0; pt < 6; pt++) {
+            for (int i = 0; i < count; i++) {
+                uint64_t bb = pieces[col][pt][i];
+
+                while (bb) {
+                    const uint8_t n = feature_count[i]++;
+
+                    squares[i][n]      = ls1b_reset(bb);
+                    piece_offset[i][n] = static_cast<uint16_t>(pt * 64);
+                    side_offset[i][n]  = static_cast<uint16_t>(col * 384);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        for (int n = feature_count[i]; n < 32; n++) {
+            squares[i][n]      = 0;
+            piece_offset[i][n] = 0;
+            side_offset[i][n]  = 0;
+        }
+    }
+
+    // the feature indices of both perspectives are then computed for all 32 slots
+    // of each board, which are fixed length loops the compiler vectorizes. the side
+    // offset is relative to the perspective, so black has to flip it
+    for (int i = 0; i < count; i++) {
+        for (const Color persp : { COL_WHITE, COL_BLACK }) {
+            const uint16_t b    = base[persp][i];
+            const uint8_t  o    = orient[persp][i];
+            const uint16_t flip = persp == COL_WHITE ? 0 : 384;
+
+            for (int n = 0; n < 32; n++)
+                features[persp][i][n] = static_cast<uint16_t>(b + (side_offset[i][n] ^ flip) + piece_offset[i][n] + (squares[i][n] ^ o));
+        }
+    }
+
+    // the accumulators are computed in tiles, which fit into registers. this way
+    // every tile is only loaded and stored once instead of once per feature
+    constexpr int TILE = 64;
+
+    alignas(64) int16_t acc[2][NNUE_HIDDEN_SIZE];
+
+    for (int i = 0; i < count; i++) {
+        for (const Color persp : { COL_WHITE, COL_BLACK }) {
+            for (int t = 0; t < NNUE_HIDDEN_SIZE; t += TILE) {
+                alignas(64) int16_t tile[TILE];
+                std::memcpy(tile, net->ft_biases + t, sizeof(tile));
+
+                for (int n = 0; n < feature_count[i]; n++) {
+                    const int16_t *w = feature_weights(net, features[persp][i][n]) + t;
+
+                    for (int k = 0; k < TILE; k++)
+                        tile[k] += w[k];
+                }
+
+                std::memcpy(acc[persp] + t, tile, sizeof(tile));
+            }
+        }
+
+        const Board &board = boards[index[i]];
+        const int    score = output(acc[board.color], acc[col_flip(board.color)]);
+
+        out[index[i]] = static_cast<int16_t>(endgames[i]
+            ? score * endgames[i]->scale(board, endgames[i]->strong) / SCALE_NORMAL
+            : score);
+    }
+}
+
+// ---KERNELS-------------------------------------------------------------------
+
+bool NNUE::is_kernel_supported(const NNUEKernel kernel) {
+    switch (kernel) {
+        case KERNEL_SCALAR: return true;
+
+#ifdef NNUE_X86_KERNELS
+        case KERNEL_SSE41:  return __builtin_cpu_supports("sse4.1");
+        case KERNEL_AVX2:   return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+NNUEKernel NNUE::best_kernel() {
+    if (is_kernel_supported(KERNEL_AVX2))  return KERNEL_AVX2;
+    if (is_kernel_supported(KERNEL_SSE41)) return KERNEL_SSE41;
+    return KERNEL_SCALAR;
+}
+
+void NNUE::set_kernel(const NNUEKernel kernel) {
+    if (is_kernel_supported(kernel))
+        NNUE::kernel = kernel;
+}
+
+void NNUE::bench() {
+    constexpr int ROUNDS = 200;
+
+    Board boards[BENCH_FEN_COUNT];
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+        const std::string fen(BENCH_FENS[i]);
+        (void)Position::try_parse_fen(str_split(fen), boards[i]);
+    }
+
+    const auto stack           = std::make_unique<AccumulatorStack>();
+    const NNUEKernel original  = kernel;
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (!is_kernel_supported(static_cast<NNUEKernel>(k))) {
+            UCI::log(std::format("{:<8} not supported", KERNEL_NAMES[k]));
+            continue;
+        }
+
+        kernel = static_cast<NNUEKernel>(k);
+
+        uint64_t evals    = 0;
+        int64_t  checksum = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        // every position is evaluated after each of its moves, which is
+        // how the evaluation is used in a search - incremental updates
+        // from the parent accumulator followed by the output layer
+        for (int r = 0; r < ROUNDS; r++) {
+            for (Board &board : boards) {
+                Move moves[MAX_MOVES];
+                const int count = Movegen::get_legal_moves(board, moves);
+
+                stack->reset(board);
+
+                for (int i = 0; i < count; i++) {
+                    Board child = board.clone();
+                    DirtyPieces dirty;
+                    child.play_move(moves[i], dirty);
+
+                    stack->push(child, dirty);
+                    checksum += stack->evaluate(child);
+                    stack->pop();
+
+                    evals++;
+                }
+            }
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        UCI::log(std::format("{:<8} {} evals/s (checksum {})", KERNEL_NAMES[k],
+            format_uint64_t(evals * 1'000'000 / std::max<int64_t>(elapsed, 1)), checksum));
+    }
+
+    kernel = original;
+}
+
+}
@@ -0,0 +1,175 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "src/board.h"
+#include "src/io/mapped_file.h"
+
+namespace Kreveta {
+
+class ThreadPool;
+
+// the network architecture is (768 x KING_BUCKETS -> HIDDEN_SIZE) x 2 -> 1. the first
+// layer (feature transformer) is shared by both perspectives and its output is called
+// the accumulator. since only a few pieces change in a single move, the accumulator is
+// updated incrementally instead of being recomputed from all pieces
+constexpr int NNUE_INPUTS       = 768;
+constexpr int NNUE_KING_BUCKETS = 4;
+constexpr int NNUE_HIDDEN_SIZE  = 256;
+
+// quantization constants. the accumulator is stored as int16 and clipped into
+// [0, QA] before the output layer, which has int8 weights scaled by QB
+constexpr int NNUE_QA    = 127;
+constexpr int NNUE_QB    = 64;
+constexpr int NNUE_SCALE = 400;
+
+// maximum number of moves that can be pushed onto the accumulator stack
+constexpr int NNUE_MAX_PLY = 256;
+
+// the raw network parameters in the exact layout they are stored in the
+// network file, so the file contents can be used without any conversion
+struct Network {
+    alignas(64) int16_t ft_weights[NNUE_KING_BUCKETS * NNUE_INPUTS * NNUE_HIDDEN_SIZE];
+    alignas(64) int16_t ft_biases[NNUE_HIDDEN_SIZE];
+    alignas(64) int8_t  out_weights[2 * NNUE_HIDDEN_SIZE];
+    alignas(64) int32_t out_bias;
+};
+
+// the network file begins with this header, the parameters follow right after it.
+// the checksum is computed from the parameters only (see NNUE::checksum)
+struct NetworkHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t inputs;
+    uint32_t king_buckets;
+    uint32_t hidden_size;
+    uint64_t checksum;
+    uint8_t  reserved[32];
+};
+
+static_assert(sizeof(NetworkHeader) == 64, "network header must keep the parameters aligned");
+
+constexpr std::string_view NNUE_MAGIC   = "KRVTNNUE";
+constexpr uint32_t         NNUE_VERSION = 2;
+
+// the output layer and the accumulator updates have separate implementations for
+// the available instruction sets, which are selected at runtime
+enum NNUEKernel : uint8_t {
+    KERNEL_SCALAR = 0,
+    KERNEL_SSE41  = 1,
+    KERNEL_AVX2   = 2,
+
+    KERNEL_COUNT  = 3
+};
+
+struct Accumulator {
+    alignas(64) int16_t values[2][NNUE_HIDDEN_SIZE];
+
+    // the move which led from the previous accumulator to this one
+    DirtyPieces dirty;
+
+    // king bucket of each perspective (including horizontal mirroring).
+    // when it changes, the accumulator can't be updated incrementally
+    uint8_t bucket[2];
+    bool    computed[2];
+};
+
+// each bucket of each perspective remembers the last accumulator computed in it
+// along with the pieces it was computed from. a full refresh then only needs to
+// apply the differences between those pieces and the current board
+struct RefreshEntry {
+    alignas(64) int16_t values[NNUE_HIDDEN_SIZE];
+    uint64_t pieces[2][6];
+};
+
+// every search thread owns one of these. moves are pushed along with their dirty
+// pieces, but the accumulators are only updated once an evaluation is requested
+class AccumulatorStack {
+public:
+    void reset(const Board &board);
+
+    void push(const Board &board, const DirtyPieces &dirty);
+    void pop();
+
+    [[nodiscard]] int evaluate(const Board &board);
+
+    // the accumulator of the current position, brought up to date if needed
+    [[nodiscard]] const Accumulator &current(const Board &board);
+
+private:
+    Accumulator  stack[NNUE_MAX_PLY + 1];
+    RefreshEntry cache[2][NNUE_KING_BUCKETS * 2];
+    int          top = 0;
+
+    void update(const Board &board, Color persp);
+    void refresh(const Board &board, Color persp);
+};
+
+class NNUE {
+public:
+    static void init();
+
+    // map a network file and use it directly from the page cache. if the
+    // file is invalid, the current network is kept and false is returned
+    static bool load(const std::string &path);
+
+    // switch back to the embedded (or bootstrap) network
+    static void load_default();
+
+    // write the parameters into a network file, which can be loaded later
+    static bool save(const std::string &path, const Network &network);
+
+    [[nodiscard]] static uint64_t checksum(const unsigned char *data, std::size_t size);
+
+    // evaluate the board from scratch (without any accumulator history). the
+    // score is returned in centipawns from the perspective of the side to move
+    [[nodiscard]] static int evaluate(const Board &board);
+
+    static void set_kernel(NNUEKernel kernel);
+    [[nodiscard]] static NNUEKernel best_kernel();
+    [[nodiscard]] static bool is_kernel_supported(NNUEKernel kernel);
+
+    // evaluate many unrelated positions at once (e.g. when scoring datasets). the
+    // positions are processed in blocks across the threads of the pool, out[i] is
+    // the score of boards[i]. boards without valid material (see
+    // Board::has_valid_material) are scored as zero. the scores include the
+    // endgame knowledge, so they match NNUE::evaluate
+    static void evaluate_batch(const Board *boards, std::size_t count, int16_t *out, ThreadPool &pool);
+
+    // measure evaluations per second of each supported kernel
+    static void bench();
+
+    // the output layer before scaling (the dot product of the clipped accumulators
+    // and the output weights), computed by the given kernel. all kernels must agree
+    [[nodiscard]] static int32_t output_sum(const int16_t *us, const int16_t *them, NNUEKernel kernel);
+
+private:
+    friend class AccumulatorStack;
+    friend class Trainer;
+
+    static const Network *net;
+    static NNUEKernel     kernel;
+    static MappedFile     file;
+
+    // return the parameters if the header and checksum are valid, null otherwise
+    [[nodiscard]] static const Network *validate(const unsigned char *data, std::size_t size);
+
+    [[nodiscard]] static uint8_t king_bucket(const Board &board, Color persp);
+    [[nodiscard]] static int feature_index(Color persp, uint8_t bucket, Color col, PieceType pt, uint8_t sq);
+
+    [[nodiscard]] static int output(const int16_t *us, const int16_t *them);
+
+    static void add_feature(int16_t *acc, const int16_t *w);
+    static void sub_feature(int16_t *acc, const int16_t *w);
+
+    static void evaluate_block(const Board *boards, int block_size, int16_t *out);
+
+    static void build_bootstrap_net(Network &network);
+};
+
+}
+
+#endif //NNUE_H
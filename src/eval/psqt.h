@@ -0,0 +1,90 @@
+#ifndef PSQT_H
+#define PSQT_H
+
+#include <cstdint>
+
+namespace Kreveta {
+
+// value of each piece on each square in centipawns, which the bootstrap network is
+// built from. the squares are relative to the owner of the piece (the first rank is
+// the owner's back rank) and the files are folded, so only the a-d files are stored.
+// this file can be regenerated from labeled positions by the Kreveta_2_tune tool
+constexpr int PSQT_SQUARES = 32;
+
+[[nodiscard]] constexpr int psqt_index(const uint8_t rel_sq) {
+    const int file = rel_sq & 7;
+    return (rel_sq >> 3) * 4 + (file < 4 ? file : 7 - file);
+}
+
+constexpr int16_t PSQT_VALUES[6][PSQT_SQUARES] = {
+    // pawn
+    {
+        104, 104, 104, 104,
+        104, 104, 104, 104,
+        104, 104, 104, 104,
+        104, 104, 104, 104,
+        104, 104, 104, 104,
+        104, 104, 104, 104,
+        104, 104, 104, 104,
+        104, 104, 104, 104,
+    },
+    // knight
+    {
+        312, 312, 312, 312,
+        312, 312, 312, 312,
+        312, 312, 312, 312,
+        312, 312, 312, 312,
+        312, 312, 312, 312,
+        312, 312, 312, 312,
+        312, 312, 312, 312,
+        312, 312, 312, 312,
+    },
+    // bishop
+    {
+        331, 331, 331, 331,
+        331, 331, 331, 331,
+        331, 331, 331, 331,
+        331, 331, 331, 331,
+        331, 331, 331, 331,
+        331, 331, 331, 331,
+        331, 331, 331, 331,
+        331, 331, 331, 331,
+    },
+    // rook
+    {
+        501, 501, 501, 501,
+        501, 501, 501, 501,
+        501, 501, 501, 501,
+        501, 501, 501, 501,
+        501, 501, 501, 501,
+        501, 501, 501, 501,
+        501, 501, 501, 501,
+        501, 501, 501, 501,
+    },
+    // queen
+    {
+        926, 926, 926, 926,
+        926, 926, 926, 926,
+        926, 926, 926, 926,
+        926, 926, 926, 926,
+        926, 926, 926, 926,
+        926, 926, 926, 926,
+        926, 926, 926, 926,
+        926, 926, 926, 926,
+    },
+    // king
+    {
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+          0,   0,   0,   0,
+    },
+};
+
+}
+
+#endif //PSQT_H
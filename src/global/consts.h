@@ -16,6 +16,11 @@ constexpr std::string_view FILES      = "abcdefgh";
 
 constexpr std::string_view STARTPOS_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+// a fixed set of positions from all stages of the game,
+// which is used to benchmark the engine reproducibly
+constexpr int BENCH_FEN_COUNT = 50;
+extern const std::string_view BENCH_FENS[BENCH_FEN_COUNT];
+
 extern const uint64_t REL_RANK_MASK[8];
 extern const uint64_t REL_FILE_MASK[8];
 
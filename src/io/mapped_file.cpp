@@ -0,0 +1,128 @@
+#include <utility>
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace Kreveta {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+
+#ifdef _WIN32
+        _mapping = std::exchange(other._mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path) {
+    close();
+
+    const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // the mapping keeps the file open, so we can close the handle right away
+    const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if (!mapping)
+        return false;
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    _data    = static_cast<const unsigned char *>(view);
+    _size    = static_cast<std::size_t>(size.QuadPart);
+    _mapping = mapping;
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data)    UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle(_mapping);
+
+    _data    = nullptr;
+    _size    = 0;
+    _mapping = nullptr;
+}
+
+// windows reads mapped files ahead on its own
+void MappedFile::advise_sequential() const {}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // the mapping keeps the file open, so we can close the descriptor right away
+    void *addr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (addr == MAP_FAILED)
+        return false;
+
+    _data = static_cast<const unsigned char *>(addr);
+    _size = static_cast<std::size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data)
+        munmap(const_cast<unsigned char *>(_data), _size);
+
+    _data = nullptr;
+    _size = 0;
+}
+
+void MappedFile::advise_sequential() const {
+    if (_data)
+        madvise(const_cast<unsigned char *>(_data), _size, MADV_SEQUENTIAL);
+}
+
+#endif
+
+}
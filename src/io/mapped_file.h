@@ -0,0 +1,46 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace Kreveta {
+
+// a read-only memory-mapped file. the pages are backed directly by the page
+// cache, so when multiple processes map the same file, they all share a single
+// copy of it in memory, and nothing has to be read before it's actually used
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &)            = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // map the whole file, the previously mapped file (if any) is unmapped
+    bool open(const std::string &path);
+    void close();
+
+    // hint that the file will be read from start to end, so the
+    // operating system can read ahead more aggressively
+    void advise_sequential() const;
+
+    [[nodiscard]] const unsigned char *data() const { return _data; }
+    [[nodiscard]] std::size_t          size() const { return _size; }
+    [[nodiscard]] bool            is_open() const { return _data != nullptr; }
+
+private:
+    const unsigned char *_data = nullptr;
+    std::size_t          _size = 0;
+
+#ifdef _WIN32
+    void *_mapping = nullptr;
+#endif
+};
+
+}
+
+#endif //MAPPED_FILE_H
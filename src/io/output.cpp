@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <utility>
+
+#include "output.h"
+
+namespace Kreveta {
+
+Output::Output(std::FILE *file) : Output([file](const std::string_view data) {
+    std::fwrite(data.data(), 1, data.size(), file);
+    std::fflush(file);
+}) {}
+
+Output::Output(Sink sink) : sink(std::move(sink)) {
+    buffer.reserve(1 << 16);
+    out.reserve(1 << 16);
+
+    writer = std::thread(&Output::writer_loop, this);
+}
+
+// static objects are destroyed after main returns, so whatever
+// the program logged last still gets written before it exits
+Output::~Output() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    line_ready.notify_all();
+    writer.join();
+}
+
+Output &Output::instance() {
+    static Output output(stdout);
+    return output;
+}
+
+void Output::write_line(const std::string_view line) {
+    instance().append(line, false);
+}
+
+void Output::write_progress(const std::string_view line) {
+    instance().append(line, true);
+}
+
+void Output::flush() {
+    instance().wait_written();
+}
+
+void Output::append(const std::string_view line, const bool is_progress) {
+    const bool info = line.starts_with("info");
+
+    {
+        std::lock_guard lock(mutex);
+
+        if (is_progress) {
+            progress.assign(line);
+            progress += '\n';
+        }
+        else {
+            buffer.append(line);
+            buffer += '\n';
+
+            // the progress line would be written after this one, which is newer
+            // (a finished iteration or search), so the progress line is outdated
+            progress.clear();
+        }
+
+        urgent |= !info;
+        appended++;
+    }
+
+    line_ready.notify_one();
+}
+
+void Output::wait_written() {
+    std::unique_lock lock(mutex);
+
+    const uint64_t target = appended;
+    urgent = true;
+    line_ready.notify_one();
+
+    written.wait(lock, [&] { return flushed >= target; });
+}
+
+void Output::writer_loop() {
+    std::unique_lock lock(mutex);
+
+    while (true) {
+        line_ready.wait(lock, [&] { return !buffer.empty() || !progress.empty() || urgent || stopping; });
+
+        // info lines wait a little, so more of them can be written at once
+        if (!urgent && !stopping)
+            line_ready.wait_for(lock, INFO_INTERVAL, [&] { return urgent || stopping; });
+
+        std::swap(buffer, out);
+        out += progress;
+        progress.clear();
+
+        const uint64_t target = appended;
+        urgent = false;
+
+        lock.unlock();
+
+        if (!out.empty()) {
+            sink(out);
+            out.clear();
+        }
+
+        lock.lock();
+
+        flushed = target;
+        written.notify_all();
+
+        if (stopping && buffer.empty() && progress.empty())
+            break;
+    }
+}
+
+}
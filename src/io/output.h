@@ -0,0 +1,79 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace Kreveta {
+
+// all standard output goes through a single writer thread. the other threads only
+// append their lines into a buffer, so a search never waits for a slow gui to read
+// the pipe. answers to commands (bestmove, readyok, ...) are written right away,
+// while info lines are collected and written together a few times per second
+class Output {
+public:
+
+    // how long info lines may wait before being written
+    static constexpr auto INFO_INTERVAL = std::chrono::milliseconds(50);
+
+    static void write_line(std::string_view line);
+
+    // progress lines (currmove, nodes, ...) only report the current state of the
+    // search, so a newer one replaces the older, which hasn't been written yet
+    static void write_progress(std::string_view line);
+
+    // waits until everything written so far has reached the standard output
+    static void flush();
+
+    // receives the lines (each ending with a newline) from the writer thread
+    using Sink = std::function<void(std::string_view data)>;
+
+    // the standard output is written by a single static writer,
+    // other writers are only created by the tests
+    explicit Output(std::FILE *file);
+    explicit Output(Sink sink);
+    ~Output();
+
+    void append(std::string_view line, bool is_progress);
+    void wait_written();
+
+private:
+    static Output &instance();
+
+    Sink sink;
+
+    std::mutex              mutex;
+    std::condition_variable line_ready;
+    std::condition_variable written;
+
+    // the producers append into one buffer, while the writer thread writes
+    // the other one, and they are swapped on every write
+    std::string buffer;
+    std::string out;
+
+    // only the latest progress line is kept, older ones
+    // would be outdated by the time they get written anyway
+    std::string progress;
+
+    // something else than an info line is waiting
+    bool urgent = false;
+
+    uint64_t appended = 0;
+    uint64_t flushed  = 0;
+    bool     stopping = false;
+
+    std::thread writer;
+
+    void writer_loop();
+};
+
+}
+
+#endif //OUTPUT_H
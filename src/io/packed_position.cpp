@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <format>
+
+#include "packed_position.h"
+
+#include "src/bitboard.h"
+#include "src/uci.h"
+
+namespace Kreveta {
+
+GameResult parse_game_result(const std::string_view token) {
+    if (token.contains("1/2-1/2") || token.contains("[0.5]"))                              return RESULT_DRAW;
+    if (token.contains("1-0")     || token.contains("[1.0]") || token.contains("[1]")) return RESULT_WHITE_WIN;
+    if (token.contains("0-1")     || token.contains("[0.0]") || token.contains("[0]")) return RESULT_BLACK_WIN;
+    return RESULT_UNKNOWN;
+}
+
+PackedPosition PackedPosition::pack(const Board &board, const int16_t score, const GameResult result,
+    const uint8_t halfmove, const uint16_t fullmove) {
+
+    PackedPosition packed{};
+
+    packed.occupancy     = board.occupied();
+    packed.score         = score;
+    packed.fullmove      = fullmove;
+    packed.halfmove      = halfmove;
+    packed.en_passant_sq = board.en_passant_sq;
+    packed.flags         = static_cast<uint8_t>(board.color | board.castling_rights << 1 | result << 5);
+
+    uint64_t occ = packed.occupancy;
+    for (int i = 0; occ; i++) {
+        const uint8_t sq  = ls1b_reset(occ);
+        const Color   col = is_bit_set(board.w_occupied, sq)
+            ? COL_WHITE : COL_BLACK;
+
+        const uint8_t nibble = col << 3 | board.piece_at(sq, col);
+        packed.pieces[i >> 1] |= i & 1
+            ? nibble << 4
+            : nibble;
+    }
+
+    return packed;
+}
+
+bool PackedPosition::is_valid() const {
+    if (popc(occupancy) > 32 || en_passant_sq > 64)
+        return false;
+
+    int kings[2] = { 0, 0 };
+
+    for (int i = 0; i < popc(occupancy); i++) {
+        const uint8_t nibble = i & 1
+            ? pieces[i >> 1] >> 4
+            : pieces[i >> 1] & 15;
+
+        if ((nibble & 7) >= PT_NONE)
+            return false;
+
+        if ((nibble & 7) == PT_KING)
+            kings[nibble >> 3]++;
+    }
+
+    return kings[COL_WHITE] == 1 && kings[COL_BLACK] == 1;
+}
+
+Board PackedPosition::to_board() const {
+    Board board;
+
+    uint64_t occ = occupancy;
+    for (int i = 0; occ && i < 32; i++) {
+        const uint8_t sq     = ls1b_reset(occ);
+        const uint8_t nibble = i & 1
+            ? pieces[i >> 1] >> 4
+            : pieces[i >> 1] & 15;
+
+        if ((nibble & 7) >= PT_NONE)
+            continue;
+
+        const auto col = static_cast<Color>(nibble >> 3);
+        board.pieces[col][nibble & 7] |= 1ULL << sq;
+    }
+
+    for (int pt = 0; pt < 6; pt++) {
+        board.w_occupied |= board.pieces[COL_WHITE][pt];
+        board.b_occupied |= board.pieces[COL_BLACK][pt];
+    }
+
+    board.color           = side();
+    board.castling_rights = flags >> 1 & CR_ALL;
+    board.en_passant_sq   = std::min<uint8_t>(en_passant_sq, 64);
+    board.halfmove_clock  = halfmove;
+    board.key             = board.compute_key();
+
+    return board;
+}
+
+bool PackedReader::open(const std::string &path) {
+    records = nullptr;
+    count   = 0;
+
+    if (!file.open(path)) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    // a partially written record means the file is damaged
+    if (file.size() % sizeof(PackedPosition)) {
+        UCI::log(std::format("'{}' is not a packed position file", path));
+        file.close();
+        return false;
+    }
+
+    file.advise_sequential();
+
+    records = reinterpret_cast<const PackedPosition *>(file.data());
+    count   = file.size() / sizeof(PackedPosition);
+    return true;
+}
+
+bool PackedWriter::open(const std::string &path, const bool append) {
+    stream.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+
+    if (!stream) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    buffer.reserve(BUFFER_SIZE);
+    written = 0;
+    return true;
+}
+
+void PackedWriter::write(const PackedPosition &packed) {
+    buffer.push_back(packed);
+
+    if (buffer.size() == BUFFER_SIZE)
+        flush();
+}
+
+bool PackedWriter::flush() {
+    if (!stream.is_open())
+        return false;
+
+    stream.write(reinterpret_cast<const char *>(buffer.data()),
+        static_cast<std::streamsize>(buffer.size() * sizeof(PackedPosition)));
+    stream.flush();
+
+    written += buffer.size();
+    buffer.clear();
+
+    return static_cast<bool>(stream);
+}
+
+}
@@ -0,0 +1,124 @@
+#ifndef PACKED_POSITION_H
+#define PACKED_POSITION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+#include "src/board.h"
+
+namespace Kreveta {
+
+// game results stored in the packed positions (always from white's point of view)
+enum GameResult : uint8_t {
+    RESULT_BLACK_WIN = 0,
+    RESULT_DRAW      = 1,
+    RESULT_WHITE_WIN = 2,
+
+    RESULT_UNKNOWN   = 3
+};
+
+// the game result may be written in a few different ways after the position. we
+// accept the PGN-style results (usually in a "c9" EPD operation) and the results
+// in square brackets, which many training data formats use
+[[nodiscard]] GameResult parse_game_result(std::string_view token);
+
+// a position stored in 32 bytes, which is how training data is kept on disk. the
+// occupancy bitboard tells us where the pieces are, and the pieces themselves are
+// stored as 4-bit nibbles (color << 3 | piece type) in the order of the set bits.
+// a legal position has at most 32 pieces, so the nibbles always fit into 16 bytes
+struct PackedPosition {
+    uint64_t occupancy;
+    uint8_t  pieces[16];
+
+    // the score is in centipawns from white's point of view
+    int16_t  score;
+    uint16_t fullmove;
+    uint8_t  halfmove;
+    uint8_t  en_passant_sq;
+
+    // bit 0 is the side to move, bits 1-4 are the castling rights
+    // and bits 5-6 are the game result
+    uint8_t  flags;
+    uint8_t  reserved;
+
+    [[nodiscard]] static PackedPosition pack(const Board &board, int16_t score, GameResult result,
+        uint8_t halfmove = 0, uint16_t fullmove = 1);
+
+    // a record read from a file may be damaged, so it should be checked before it's
+    // unpacked. it must have at most 32 pieces of valid types and a king of each color
+    [[nodiscard]] bool is_valid() const;
+
+    // invalid pieces are left out, so even a damaged record never writes out of the board
+    [[nodiscard]] Board to_board() const;
+
+    [[nodiscard]] Color side() const {
+        return static_cast<Color>(flags & 1);
+    }
+
+    [[nodiscard]] GameResult result() const {
+        return static_cast<GameResult>(flags >> 5 & 3);
+    }
+
+    // the result is usually only known after the position was packed
+    void set_result(const GameResult result) {
+        flags = static_cast<uint8_t>((flags & ~(3 << 5)) | result << 5);
+    }
+};
+
+static_assert(sizeof(PackedPosition) == 32, "packed positions must be exactly 32 bytes");
+
+// iterates a file of packed positions without copying or parsing anything. the
+// records are read directly from the mapped pages, and the operating system takes
+// care of reading the file ahead, so the datasets can be far larger than memory.
+// the records aren't validated while opening, the users skip the invalid ones
+class PackedReader {
+public:
+    bool open(const std::string &path);
+
+    [[nodiscard]] std::size_t size() const { return count; }
+
+    [[nodiscard]] const PackedPosition &operator[](const std::size_t i) const { return records[i]; }
+
+    [[nodiscard]] const PackedPosition *begin() const { return records; }
+    [[nodiscard]] const PackedPosition *end()   const { return records + count; }
+
+private:
+    MappedFile            file;
+    const PackedPosition *records = nullptr;
+    std::size_t           count   = 0;
+};
+
+// collects positions in memory and writes them in large blocks. every writer owns
+// its own file, so multiple threads can write at once without any locking
+class PackedWriter {
+public:
+    PackedWriter() = default;
+    ~PackedWriter() { flush(); }
+
+    PackedWriter(const PackedWriter &)            = delete;
+    PackedWriter &operator=(const PackedWriter &) = delete;
+
+    bool open(const std::string &path, bool append = false);
+
+    void write(const PackedPosition &packed);
+    bool flush();
+
+    // the number of positions written (including the buffered ones)
+    [[nodiscard]] std::size_t size() const { return written + buffer.size(); }
+
+private:
+    static constexpr std::size_t BUFFER_SIZE = 1 << 16;
+
+    std::ofstream               stream;
+    std::vector<PackedPosition> buffer;
+    std::size_t                 written = 0;
+};
+
+}
+
+#endif //PACKED_POSITION_H
@@ -3,23 +3,38 @@
 //
 
 #include <format>
-#include <iostream>
+#include <string_view>
+#include <vector>
 
+#include "cli.h"
 #include "uci.h"
 #include "position.h"
+#include "eval/endgame.h"
+#include "eval/kpk.h"
+#include "eval/nnue.h"
 #include "movegen/movetables.h"
 
-int main(const int argc, [[maybe_unused]] char *argv[]) {
+int main(const int argc, char *argv[]) {
     using namespace Kreveta;
 
-    // the first token is always the name
-    if (argc > 1) {
-        std::cout << "Command line arguments are not supported" << std::endl;
-    }
-
     // initialize move lookup arrays
     MoveTables::init();
 
+    // the bitbase is generated using the move tables
+    KPK::init();
+    Endgames::init();
+
+    // load the embedded network and pick the fastest kernel. another
+    // network file can be mapped later through the EvalFile option
+    NNUE::init();
+
+    // the first token is always the name. any other tokens
+    // mean we are running one of the command line tools
+    if (argc > 1) {
+        const std::vector<std::string_view> args(argv + 1, argv + argc);
+        return CLI::run(args);
+    }
+
     // to avoid bugs, we have the startpos from the beginning
     Position::set_startpos({});
 
@@ -2,9 +2,11 @@
 // Created by michn on 5/11/2025.
 //
 
+#include <cctype>
 #include <string>
 
 #include "move.h"
+#include "movegen.h"
 
 #include "../global/consts.h"
 #include "src/board.h"
@@ -108,4 +110,95 @@ std::string_view Move::to_str(const Move move) {
     return { std::string_view(buffer, len) };
 }
 
+Move Move::san_to_move(std::string_view san, const Board &context) {
+
+    // check and annotation marks don't matter
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?'))
+        san.remove_suffix(1);
+
+    if (san.size() < 2)
+        return {};
+
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(context, moves);
+
+    // castling is marked by the king's move, which is stored as a promotion to a king
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        const bool kingside = san.size() == 3;
+
+        for (int i = 0; i < count; i++) {
+            if (moves[i].promotion() == PT_KING && (moves[i].end() > moves[i].start()) == kingside)
+                return moves[i];
+        }
+
+        return {};
+    }
+
+    PieceType piece = PT_PAWN;
+    PieceType prom  = PT_NONE;
+
+    if (const std::size_t i = PIECES.find(static_cast<char>(std::tolower(san[0]))); std::isupper(static_cast<unsigned char>(san[0])) && i != std::string_view::npos) {
+        piece = static_cast<PieceType>(i);
+        san.remove_prefix(1);
+    }
+
+    // promotions are usually written as "e8=Q", but sometimes without the "="
+    if (piece == PT_PAWN && san.size() >= 3 && std::isupper(static_cast<unsigned char>(san.back()))) {
+        const std::size_t i = PIECES.find(static_cast<char>(std::tolower(san.back())));
+        if (i == std::string_view::npos || i == PT_PAWN || i == PT_KING)
+            return {};
+
+        prom = static_cast<PieceType>(i);
+        san.remove_suffix(1);
+
+        if (san.back() == '=')
+            san.remove_suffix(1);
+    }
+
+    if (san.size() < 2)
+        return {};
+
+    // the target square is always at the end, and anything before
+    // it (except the capture mark) is used to tell the pieces apart
+    const char file = san[san.size() - 2];
+    const char rank = san[san.size() - 1];
+
+    if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+        return {};
+
+    const uint8_t target = static_cast<uint8_t>((8 - (rank - '0')) * 8 + (file - 'a'));
+
+    int from_file = -1;
+    int from_rank = -1;
+
+    for (const char c : san.substr(0, san.size() - 2)) {
+        if      (c >= 'a' && c <= 'h') from_file = c - 'a';
+        else if (c >= '1' && c <= '8') from_rank = 8 - (c - '0');
+        else if (c != 'x' && c != ':' && c != '-')
+            return {};
+    }
+
+    Move found;
+    int  matches = 0;
+
+    for (int i = 0; i < count; i++) {
+        const Move m = moves[i];
+
+        if (m.piece() != piece || m.end() != target)
+            continue;
+
+        if (prom != PT_NONE ? m.promotion() != prom : m.is_promotion())
+            continue;
+
+        if ((from_file != -1 && (m.start() & 7) != from_file)
+         || (from_rank != -1 && (m.start() >> 3) != from_rank))
+            continue;
+
+        found = m;
+        matches++;
+    }
+
+    return matches == 1 ? found : Move();
+}
+
 }
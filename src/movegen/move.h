@@ -64,8 +64,35 @@ struct Move {
         return static_cast<PieceType>((_flags & PROM_MASK) >> PROM_OFFSET);
     }
 
+    // en passant doesn't land on the captured pawn, so it's marked by the promotion
+    __forceinline bool is_capture() const noexcept {
+        return capture() != PT_NONE || promotion() == PT_PAWN;
+    }
+
+    // castling and en passant are also stored as promotions, so they must be excluded
+    __forceinline bool is_promotion() const noexcept {
+        return promotion() >= PT_KNIGHT && promotion() <= PT_QUEEN;
+    }
+
+    // the raw flags, which allow storing the move in the transposition table
+    [[nodiscard]]
+    __forceinline constexpr uint32_t raw() const noexcept {
+        return _flags;
+    }
+
+    static constexpr Move from_raw(const uint32_t raw) {
+        Move move;
+        move._flags = raw;
+        return move;
+    }
+
     static bool is_valid_format(const std::string_view &move);
     static Move str_to_move(const std::string_view &move, const Board &context);
+
+    // find the legal move in the position matching the move in Standard Algebraic
+    // Notation (e.g. "Nbd7", "exd5", "O-O", "e8=Q+"). returns a null move if there
+    // isn't exactly one such move
+    static Move san_to_move(std::string_view san, const Board &context);
     static std::string_view to_str(Move move);
 
 private:
@@ -6,25 +6,109 @@
 
 #include "movetables.h"
 #include "src/bitboard.h"
+#include "src/stats.h"
+#include "src/trace.h"
 
 namespace Kreveta {
 
-Move pseudo_legal_buffer[PL_BUFFER_SIZE];
-int  cur_pl;
+thread_local Move pseudo_legal_buffer[PL_BUFFER_SIZE];
+thread_local int  cur_pl;
 
-int Movegen::get_legal_moves(Board &board, Move *moves, bool only_captures) {
+int Movegen::get_legal_moves(const Board &board, Move *moves, const bool only_captures) {
     cur_pl = 0;
-    generate_pseudo_legal_moves(board, board.color);
+    generate_pseudo_legal_moves(board, board.color, only_captures);
 
+    // a pseudolegal move is legal if it doesn't leave our own king in check
     int legal_count = 0;
     for (int i = 0; i < cur_pl; i++) {
-        *(moves + legal_count++) = pseudo_legal_buffer[i];
+        if (board.is_move_legal(pseudo_legal_buffer[i], board.color))
+            *(moves + legal_count++) = pseudo_legal_buffer[i];
     }
 
+    STATS_INC(STAT_MOVEGEN_CALLS);
+    STATS_ADD(STAT_MOVES_GENERATED, legal_count);
+
     return legal_count;
 }
 
-void Movegen::generate_pseudo_legal_moves(const Board &board, const Color color) {
+int Movegen::get_legal_checks(const Board &board, Move *moves) {
+    cur_pl = 0;
+    generate_pseudo_legal_moves(board, board.color, false);
+
+    // most moves aren't checks, and that is much cheaper to find out than legality
+    int check_count = 0;
+    for (int i = 0; i < cur_pl; i++) {
+        const Move move = pseudo_legal_buffer[i];
+
+        if (gives_check(board, move) && board.is_move_legal(move, board.color))
+            moves[check_count++] = move;
+    }
+
+    return check_count;
+}
+
+// the attacks are found from the king's square with the pieces and occupancy after
+// the move, which covers both direct and discovered checks without copying the board
+bool Movegen::gives_check(const Board &board, const Move move) {
+    const Color     color = board.color;
+    const Color     opp   = col_flip(color);
+    const PieceType prom  = move.promotion();
+
+    // castling and en passant move more than one piece, and they are rare enough to simply be played
+    if (prom == PT_PAWN || prom == PT_KING) {
+        Board child = board.clone();
+        child.play_move(move);
+
+        return is_in_check(child, opp);
+    }
+
+    const uint64_t start = 1ULL << move.start();
+    const uint64_t end   = 1ULL << move.end();
+    const uint64_t occ   = (board.occupied() ^ start) | end;
+    const uint64_t king  = board.pieces[opp][PT_KING];
+
+    uint64_t att[6];
+    for (int i = 0; i < 6; i++)
+        att[i] = board.pieces[color][i];
+
+    att[move.piece()] ^= start;
+    att[move.is_promotion() ? prom : move.piece()] |= end;
+
+    if (MoveTables::get_knight_targets(king, att[PT_KNIGHT]))             return true;
+    if (MoveTables::get_pawn_capt_targets(king, att[PT_PAWN], 64, opp))  return true;
+
+    if (MoveTables::get_bishop_targets(king, att[PT_BISHOP] | att[PT_QUEEN], occ)) return true;
+    if (MoveTables::get_rook_targets(king, att[PT_ROOK] | att[PT_QUEEN], occ))     return true;
+
+    return false;
+}
+
+bool Movegen::is_square_attacked(const Board &board, const uint8_t sq, const Color attacker) {
+    const uint64_t square = 1ULL << sq;
+    const uint64_t occ    = board.occupied();
+
+    const uint64_t *att = board.pieces[attacker];
+
+    // we place each piece type on the square and look whether it can reach the same
+    // piece type of the attacker, since all moves except pawn pushes are symmetric.
+    // pawns capture in opposite directions, so we use the captures of our own color
+    if (MoveTables::get_knight_targets(square, att[PT_KNIGHT])) return true;
+    if (MoveTables::get_king_targets(square, att[PT_KING]))     return true;
+
+    if (MoveTables::get_pawn_capt_targets(square, att[PT_PAWN], 64, col_flip(attacker)))
+        return true;
+
+    if (MoveTables::get_bishop_targets(square, att[PT_BISHOP] | att[PT_QUEEN], occ)) return true;
+    if (MoveTables::get_rook_targets(square, att[PT_ROOK] | att[PT_QUEEN], occ))     return true;
+
+    return false;
+}
+
+bool Movegen::is_in_check(const Board &board, const Color color) {
+    return is_square_attacked(board, ls1b(board.pieces[color][PT_KING]), col_flip(color));
+}
+
+void Movegen::generate_pseudo_legal_moves(const Board &board, const Color color, const bool only_captures) {
 
     // all occupied squares and squares occupied by opponent
     const uint64_t occupied = board.occupied();
@@ -42,15 +126,50 @@ void Movegen::generate_pseudo_legal_moves(const Board &board, const Color color)
         loop_pieces_bb(board,
             static_cast<PieceType>(i), color,
             board.pieces[color][i],
-            occupied_opp, occupied, empty, free);
+            occupied_opp, occupied, empty, free,
+            only_captures);
     }
 
+    if (!only_captures)
+        generate_castling_moves(board, color);
+}
+
+void Movegen::generate_castling_moves(const Board &board, const Color color) {
+    const CastlingRights kingside  = color == COL_WHITE ? CR_W_KINGSIDE  : CR_B_KINGSIDE;
+    const CastlingRights queenside = color == COL_WHITE ? CR_W_QUEENSIDE : CR_B_QUEENSIDE;
+
+    if (!board.has_castling_right(kingside) && !board.has_castling_right(queenside))
+        return;
+
+    // the king and rooks are on the same squares for both colors,
+    // just on a different rank
+    const uint8_t  king  = color == COL_WHITE ? 60 : 4;
+    const uint64_t rooks = board.pieces[color][PT_ROOK];
+    const uint64_t occ   = board.occupied();
+    const Color    opp   = col_flip(color);
+
     // castling when in check is illegal
-    //if (IsKingInCheck(board, col))
-    //    return;
+    if (!is_bit_set(board.pieces[color][PT_KING], king) || is_square_attacked(board, king, opp))
+        return;
+
+    // the squares between the king and the rook must be empty, and the king must
+    // not pass through an attacked square. the target square itself is checked
+    // by the legality test of all moves
+    if (board.has_castling_right(kingside)
+        && is_bit_set(rooks, king + 3)
+        && !(occ & (3ULL << (king + 1)))
+        && !is_square_attacked(board, king + 1, opp)) {
+
+        add_move_to_buffer(PT_NONE, color, PT_NONE, king, king + 2, 64);
+    }
+
+    if (board.has_castling_right(queenside)
+        && is_bit_set(rooks, king - 4)
+        && !(occ & (7ULL << (king - 3)))
+        && !is_square_attacked(board, king - 1, opp)) {
 
-    //ulong cast = King.GetCastlingTargets(board, col);
-    //LoopTargets(board, BB.LS1B(board.Pieces[(byte)col][(byte)PType.KING]), cast, PType.NONE, col);
+        add_move_to_buffer(PT_NONE, color, PT_NONE, king, king - 2, 64);
+    }
 }
 
 void Movegen::loop_pieces_bb(
@@ -108,20 +227,25 @@ uint64_t Movegen::get_targets(
     const uint64_t  free,
     const bool      only_captures) {
 
+    // when generating captures only, the pieces can only land on enemy pieces
+    const uint64_t allowed = only_captures
+        ? occ_opp
+        : free;
+
     // return a bitboard of possible moves depending on the piece type
     switch (type) {
         case PT_PAWN: return (only_captures ? 0ULL
             : MoveTables::get_pawn_push_targets(sq, empty, color))
             | MoveTables::get_pawn_capt_targets(sq, occ_opp, board.en_passant_sq, color);
 
-        case PT_KNIGHT: return MoveTables::get_knight_targets(sq, free);
-        case PT_BISHOP: return MoveTables::get_bishop_targets(sq, free, occ);
-        case PT_ROOK:   return MoveTables::get_rook_targets(sq, free, occ);
+        case PT_KNIGHT: return MoveTables::get_knight_targets(sq, allowed);
+        case PT_BISHOP: return MoveTables::get_bishop_targets(sq, allowed, occ);
+        case PT_ROOK:   return MoveTables::get_rook_targets(sq, allowed, occ);
 
-        case PT_QUEEN:  return MoveTables::get_bishop_targets(sq, free, occ)
-                             | MoveTables::get_rook_targets(sq, free, occ);
+        case PT_QUEEN:  return MoveTables::get_bishop_targets(sq, allowed, occ)
+                             | MoveTables::get_rook_targets(sq, allowed, occ);
 
-        case PT_KING:   return MoveTables::get_king_targets(sq, free);
+        case PT_KING:   return MoveTables::get_king_targets(sq, allowed);
         default: return 0ULL;
     }
 }
@@ -9,19 +9,39 @@
 
 namespace Kreveta {
 
-// pseudolegal moves are stored in a buffer to avoid repeated allocations
-constexpr int PL_BUFFER_SIZE = 128;
-extern Move pseudo_legal_buffer[PL_BUFFER_SIZE];
-extern int  cur_pl;
+// the maximum number of legal moves in any position is 218,
+// so any move list of this size can never overflow
+constexpr int MAX_MOVES = 256;
+
+// pseudolegal moves are stored in a buffer to avoid repeated allocations. each
+// thread has its own buffer, so multiple searches can generate moves at once
+constexpr int PL_BUFFER_SIZE = MAX_MOVES;
+extern thread_local Move pseudo_legal_buffer[PL_BUFFER_SIZE];
+extern thread_local int  cur_pl;
 
 class Movegen {
 public:
 
     [[nodiscard]]
-    static int get_legal_moves(Board &board, Move* moves, bool only_captures = false);
+    static int get_legal_moves(const Board &board, Move* moves, bool only_captures = false);
+
+    // only the legal moves, which give check (the attacker's moves in mate searches)
+    [[nodiscard]]
+    static int get_legal_checks(const Board &board, Move* moves);
+
+    // whether the pseudolegal move attacks the opponent's king
+    [[nodiscard]]
+    static bool gives_check(const Board &board, Move move);
+
+    [[nodiscard]]
+    static bool is_square_attacked(const Board &board, uint8_t sq, Color attacker);
+
+    [[nodiscard]]
+    static bool is_in_check(const Board &board, Color color);
 
 private:
-    static void generate_pseudo_legal_moves(const Board &board, Color color);
+    static void generate_pseudo_legal_moves(const Board &board, Color color, bool only_captures);
+    static void generate_castling_moves(const Board &board, Color color);
 
     static void loop_pieces_bb(
         const Board &board,
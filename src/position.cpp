@@ -2,7 +2,9 @@
 // Created by michn on 5/12/2025.
 //
 
+#include <algorithm>
 #include <format>
+#include <span>
 
 #include "position.h"
 
@@ -16,17 +18,121 @@ namespace Kreveta {
 
 Board Position::board;
 Color Position::engine_color;
+std::vector<uint64_t> Position::history;
+std::string           Position::applied_base;
+std::string           Position::applied_moves;
+
+// the number of tokens matching the space-separated words of the string, or -1
+// if some word doesn't match, or there are more words than tokens
+static int match_prefix(std::string_view joined, const std::span<const std::string_view> tokens) {
+    int count = 0;
+
+    while (!joined.empty()) {
+        if (count >= static_cast<int>(tokens.size()))
+            return -1;
+
+        const std::string_view token = tokens[count];
+        if (!joined.starts_with(token) || (joined.size() > token.size() && joined[token.size()] != ' '))
+            return -1;
+
+        joined.remove_prefix(std::min(joined.size(), token.size() + 1));
+        count++;
+    }
+
+    return count;
+}
+
+// the tokens between the command name and "moves", and the tokens after "moves"
+static std::span<const std::string_view> base_tokens(const std::vector<std::string_view> &tokens) {
+    const auto moves = std::ranges::find(tokens, "moves");
+    return { tokens.begin() + 1, moves };
+}
+
+static std::span<const std::string_view> move_tokens(const std::vector<std::string_view> &tokens) {
+    const auto moves = std::ranges::find(tokens, "moves");
+    return moves == tokens.end()
+        ? std::span<const std::string_view>()
+        : std::span<const std::string_view>(moves + 1, tokens.end());
+}
+
+bool Position::try_extend(const std::vector<std::string_view> &tokens) {
+    if (tokens.size() < 2 || applied_base.empty())
+        return false;
+
+    const auto base  = base_tokens(tokens);
+    const auto moves = move_tokens(tokens);
+
+    if (match_prefix(applied_base, base) != static_cast<int>(base.size()))
+        return false;
+
+    const int applied = match_prefix(applied_moves, moves);
+    if (applied < 0)
+        return false;
+
+    // the new moves are played directly, and everything is
+    // restored if one of them turns out to be invalid
+    Board new_board = board;
+    const std::size_t history_size = history.size();
+
+    for (std::size_t i = applied; i < moves.size(); i++) {
+        if (!Move::is_valid_format(moves[i])) {
+            UCI::log(std::format("Invalid move '{}'", moves[i]));
+            history.resize(history_size);
+            return true;
+        }
+
+        history.push_back(new_board.key);
+        new_board.play_move(Move::str_to_move(moves[i], new_board));
+    }
+
+    board        = new_board;
+    engine_color = new_board.color;
+
+    for (std::size_t i = applied; i < moves.size(); i++) {
+        if (!applied_moves.empty()) applied_moves += ' ';
+        applied_moves += moves[i];
+    }
+
+    return true;
+}
+
+void Position::remember(const std::vector<std::string_view> &tokens) {
+    applied_base.clear();
+    applied_moves.clear();
+
+    if (tokens.size() < 2)
+        return;
+
+    for (const auto token : base_tokens(tokens)) {
+        if (!applied_base.empty()) applied_base += ' ';
+        applied_base += token;
+    }
+
+    for (const auto token : move_tokens(tokens)) {
+        if (!applied_moves.empty()) applied_moves += ' ';
+        applied_moves += token;
+    }
+}
 
 void Position::set_startpos(const std::vector<std::string_view> &tokens) {
+    if (try_extend(tokens))
+        return;
+
     auto new_board = Board::make_startpos();
+    std::vector<uint64_t> new_history;
 
-    if (try_play_moves(tokens, new_board)) {
+    if (try_play_moves(tokens, new_board, new_history)) {
         board        = new_board.clone();
         engine_color = new_board.color;
+        history      = std::move(new_history);
+
+        remember(tokens);
     }
 }
 
 void Position::set_position_fen(const std::vector<std::string_view> &tokens) {
+    if (try_extend(tokens))
+        return;
 
     // if something is missing, we return immediately instead of wasting time
     if (const auto size = tokens.size(); size < 6) {
@@ -34,17 +140,43 @@ void Position::set_position_fen(const std::vector<std::string_view> &tokens) {
         return;
     }
 
-    // we don't want to modify Position::board right away in case something goes wrong
+    // we don't want to modify Position::board right away in case something goes wrong.
+    // the first two tokens are always 'position fen', so we skip them
     Board new_board;
+    if (!try_parse_fen(std::span(tokens).subspan(2), new_board)) {
+        return;
+    }
+
+    // the fen string can be followed by a sequence of moves, which have
+    // been played from the position. for example, most GUIs would pass
+    // a position like "position startpos moves e2e4 e7e5 g1f3"
+    std::vector<uint64_t> new_history;
+    if (!try_play_moves(tokens, new_board, new_history)) {
+        return;
+    }
+
+    // only after we made sure that all arguments were passed
+    // correctly, we change the actual board state. if we did
+    // it directly, then the board state would become corrupt
+    // after the user set an incorrect position
+    board        = new_board;
+    engine_color = new_board.color;
+    history      = std::move(new_history);
+
+    remember(tokens);
+}
 
-    // the first two tokens are always 'position fen', so when I refer to the "first"
-    // token, I am in fact talking about the third token.
+bool Position::try_parse_fen(const std::span<const std::string_view> fields, Board &new_board) {
+    if (fields.size() < 4) {
+        UCI::log("Incomplete or invalid FEN");
+        return false;
+    }
 
-    // the first token is the actual position. all ranks are separated by a "/". between
+    // the first field is the actual position. all ranks are separated by a "/". between
     // the slashes, pieces may be denoted with the simple "pnbrqk" or the uppercase variants
     // for white. empty squares between pieces are marked by a single digit (1-8)
-    for (int i = 0, sq = 0; i < tokens[2].size(); i++) {
-        const char c = tokens[2][i];
+    for (int i = 0, sq = 0; i < fields[0].size(); i++) {
+        const char c = fields[0][i];
 
         // increase the square counter (empty squares)
         if (std::isdigit(c)) {
@@ -62,7 +194,13 @@ void Position::set_position_fen(const std::vector<std::string_view> &tokens) {
 
             // if the character is neither a digit, piece nor slash, it's incorrect
             UCI::log(std::format("Invalid character in FEN '{}'", c));
-            return;
+            return false;
+        }
+
+        // too many pieces or empty squares on the ranks
+        if (sq >= 64) {
+            UCI::log("Invalid piece placement in FEN");
+            return false;
         }
 
         // uppercase characters represent white color
@@ -80,25 +218,26 @@ void Position::set_position_fen(const std::vector<std::string_view> &tokens) {
         sq++;
     }
 
-    // the second token tells us, which color's turn it is. "w" means white,
+    // the second field tells us, which color's turn it is. "w" means white,
     // "b" means black. the actual color to play may be still modified by the
     // moves played from this position, though
-    switch (const char c = tokens[3][0]) {
+    switch (const char c = fields[1][0]) {
         case 'w': new_board.color = COL_WHITE; break;
         case 'b': new_board.color = COL_BLACK; break;
 
         default: {
             UCI::log(std::format("Invalid color '{}'", c));
-            return;
+            return false;
         };
     }
 
-    // the third token marks, which sides still have their castling rights. if neither
+    // the third field marks, which sides still have their castling rights. if neither
     // side can castle, this is a dash. otherwise, the characters may be "k" or "q" for
     // kingside and queenside castling respectively, or once again uppercase for white.
     // just to clarify, this has nothing to do with the legality of castling in the
     // next move, this only denotes the castling rights availability.
-    for (const char c : tokens[4]) {
+    new_board.castling_rights = CR_NONE;
+    for (const char c : fields[2]) {
         switch (c) {
             case 'K': new_board.add_castling_right(CR_W_KINGSIDE);  break;
             case 'Q': new_board.add_castling_right(CR_W_QUEENSIDE); break;
@@ -108,42 +247,40 @@ void Position::set_position_fen(const std::vector<std::string_view> &tokens) {
             case '-': break;
             default: {
                 UCI::log(std::format("Invalid castling availability '{}'", c));
-                return;
+                return false;
             }
         }
     }
 
-    // the fourth token is the en passant square, which is the square over which
+    // the fourth field is the en passant square, which is the square over which
     // a double-pushing pawn has passed in the previous move, regardless of whether
     // there is another pawn to capture en passant. if no pawn double-pushed, this
-    // is also simply a dash.
-    if (int en_passant_sq; try_parse(tokens[5], en_passant_sq)) {
+    // is also simply a dash. the square is usually written as a regular square name
+    // (e.g. "e3"), but we also accept the square index directly
+    if (const auto ep = fields[3]; ep.size() == 2
+        && ep[0] >= 'a' && ep[0] <= 'h'
+        && (ep[1] == '3' || ep[1] == '6')) {
+        new_board.en_passant_sq = static_cast<uint8_t>((8 - (ep[1] - '0')) * 8 + (ep[0] - 'a'));
+    }
+    else if (int en_passant_sq; try_parse(fields[3], en_passant_sq) && en_passant_sq >= 0 && en_passant_sq < 64) {
         new_board.en_passant_sq = static_cast<uint8_t>(en_passant_sq);
     }
-    else if (tokens[5] != "-") {
-        UCI::log(std::format("Invalid en passant square '{}'", tokens[5]));
-        return;
+    else if (fields[3] != "-") {
+        UCI::log(std::format("Invalid en passant square '{}'", fields[3]));
+        return false;
     }
 
-    // after these tokens may also follow a fullmove and halfmove clock,
-    // but we don't need this information for anything
-
-    // the fen string can be followed by a sequence of moves, which have
-    // been played from the position. for example, most GUIs would pass
-    // a position like "position startpos moves e2e4 e7e5 g1f3"
-    if (!try_play_moves(tokens, new_board)) {
-        return;
+    // after these fields may also follow the halfmove and fullmove clocks. we only
+    // need the halfmove clock for the fifty-move rule, and it's optional
+    if (int halfmove; fields.size() > 4 && try_parse(fields[4], halfmove)) {
+        new_board.halfmove_clock = static_cast<uint8_t>(std::clamp(halfmove, 0, 255));
     }
 
-    // only after we made sure that all arguments were passed
-    // correctly, we change the actual board state. if we did
-    // it directly, then the board state would become corrupt
-    // after the user set an incorrect position
-    board        = new_board;
-    engine_color = new_board.color;
+    new_board.key = new_board.compute_key();
+    return true;
 }
 
-bool Position::try_play_moves(const std::vector<std::string_view> &tokens, Board &new_board) {
+bool Position::try_play_moves(const std::vector<std::string_view> &tokens, Board &new_board, std::vector<uint64_t> &keys) {
     const auto iterator = std::ranges::find(tokens, "moves");
 
     // if no moves follow up
@@ -159,6 +296,8 @@ bool Position::try_play_moves(const std::vector<std::string_view> &tokens, Board
             return false;
         }
 
+        // remember the position before the move for repetition detection
+        keys.push_back(new_board.key);
         new_board.play_move(Move::str_to_move(tokens[i], new_board));
     }
 
@@ -5,6 +5,9 @@
 #ifndef POSITION_H
 #define POSITION_H
 
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "board.h"
@@ -17,9 +20,27 @@ public:
     static Board board;
     static Color engine_color;
 
+    // keys of all positions played before the current one (for repetitions)
+    static std::vector<uint64_t> history;
+
     static void set_startpos(const std::vector<std::string_view> &tokens);
     static void set_position_fen(const std::vector<std::string_view> &tokens);
-    static bool try_play_moves(const std::vector<std::string_view> &tokens, Board &new_board);
+
+    // parse the FEN fields (placement, color, castling, en passant) into a board
+    static bool try_parse_fen(std::span<const std::string_view> fields, Board &new_board);
+    static bool try_play_moves(const std::vector<std::string_view> &tokens, Board &new_board, std::vector<uint64_t> &keys);
+
+private:
+
+    // the starting position ("startpos" or "fen ...") and the moves of the last
+    // position command, joined by spaces. guis send the whole game on every move,
+    // so usually only the moves played since the last command need to be played
+    static std::string applied_base;
+    static std::string applied_moves;
+
+    // returns false if the command doesn't extend the last one
+    static bool try_extend(const std::vector<std::string_view> &tokens);
+    static void remember(const std::vector<std::string_view> &tokens);
 };
 
 }
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <string>
+
+#include "bench.h"
+#include "smp.h"
+
+#include "src/position.h"
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/global/consts.h"
+
+namespace Kreveta {
+
+bool Bench::run(const std::span<const std::string_view> args) {
+    int depth   = DEFAULT_DEPTH;
+    int threads = DEFAULT_THREADS;
+    int hash    = DEFAULT_HASH;
+
+    if ((args.size() > 1 && (!try_parse(args[1], depth)   || depth   < 1 || depth   >= MAX_PLY))
+     || (args.size() > 2 && (!try_parse(args[2], threads) || threads < 1 || threads > 1024))
+     || (args.size() > 3 && (!try_parse(args[3], hash)    || hash    < 1 || hash    > 65536))) {
+        UCI::log("Usage: bench [depth] [threads] [hash]");
+        return false;
+    }
+
+    (void)run(depth, threads, hash);
+    return true;
+}
+
+uint64_t Bench::run(const int depth, const int threads, const int hash_mb) {
+    TranspositionTable tt(hash_mb);
+    LazySMP smp(tt, threads);
+
+    smp.set_silent(true);
+
+    // the tables loaded through SyzygyPath change the search, so the uci
+    // command and the command line tool would print different signatures
+    smp.set_tablebases(false);
+
+    SearchLimits limits;
+    limits.depth = depth;
+
+    uint64_t total_nodes = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+        const std::string fen(BENCH_FENS[i]);
+
+        Board board;
+        if (!Position::try_parse_fen(str_split(fen), board)) {
+            UCI::log(std::format("Invalid bench position '{}'", fen));
+            continue;
+        }
+
+        // nothing from the previous position may affect the search
+        tt.clear();
+        smp.clear();
+        smp.reset_stop();
+
+        const SearchResult result = smp.search(board, {}, limits);
+        total_nodes += result.nodes;
+
+        UCI::log(std::format("position {:>2}/{}  {:<10}  {:>12} nodes  {}",
+            i + 1, BENCH_FEN_COUNT, Move::to_str(result.best), format_uint64_t(result.nodes), fen));
+    }
+
+    const int64_t time = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count(), 1);
+
+    const uint64_t nps = total_nodes * 1000 / time;
+
+    UCI::log("========================================");
+    UCI::log(std::format("Total time (ms) : {}", time));
+    UCI::log(std::format("Nodes searched  : {}", total_nodes));
+    UCI::log(std::format("Nodes/second    : {}", nps));
+
+    // the single line format expected by testing frameworks
+    UCI::log(std::format("{} nodes {} nps", total_nodes, nps));
+
+    return total_nodes;
+}
+
+}
@@ -0,0 +1,33 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace Kreveta {
+
+// searches the built-in bench positions to a fixed depth. with a single thread,
+// every position starts from an empty table and clear move ordering tables, so the
+// total node count only changes when the search itself does, and can be used as a
+// signature of the build. the tablebases are never probed, but the signature does
+// depend on the network, which is a part of the build unless EvalFile is set. more
+// threads make the node count nondeterministic
+class Bench {
+public:
+    static constexpr int DEFAULT_DEPTH   = 10;
+    static constexpr int DEFAULT_THREADS = 1;
+    static constexpr int DEFAULT_HASH    = 16;
+
+    // bench [depth] [threads] [hash]. the first argument is the command
+    // itself, so both the uci command and the command line tool can use this.
+    // returns false if the arguments are invalid
+    static bool run(std::span<const std::string_view> args);
+
+    // returns the total number of nodes searched
+    static uint64_t run(int depth, int threads, int hash_mb);
+};
+
+}
+
+#endif //BENCH_H
@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <string>
+
+#include "mate_solver.h"
+
+#include "src/uci.h"
+#include "src/movegen/movegen.h"
+
+namespace Kreveta {
+
+MateSolver::MateSolver(const std::size_t mb) {
+    count   = std::max<std::size_t>(mb, 1) * (1 << 20) / sizeof(Entry);
+    entries = std::make_unique_for_overwrite<Entry[]>(count);
+}
+
+uint64_t MateSolver::node_key(const Board &board, const int plies_left) {
+    return board.key ^ static_cast<uint64_t>(plies_left + 1) * 0x9E3779B97F4A7C15ULL;
+}
+
+MateSolver::Entry *MateSolver::find(const uint64_t key) const {
+    Entry &entry = entries[static_cast<std::size_t>(static_cast<unsigned __int128>(key) * count >> 64)];
+    return entry.key == key ? &entry : nullptr;
+}
+
+// newer entries always replace the older ones, since they are usually closer to
+// the nodes being expanded right now
+void MateSolver::store(const uint64_t key, const uint32_t phi, const uint32_t delta) {
+    Entry &entry = entries[static_cast<std::size_t>(static_cast<unsigned __int128>(key) * count >> 64)];
+    entry = { key, phi, delta };
+}
+
+void MateSolver::look_up(const Board &board, const int plies_left, uint32_t &phi, uint32_t &delta) const {
+
+    // a repetition is a draw, which is a success for the defender only
+    const bool attacker = plies_left & 1;
+    if (std::find(path.begin(), path.end(), board.key) != path.end()) {
+        phi   = attacker ? INF : 0;
+        delta = attacker ? 0   : INF;
+        return;
+    }
+
+    if (const Entry *entry = find(node_key(board, plies_left))) {
+        phi   = entry->phi;
+        delta = entry->delta;
+        return;
+    }
+
+    // an unexplored node
+    phi   = 1;
+    delta = 1;
+}
+
+// the attacker (with an odd number of plies left) only checks
+int MateSolver::generate(const Board &board, const int plies_left, Move *moves) const {
+    return plies_left & 1
+        ? Movegen::get_legal_checks(board, moves)
+        : Movegen::get_legal_moves(board, moves);
+}
+
+MateResult MateSolver::solve(const Board &board, const std::vector<uint64_t> &history, const int max_moves, const SearchLimits &limits) {
+    this->limits = limits;
+
+    start_time = std::chrono::steady_clock::now();
+    stopped    = false;
+    nodes      = 0;
+
+    std::memset(entries.get(), 0, count * sizeof(Entry));
+
+    MateResult result;
+
+    for (int moves = 1; moves <= std::min(max_moves, MAX_PLY / 2); moves++) {
+        const int plies = moves * 2 - 1;
+
+        path = history;
+        path.reserve(history.size() + plies + 1);
+
+        mid(board, plies, INF, INF);
+
+        if (stopped)
+            break;
+
+        uint32_t phi, delta;
+        look_up(board, plies, phi, delta);
+
+        if (phi != 0)
+            continue;
+
+        result.found = true;
+        result.moves = moves;
+
+        extract_pv(board, plies, result.pv);
+        break;
+    }
+
+    result.nodes = nodes;
+
+    if (!silent) {
+        const int64_t time = elapsed();
+
+        if (result.found) {
+            std::string pv_str;
+            for (const Move move : result.pv) {
+                pv_str += ' ';
+                pv_str += Move::to_str(move);
+            }
+
+            UCI::log(std::format("info depth {} score mate {} nodes {} nps {} time {} pv{}",
+                result.moves * 2 - 1, result.moves, nodes, nodes * 1000 / std::max<int64_t>(time, 1), time, pv_str));
+        }
+        else UCI::log(std::format("info string No mate in {} found", max_moves));
+    }
+
+    return result;
+}
+
+// multiple iterative deepening: the node is expanded until one of its numbers
+// reaches the limit. the most proving child is searched with limits, which make
+// it return as soon as another child becomes more promising
+void MateSolver::mid(const Board &board, const int plies_left, const uint32_t phi_limit, const uint32_t delta_limit) {
+    nodes++;
+
+    if (should_stop())
+        return;
+
+    const uint64_t key      = node_key(board, plies_left);
+    const bool     attacker = plies_left & 1;
+
+    Move moves[MAX_MOVES];
+    const int move_count = generate(board, plies_left, moves);
+
+    if (move_count == 0) {
+
+        // the attacker has no checks left, or the defender has been mated
+        if (attacker || Movegen::is_in_check(board, board.color)) store(key, INF, 0);
+
+        // stalemate
+        else store(key, 0, INF);
+        return;
+    }
+
+    // the defender survived all plies
+    if (plies_left == 0) {
+        store(key, 0, INF);
+        return;
+    }
+
+    path.push_back(board.key);
+
+    uint32_t phi   = 0;
+    uint32_t delta = 0;
+
+    while (true) {
+
+        // the node wins if any child loses, and loses only if all children win
+        phi   = INF;
+        delta = 0;
+
+        int      best       = 0;
+        uint32_t best_phi   = 0;
+        uint32_t second_min = INF;
+
+        // only the moves are kept, since a board per child would make every frame
+        // of the recursion large enough to overflow the stack of longer mates
+        for (int i = 0; i < move_count; i++) {
+            Board child = board.clone();
+            child.play_move(moves[i]);
+
+            uint32_t child_phi, child_delta;
+            look_up(child, plies_left - 1, child_phi, child_delta);
+
+            if (child_delta < phi) {
+                second_min = phi;
+                phi        = child_delta;
+                best       = i;
+                best_phi   = child_phi;
+            }
+            else if (child_delta < second_min) {
+                second_min = child_delta;
+            }
+
+            delta = std::min(delta + child_phi, INF);
+        }
+
+        if (phi >= phi_limit || delta >= delta_limit)
+            break;
+
+        const uint32_t child_phi_limit   = std::min(delta_limit - delta + best_phi, INF);
+        const uint32_t child_delta_limit = std::min(phi_limit, second_min + 1);
+
+        Board child = board.clone();
+        child.play_move(moves[best]);
+
+        mid(child, plies_left - 1, child_phi_limit, child_delta_limit);
+
+        if (stopped)
+            break;
+    }
+
+    path.pop_back();
+
+    // an unfinished node can't be stored, it would look like it was searched
+    if (!stopped)
+        store(key, phi, delta);
+}
+
+// follow the proven nodes. the attacker plays the quickest mate and the defender
+// resists as long as possible, so the pv has the full length of the mate
+void MateSolver::extract_pv(const Board &board, int plies, std::vector<Move> &pv) {
+    Board pos = board;
+
+    // the pv is a part of the path, so the shorter searches avoid its repetitions
+    const std::size_t path_size = path.size();
+
+    while (plies >= 0) {
+        Move moves[MAX_MOVES];
+        const int move_count = generate(pos, plies, moves);
+
+        const bool attacker = plies & 1;
+
+        // the defender's child is the attacker's node, which must be proven,
+        // and the attacker's child is the defender's node, which must be lost
+        const auto is_proven = [&](const Board &child, const int plies_left) {
+            const Entry *entry = find(node_key(child, plies_left));
+            return entry && (attacker ? entry->delta == 0 : entry->phi == 0);
+        };
+
+        path.push_back(pos.key);
+
+        int next   = -1;
+        int length = 0;
+
+        for (int i = 0; i < move_count; i++) {
+            Board child = pos;
+            child.play_move(moves[i]);
+
+            if (!is_proven(child, plies - 1))
+                continue;
+
+            // the same child may also be decided in fewer plies. the shorter
+            // searches are cheap compared to the one which found the mate
+            int child_length = plies - 1;
+            for (int k = (plies - 1) & 1; k < plies - 1 && !stopped; k += 2) {
+                mid(child, k, INF, INF);
+
+                if (is_proven(child, k)) {
+                    child_length = k;
+                    break;
+                }
+            }
+
+            if (next == -1 || (attacker ? child_length < length : child_length > length)) {
+                next   = i;
+                length = child_length;
+            }
+        }
+
+        if (next == -1)
+            break;
+
+        pv.push_back(moves[next]);
+        pos.play_move(moves[next]);
+        plies--;
+    }
+
+    path.resize(path_size);
+}
+
+bool MateSolver::should_stop() {
+    if (stopped)
+        return true;
+
+    if (stop_flag.load(std::memory_order_relaxed) || (limits.nodes && nodes >= limits.nodes)) {
+        stopped = true;
+    }
+    else if (limits.movetime && (nodes & 1023) == 0 && elapsed() >= limits.movetime) {
+        stopped = true;
+    }
+
+    return stopped;
+}
+
+int64_t MateSolver::elapsed() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+}
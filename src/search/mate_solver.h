@@ -0,0 +1,90 @@
+#ifndef MATE_SOLVER_H
+#define MATE_SOLVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "search.h"
+#include "src/board.h"
+
+namespace Kreveta {
+
+struct MateResult {
+    bool found = false;
+
+    // the length of the mate in moves (not plies)
+    int  moves = 0;
+
+    std::vector<Move> pv;
+    uint64_t          nodes = 0;
+};
+
+// depth-first proof-number search for "go mate N". the attacker only plays checks,
+// and the defender all legal moves. every node has a proof number (how many leaves
+// must be proven to prove the mate) and a disproof number, and the search always
+// expands the most proving node, which is much better at finding long forced
+// mates than alpha-beta. the numbers are kept from the point of view of the side
+// to move (phi for its own goal, delta for the opponent's), so both kinds of nodes
+// are handled the same way
+class MateSolver {
+public:
+    explicit MateSolver(std::size_t mb = 16);
+
+    // mates of all lengths up to the limit are tried, so the shortest one is found
+    MateResult solve(const Board &board, const std::vector<uint64_t> &history, int max_moves, const SearchLimits &limits);
+
+    void stop()       { stop_flag.store(true,  std::memory_order_relaxed); }
+    void reset_stop() { stop_flag.store(false, std::memory_order_relaxed); }
+
+    // don't print any info lines
+    bool silent = false;
+
+private:
+    static constexpr uint32_t INF = 1U << 30;
+
+    struct Entry {
+        uint64_t key;
+        uint32_t phi;
+        uint32_t delta;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    std::size_t              count = 0;
+
+    std::atomic<bool> stop_flag = false;
+    bool              stopped   = false;
+
+    uint64_t     nodes = 0;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start_time;
+
+    // keys of the game history and the current path. repeating a position
+    // is a draw, so it can't be a part of any mate
+    std::vector<uint64_t> path;
+
+    // the same position with a different number of plies left is a different
+    // node, since a mate found with more plies may not exist with fewer
+    [[nodiscard]] static uint64_t node_key(const Board &board, int plies_left);
+
+    [[nodiscard]] Entry *find(uint64_t key) const;
+    void store(uint64_t key, uint32_t phi, uint32_t delta);
+
+    // the numbers of a node without expanding it
+    void look_up(const Board &board, int plies_left, uint32_t &phi, uint32_t &delta) const;
+
+    void mid(const Board &board, int plies_left, uint32_t phi_limit, uint32_t delta_limit);
+
+    [[nodiscard]] int generate(const Board &board, int plies_left, Move *moves) const;
+
+    [[nodiscard]] bool should_stop();
+    [[nodiscard]] int64_t elapsed() const;
+
+    void extract_pv(const Board &board, int plies, std::vector<Move> &pv);
+};
+
+}
+
+#endif //MATE_SOLVER_H
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <string>
+
+#include "mcts.h"
+
+#include "src/uci.h"
+#include "src/movegen/movegen.h"
+
+namespace Kreveta {
+
+// the exploration constant of UCT. higher values spread the playouts more evenly
+constexpr double EXPLORATION = 1.4;
+
+MCTS::MCTS(const std::size_t mb) {
+    resize(mb);
+}
+
+void MCTS::resize(const std::size_t mb) {
+    // the nodes are indexed by 32 bits
+    capacity = std::min<std::size_t>(std::max<std::size_t>(mb, 1) * (1 << 20) / sizeof(MCTSNode), UINT32_MAX);
+    nodes    = std::make_unique<MCTSNode[]>(capacity);
+}
+
+SearchResult MCTS::search(const Board &board, const std::vector<uint64_t> &history, const SearchLimits &limits, const int threads) {
+    this->limits  = limits;
+    this->root    = board;
+    this->history = history;
+
+    start_time = std::chrono::steady_clock::now();
+    stopped    = false;
+    playouts   = 0;
+    depth_sum  = 0;
+
+    // the same formula as the alpha-beta search, without any overhead for the soft limit
+    const int64_t time = limits.time[board.color];
+    time_limit = limits.movetime ? limits.movetime
+        : time && !limits.infinite ? std::max<int64_t>(std::min(time / 30 + limits.inc[board.color] * 3 / 4, time / 2), 1)
+        : 0;
+
+    // the whole tree is thrown away, the nodes are reset when they are allocated
+    MCTSNode &root_node = nodes[0];
+    root_node.first_child.store(0,  std::memory_order_relaxed);
+    root_node.visits.store(0,       std::memory_order_relaxed);
+    root_node.value_sum.store(0,    std::memory_order_relaxed);
+    root_node.virtual_loss.store(0, std::memory_order_relaxed);
+    root_node.state.store(STATE_LEAF, std::memory_order_relaxed);
+    used.store(1, std::memory_order_relaxed);
+    full.store(false, std::memory_order_relaxed);
+
+    SearchResult result;
+
+    expand(root_node, root);
+    if (root_node.state.load(std::memory_order_relaxed) != STATE_EXPANDED) {
+        result.score = root_node.terminal == 0 ? -MATE : 0;
+        return result;
+    }
+
+    if (!pool || pool->size() != std::max(threads, 1))
+        pool = std::make_unique<ThreadPool>(std::max(threads, 1));
+
+    pool->run([&](const int thread) {
+
+        // the accumulator stack is quite large, so it lives on the heap
+        const auto acc = std::make_unique<AccumulatorStack>();
+        acc->reset(root);
+
+        std::vector<uint64_t> keys = this->history;
+        keys.reserve(keys.size() + MAX_DEPTH);
+
+        int64_t last_info = 0;
+
+        while (!should_stop()) {
+            playout(*acc, keys);
+
+            // only the first thread prints anything
+            if (thread == 0 && elapsed() - last_info >= 1000) {
+                last_info = elapsed();
+                print_info();
+            }
+        }
+    });
+
+    print_info();
+
+    // the most visited move is the most reliable one
+    const uint32_t first = root_node.first_child.load(std::memory_order_relaxed);
+    uint32_t best = first;
+
+    for (uint32_t i = first; i < first + root_node.child_count; i++) {
+        if (nodes[i].visits.load(std::memory_order_relaxed) > nodes[best].visits.load(std::memory_order_relaxed))
+            best = i;
+    }
+
+    const uint32_t best_visits = std::max(nodes[best].visits.load(std::memory_order_relaxed), 1U);
+
+    result.best  = nodes[best].move;
+    result.score = value_to_score(static_cast<double>(nodes[best].value_sum.load(std::memory_order_relaxed)) / VALUE_ONE / best_visits);
+    result.nodes = playouts.load(std::memory_order_relaxed);
+    result.depth = static_cast<int>(depth_sum.load(std::memory_order_relaxed) / std::max<uint64_t>(result.nodes, 1));
+
+    return result;
+}
+
+void MCTS::playout(AccumulatorStack &acc, std::vector<uint64_t> &keys) {
+    uint32_t path[MAX_DEPTH + 1];
+    int      depth = 0;
+
+    path[0] = 0;
+    nodes[0].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+
+    Board board = root;
+
+    // the result of the playout for the side to move in the last node
+    int64_t value;
+
+    while (true) {
+        MCTSNode &node = nodes[path[depth]];
+
+        // draws by repetition depend on the path, so they can't be stored in the node
+        if (depth > 0 && (board.halfmove_clock >= 100 || board.has_insufficient_material()
+            || std::find(keys.end() - std::min<std::size_t>(board.halfmove_clock, keys.size()), keys.end(), board.key) != keys.end())) {
+            value = VALUE_ONE / 2;
+            break;
+        }
+
+        uint8_t state = node.state.load(std::memory_order_acquire);
+
+        // a leaf is only evaluated on its first visit and expanded on the next one,
+        // so the arena isn't filled by children of nodes, which are never revisited.
+        // the first thread to get there expands it, the others only evaluate it
+        if (state == STATE_LEAF && node.visits.load(std::memory_order_relaxed) != 0 && expand(node, board))
+            state = node.state.load(std::memory_order_acquire);
+
+        if (state == STATE_TERMINAL) {
+            value = node.terminal;
+            break;
+        }
+
+        if (state != STATE_EXPANDED || depth + 1 >= MAX_DEPTH) {
+            value = score_to_value(qsearch(acc, board, 0, -SCORE_INF, SCORE_INF));
+            break;
+        }
+
+        const uint32_t child = select_child(node);
+        nodes[child].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+
+        Board next = board.clone();
+        DirtyPieces dirty;
+        next.play_move(nodes[child].move, dirty);
+
+        keys.push_back(board.key);
+        acc.push(next, dirty);
+
+        board = next;
+        path[++depth] = child;
+    }
+
+    // each node stores the results for the side, which played the move into it
+    for (int d = depth; d >= 0; d--) {
+        MCTSNode &node = nodes[path[d]];
+
+        value = VALUE_ONE - value;
+
+        node.value_sum.fetch_add(value, std::memory_order_relaxed);
+        node.visits.fetch_add(1, std::memory_order_relaxed);
+        node.virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    for (int d = 0; d < depth; d++) {
+        acc.pop();
+        keys.pop_back();
+    }
+
+    playouts.fetch_add(1, std::memory_order_relaxed);
+    depth_sum.fetch_add(depth, std::memory_order_relaxed);
+}
+
+// UCT. the virtual losses are counted as visits without any value, so the
+// moves other threads are currently searching look worse for a while
+uint32_t MCTS::select_child(const MCTSNode &node) const {
+    const uint32_t first = node.first_child.load(std::memory_order_relaxed);
+
+    const double parent_visits = node.visits.load(std::memory_order_relaxed)
+                               + node.virtual_loss.load(std::memory_order_relaxed);
+    const double log_visits = std::log(std::max(parent_visits, 1.0));
+
+    uint32_t best       = first;
+    double   best_score = -1.0;
+
+    for (uint32_t i = first; i < first + node.child_count; i++) {
+        const MCTSNode &child = nodes[i];
+
+        const uint32_t visits = child.visits.load(std::memory_order_relaxed)
+                              + child.virtual_loss.load(std::memory_order_relaxed);
+
+        // the children are ordered, so the first unvisited one is the most promising
+        if (visits == 0)
+            return i;
+
+        const double q = static_cast<double>(child.value_sum.load(std::memory_order_relaxed)) / VALUE_ONE / visits;
+        const double u = EXPLORATION * std::sqrt(log_visits / visits);
+
+        if (q + u > best_score) {
+            best_score = q + u;
+            best       = i;
+        }
+    }
+
+    return best;
+}
+
+bool MCTS::expand(MCTSNode &node, const Board &board) {
+    if (full.load(std::memory_order_relaxed))
+        return false;
+
+    uint8_t expected = STATE_LEAF;
+    if (!node.state.compare_exchange_strong(expected, STATE_EXPANDING, std::memory_order_acquire))
+        return false;
+
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    if (count == 0) {
+        node.terminal = Movegen::is_in_check(board, board.color) ? 0 : VALUE_ONE / 2;
+        node.state.store(STATE_TERMINAL, std::memory_order_release);
+        return true;
+    }
+
+    // the nodes are only taken when all of them fit, so the counter never
+    // goes past the capacity, and failed expansions don't move it at all
+    uint32_t first = used.load(std::memory_order_relaxed);
+    do {
+        if (capacity - first < static_cast<std::size_t>(count)) {
+            full.store(true, std::memory_order_relaxed);
+            node.state.store(STATE_LEAF, std::memory_order_release);
+            return false;
+        }
+    } while (!used.compare_exchange_weak(first, first + count, std::memory_order_relaxed));
+
+    // captures and promotions are tried before quiet moves
+    std::stable_partition(moves, moves + count, [](const Move move) {
+        return move.is_capture() || move.is_promotion();
+    });
+
+    for (int i = 0; i < count; i++) {
+        MCTSNode &child = nodes[first + i];
+
+        child.first_child.store(0,  std::memory_order_relaxed);
+        child.visits.store(0,       std::memory_order_relaxed);
+        child.value_sum.store(0,    std::memory_order_relaxed);
+        child.virtual_loss.store(0, std::memory_order_relaxed);
+        child.state.store(STATE_LEAF, std::memory_order_relaxed);
+        child.child_count = 0;
+        child.move        = moves[i];
+    }
+
+    node.first_child.store(first, std::memory_order_relaxed);
+    node.child_count = static_cast<uint8_t>(count);
+
+    // the children must be visible before anyone can select them
+    node.state.store(STATE_EXPANDED, std::memory_order_release);
+    return true;
+}
+
+// a short capture search, so the leaves aren't evaluated in the middle of an exchange
+int MCTS::qsearch(AccumulatorStack &acc, const Board &board, const int ply, int alpha, const int beta) const {
+    const int stand_pat = std::clamp(acc.evaluate(board), -MATE_BOUND + 1, MATE_BOUND - 1);
+
+    if (ply >= QSEARCH_PLIES || stand_pat >= beta)
+        return stand_pat;
+
+    alpha = std::max(alpha, stand_pat);
+
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves, true);
+
+    int best_score = stand_pat;
+
+    for (int i = 0; i < count; i++) {
+        Board child = board.clone();
+        DirtyPieces dirty;
+        child.play_move(moves[i], dirty);
+
+        acc.push(child, dirty);
+        const int score = -qsearch(acc, child, ply + 1, -beta, -alpha);
+        acc.pop();
+
+        if (score > best_score) {
+            best_score = score;
+            alpha      = std::max(alpha, score);
+
+            if (score >= beta)
+                break;
+        }
+    }
+
+    return best_score;
+}
+
+// the usual logistic mapping between centipawns and the expected result
+int64_t MCTS::score_to_value(const int score) {
+    return static_cast<int64_t>(VALUE_ONE / (1.0 + std::exp(-score / 400.0)));
+}
+
+int MCTS::value_to_score(const double value) {
+    const double q = std::clamp(value, 0.0001, 0.9999);
+    return static_cast<int>(std::round(-400.0 * std::log(1.0 / q - 1.0)));
+}
+
+bool MCTS::should_stop() {
+    if (stopped.load(std::memory_order_relaxed))
+        return true;
+
+    const uint64_t done = playouts.load(std::memory_order_relaxed);
+
+    // the depth limit is compared with the average depth of the playouts
+    const bool depth_reached = limits.depth < MAX_PLY && done
+        && depth_sum.load(std::memory_order_relaxed) / done >= static_cast<uint64_t>(limits.depth);
+
+    if (stop_flag.load(std::memory_order_relaxed)
+        || (limits.nodes && done >= limits.nodes)
+        || (time_limit && elapsed() >= time_limit)
+        || (depth_reached && !limits.infinite)) {
+
+        stopped.store(true, std::memory_order_relaxed);
+    }
+
+    return stopped.load(std::memory_order_relaxed);
+}
+
+int64_t MCTS::elapsed() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+void MCTS::print_info() const {
+    const int64_t  time  = elapsed();
+    const uint64_t count = playouts.load(std::memory_order_relaxed);
+
+    // the principal variation follows the most visited children
+    std::string pv_str;
+    double      root_value = 0.5;
+
+    uint32_t idx = 0;
+    for (int ply = 0; ply < MAX_DEPTH && nodes[idx].state.load(std::memory_order_acquire) == STATE_EXPANDED; ply++) {
+        const MCTSNode &node  = nodes[idx];
+        const uint32_t  first = node.first_child.load(std::memory_order_relaxed);
+
+        uint32_t best = first;
+        for (uint32_t i = first; i < first + node.child_count; i++) {
+            if (nodes[i].visits.load(std::memory_order_relaxed) > nodes[best].visits.load(std::memory_order_relaxed))
+                best = i;
+        }
+
+        const uint32_t visits = nodes[best].visits.load(std::memory_order_relaxed);
+        if (visits == 0)
+            break;
+
+        if (ply == 0)
+            root_value = static_cast<double>(nodes[best].value_sum.load(std::memory_order_relaxed)) / VALUE_ONE / visits;
+
+        pv_str += ' ';
+        pv_str += Move::to_str(nodes[best].move);
+        idx = best;
+    }
+
+    const uint64_t hashfull = std::min<uint64_t>(used.load(std::memory_order_relaxed), capacity) * 1000 / capacity;
+
+    UCI::log(std::format("info depth {} score cp {} nodes {} nps {} time {} hashfull {} pv{}",
+        depth_sum.load(std::memory_order_relaxed) / std::max<uint64_t>(count, 1), value_to_score(root_value),
+        count, count * 1000 / std::max<int64_t>(time, 1), time, hashfull, pv_str));
+}
+
+}
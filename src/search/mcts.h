@@ -0,0 +1,112 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "search.h"
+#include "src/board.h"
+#include "src/eval/nnue.h"
+#include "src/threads/thread_pool.h"
+
+namespace Kreveta {
+
+// a single node of the tree. the children of a node are allocated next to each other,
+// so the node only needs the index of the first one. the value is the sum of all
+// playout results (in millionths) from the point of view of the side, which played
+// the move leading to this node, so the parent simply picks the highest average
+struct MCTSNode {
+    std::atomic<uint32_t> first_child  = 0;
+    std::atomic<uint32_t> visits       = 0;
+    std::atomic<int64_t>  value_sum    = 0;
+
+    // threads currently searching below this node. they are counted as losses,
+    // so other threads are pushed to explore different moves in the meantime
+    std::atomic<uint32_t> virtual_loss = 0;
+
+    std::atomic<uint8_t>  state        = 0;
+    uint8_t               child_count  = 0;
+
+    // the result of a terminal node (mate or stalemate) for the side to move
+    int32_t               terminal     = 0;
+
+    Move move;
+};
+
+// an experimental alternative to the alpha-beta search. all threads share one tree,
+// which is grown by repeated playouts: a leaf is selected by UCT, expanded, and its
+// value (from a short quiescence search) is propagated back to the root. the nodes
+// are taken from a preallocated arena and expanded without any locks
+class MCTS {
+public:
+    explicit MCTS(std::size_t mb = 16);
+
+    void resize(std::size_t mb);
+
+    SearchResult search(const Board &board, const std::vector<uint64_t> &history, const SearchLimits &limits, int threads);
+
+    void stop()       { stop_flag.store(true,  std::memory_order_relaxed); }
+    void reset_stop() { stop_flag.store(false, std::memory_order_relaxed); }
+
+private:
+    static constexpr uint8_t STATE_LEAF      = 0;
+    static constexpr uint8_t STATE_EXPANDING = 1;
+    static constexpr uint8_t STATE_EXPANDED  = 2;
+    static constexpr uint8_t STATE_TERMINAL  = 3;
+
+    // results are stored as fixed-point numbers in [0, VALUE_ONE]
+    static constexpr int64_t VALUE_ONE = 1'000'000;
+
+    // quiescence search in the leaves is limited to a few plies
+    static constexpr int QSEARCH_PLIES = 6;
+
+    // the deepest path from the root, which still fits into the accumulator stack
+    static constexpr int MAX_DEPTH = MAX_PLY;
+
+    std::unique_ptr<MCTSNode[]> nodes;
+    std::size_t                 capacity = 0;
+    std::atomic<uint32_t>       used     = 0;
+
+    // once a node doesn't fit, the leaves are only evaluated and never expanded
+    std::atomic<bool>           full     = false;
+
+    std::unique_ptr<ThreadPool> pool;
+
+    std::atomic<bool>     stop_flag = false;
+    std::atomic<bool>     stopped   = false;
+    std::atomic<uint64_t> playouts  = 0;
+    std::atomic<uint64_t> depth_sum = 0;
+
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start_time;
+    int64_t time_limit = 0;
+
+    Board                 root;
+    std::vector<uint64_t> history;
+
+    // a single playout from the root. the thread's own accumulator stack
+    // and key list are reused between playouts
+    void playout(AccumulatorStack &acc, std::vector<uint64_t> &keys);
+
+    [[nodiscard]] uint32_t select_child(const MCTSNode &node) const;
+
+    // returns false if the node was being expanded by another thread
+    bool expand(MCTSNode &node, const Board &board);
+
+    [[nodiscard]] int qsearch(AccumulatorStack &acc, const Board &board, int ply, int alpha, int beta) const;
+
+    [[nodiscard]] static int64_t score_to_value(int score);
+    [[nodiscard]] static int value_to_score(double value);
+
+    [[nodiscard]] bool should_stop();
+    [[nodiscard]] int64_t elapsed() const;
+
+    void print_info() const;
+};
+
+}
+
+#endif //MCTS_H
@@ -0,0 +1,665 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <string>
+#include <thread>
+
+#include "search.h"
+
+#include "src/trace.h"
+#include "src/uci.h"
+#include "src/movegen/movegen.h"
+#include "src/tablebase/syzygy.h"
+
+namespace Kreveta {
+
+// late move reductions grow with both the depth and the number of moves searched
+// before. the table is filled once at startup, since computing logarithms on every
+// move would be wasteful
+static const auto LMR_TABLE = [] {
+    std::array<std::array<int, 64>, 64> table{};
+
+    for (int depth = 1; depth < 64; depth++) {
+        for (int move = 1; move < 64; move++)
+            table[depth][move] = static_cast<int>(0.75 + std::log(depth) * std::log(move) / 2.25);
+    }
+
+    return table;
+}();
+
+// mate (and tablebase) scores are relative to the root, but the same position may be reached
+// at a different ply, so the table stores them relative to the position itself instead
+static int score_to_tt(const int score, const int ply) {
+    if (score >=  TB_WIN_BOUND) return score + ply;
+    if (score <= -TB_WIN_BOUND) return score - ply;
+    return score;
+}
+
+static int score_from_tt(const int score, const int ply) {
+    if (score >=  TB_WIN_BOUND) return score - ply;
+    if (score <= -TB_WIN_BOUND) return score + ply;
+    return score;
+}
+
+// null move pruning fails in zugzwang, which is mostly a problem in pawn endgames
+static bool has_non_pawn_material(const Board &board, const Color color) {
+    return board.pieces[color][PT_KNIGHT] | board.pieces[color][PT_BISHOP]
+         | board.pieces[color][PT_ROOK]   | board.pieces[color][PT_QUEEN];
+}
+
+void Searcher::clear() {
+    std::memset(killers, 0, sizeof(killers));
+    std::memset(history_table, 0, sizeof(history_table));
+}
+
+#ifdef KREVETA_TREE_LOG
+void Searcher::set_tree_log(const std::string &path) {
+    tree_log.reset();
+
+    if (path.empty())
+        return;
+
+    tree_log = std::make_unique<TreeLog>(path);
+    if (!tree_log->is_open()) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        tree_log.reset();
+    }
+}
+#endif
+
+SearchResult Searcher::search(const Board &board, const std::vector<uint64_t> &history, const SearchLimits &limits) {
+    TRACE_ZONE("search");
+
+    this->limits = limits;
+
+    start_time = std::chrono::steady_clock::now();
+    stopped    = false;
+    nodes      = 0;
+    tb_hits    = 0;
+
+    shared_reported = 0;
+    root_depth = 1;
+
+    search_stats = {};
+    const StatsScope stats_scope(search_stats);
+
+    allocate_time(board.color);
+
+    keys = history;
+    keys.reserve(history.size() + MAX_PLY);
+
+    acc.reset(board);
+
+    if (age_tt)
+        tt.new_search();
+
+    SearchResult result;
+
+    root_count = Movegen::get_legal_moves(board, root_moves);
+
+    if (root_count == 0) {
+        result.score = Movegen::is_in_check(board, board.color) ? -MATE : 0;
+        return result;
+    }
+
+    // when the root itself is in the tablebases, only the moves keeping the best
+    // result are searched, and there is no need to probe the tables any further
+    const bool root_in_tb = use_tb && Syzygy::rank_root_moves(board, history, root_moves, root_count);
+    tb_probing = use_tb && Syzygy::max_pieces() != 0 && !root_in_tb;
+
+    if (root_in_tb)
+        tb_hits += root_count;
+
+    // in case the search gets stopped right away, we still want to play something
+    result.best = root_moves[0];
+
+    int score = 0;
+    for (int depth = 1; depth <= std::min(limits.depth, MAX_PLY - 1); depth++) {
+        root_depth = depth;
+
+        TRACE_ZONE("iteration");
+        TREE_RECORD(TREE_ITERATION, 0, depth, -SCORE_INF, SCORE_INF, score);
+
+        // the score usually doesn't change much between iterations, so deeper
+        // searches start with a narrow window around it, which is widened
+        // only if the score falls outside of it
+        int delta = 25;
+        int alpha = -SCORE_INF;
+        int beta  =  SCORE_INF;
+
+        if (depth >= 5) {
+            alpha = std::max(score - delta, -SCORE_INF);
+            beta  = std::min(score + delta,  SCORE_INF);
+        }
+
+        int new_score;
+        while (true) {
+            new_score = negamax(board, depth, 0, alpha, beta, false);
+
+            if (stopped)
+                break;
+
+            if (new_score <= alpha) {
+                beta  = (alpha + beta) / 2;
+                alpha = std::max(new_score - delta, -SCORE_INF);
+            }
+            else if (new_score >= beta) {
+                beta  = std::min(new_score + delta, SCORE_INF);
+            }
+            else break;
+
+            delta += delta / 2;
+        }
+
+        // an unfinished iteration can't be trusted
+        if (stopped)
+            break;
+
+        score = new_score;
+
+        if (pv_length[0] != 0)
+            result.best = pv[0][0];
+
+        result.score = score;
+        result.depth = depth;
+
+        print_info(depth, score);
+
+        // a deeper search can't find a shorter mate than this
+        if (!limits.infinite && std::abs(score) >= MATE_BOUND && depth >= MATE - std::abs(score))
+            break;
+
+        // there is most likely not enough time to finish another iteration
+        if (soft_limit && elapsed() >= soft_limit)
+            break;
+    }
+
+    // when searching infinitely, the best move mustn't be sent before "stop"
+    while (limits.infinite && !stop_flag.load(std::memory_order_relaxed))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+#ifdef KREVETA_TREE_LOG
+    if (tree_log)
+        tree_log->flush();
+#endif
+
+    result.nodes = nodes;
+    return result;
+}
+
+void Searcher::allocate_time(const Color color) {
+    soft_limit = 0;
+    hard_limit = 0;
+
+    if (limits.movetime) {
+        soft_limit = hard_limit = limits.movetime;
+        return;
+    }
+
+    const int64_t time = limits.time[color];
+    if (!time || limits.infinite)
+        return;
+
+    // leave some time for the communication with the GUI
+    constexpr int64_t OVERHEAD = 30;
+    const int64_t available = std::max<int64_t>(time - OVERHEAD, 1);
+
+    const int moves_left = limits.movestogo
+        ? std::min(limits.movestogo, 40)
+        : 30;
+
+    hard_limit = std::max<int64_t>(available / 2, 1);
+    soft_limit = std::min(available / moves_left + limits.inc[color] * 3 / 4, hard_limit);
+}
+
+int64_t Searcher::elapsed() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+bool Searcher::should_stop() {
+    if (stopped)
+        return true;
+
+    // the first iteration is always finished, so we always have a move to play
+    if (root_depth == 1)
+        return false;
+
+    if (stop_flag.load(std::memory_order_relaxed)
+        || (limits.nodes && limit_nodes() >= limits.nodes)) {
+        stopped = true;
+    }
+
+    // checking the clock is quite slow, so we only do it every few thousand nodes
+    else if (hard_limit && (nodes & 2047) == 0 && elapsed() >= hard_limit) {
+        stopped = true;
+    }
+
+    return stopped;
+}
+
+// the nodes counted towards the node limit. the shared counter is only updated
+// every few hundred nodes, so that the threads don't fight over it all the time
+uint64_t Searcher::limit_nodes() {
+    if (!shared_nodes)
+        return nodes;
+
+    if (nodes - shared_reported >= 256) {
+        shared_nodes->fetch_add(nodes - shared_reported, std::memory_order_relaxed);
+        shared_reported = nodes;
+    }
+
+    return shared_nodes->load(std::memory_order_relaxed) + (nodes - shared_reported);
+}
+
+bool Searcher::is_repetition(const Board &board) const {
+    const int size = static_cast<int>(keys.size());
+
+    // the last key is the opponent's position, so we start one further. positions
+    // before the last irreversible move can never repeat, so we stop there
+    const int last = std::max(size - board.halfmove_clock, 0);
+
+    for (int i = size - 2; i >= last; i -= 2) {
+        if (keys[i] == board.key)
+            return true;
+    }
+
+    return false;
+}
+
+int Searcher::negamax(const Board &board, int depth, const int ply, int alpha, int beta, const bool null_allowed) {
+    pv_length[ply] = 0;
+
+    if (depth <= 0)
+        return qsearch(board, ply, alpha, beta);
+
+    if (should_stop())
+        return 0;
+
+    nodes++;
+    STATS_INC(STAT_NODES);
+
+    const bool root    = ply == 0;
+    const bool pv_node = beta - alpha > 1;
+
+    if (!root) {
+        if (board.halfmove_clock >= 100 || board.has_insufficient_material() || is_repetition(board))
+            return 0;
+
+        if (ply >= MAX_PLY - 1)
+            return acc.evaluate(board);
+
+        // we can't find a shorter mate than one we have already found
+        alpha = std::max(alpha, -MATE + ply);
+        beta  = std::min(beta,   MATE - ply - 1);
+
+        if (alpha >= beta)
+            return alpha;
+    }
+
+    TTData tt_data{};
+    const bool tt_hit  = tt.probe(board.key, tt_data);
+    const Move tt_move = tt_hit ? Move::from_raw(tt_data.move) : Move();
+
+    // pv nodes aren't cut off, so the principal variation stays intact
+    if (tt_hit && !pv_node && tt_data.depth >= depth) {
+        const int tt_score = score_from_tt(tt_data.score, ply);
+
+        if (tt_data.bound() == BOUND_EXACT
+            || (tt_data.bound() == BOUND_LOWER && tt_score >= beta)
+            || (tt_data.bound() == BOUND_UPPER && tt_score <= alpha)) {
+
+            TREE_RECORD(TREE_TT_CUTOFF, ply, depth, alpha, beta, tt_score);
+            return tt_score;
+        }
+    }
+
+    // the wdl tables ignore the fifty-move counter, so they are only probed
+    // right after it was reset, where the result is exact. castling isn't
+    // possible in the tablebases at all
+    if (!root && tb_probing && board.halfmove_clock == 0 && board.castling_rights == CR_NONE
+        && std::popcount(board.occupied()) <= Syzygy::max_pieces()) {
+
+        ProbeState state;
+        const WDLScore wdl = Syzygy::probe_wdl(board, state);
+
+        if (state != PROBE_FAIL) {
+            tb_hits++;
+
+            // cursed wins and blessed losses are drawn by the fifty-move rule,
+            // but are still scored slightly better (or worse) than a draw
+            const int score = wdl == WDL_WIN  ?  TB_WIN - ply
+                            : wdl == WDL_LOSS ? -TB_WIN + ply
+                            : wdl;
+
+            const Bound tb_bound = wdl == WDL_WIN  ? BOUND_LOWER
+                                 : wdl == WDL_LOSS ? BOUND_UPPER
+                                 : BOUND_EXACT;
+
+            if (tb_bound == BOUND_EXACT
+                || (tb_bound == BOUND_LOWER && score >= beta)
+                || (tb_bound == BOUND_UPPER && score <= alpha)) {
+
+                tt.store(board.key, Move(), score_to_tt(score, ply), std::min(depth + 6, MAX_PLY - 1), tb_bound);
+
+                TREE_RECORD(TREE_TB_CUTOFF, ply, depth, alpha, beta, score);
+                return score;
+            }
+        }
+    }
+
+    const Color color    = board.color;
+    const bool  in_check = Movegen::is_in_check(board, color);
+
+    if (!pv_node && !in_check) {
+        const int static_eval = acc.evaluate(board);
+
+        // reverse futility pruning. the position is so good that even losing
+        // some material in the remaining depth would still exceed beta
+        if (depth <= 6 && std::abs(beta) < MATE_BOUND && static_eval - 80 * depth >= beta) {
+            TREE_RECORD(TREE_REVERSE_FUTILITY, ply, depth, alpha, beta, static_eval);
+            return static_eval;
+        }
+
+        // null move pruning. we let the opponent play two moves in a row, and
+        // if a reduced search still fails high, the real one would as well
+        if (null_allowed && depth >= 3 && static_eval >= beta && has_non_pawn_material(board, color)) {
+            const int reduction = 3 + depth / 4;
+            STATS_INC(STAT_NULL_TRIES);
+
+            Board child = board.clone();
+            child.play_null_move();
+
+            keys.push_back(board.key);
+            acc.push(child, DirtyPieces{});
+
+            const int score = -negamax(child, depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+
+            acc.pop();
+            keys.pop_back();
+
+            if (stopped)
+                return 0;
+
+            // unproven mates are not returned
+            if (score >= beta) {
+                STATS_INC(STAT_NULL_CUTOFFS);
+                TREE_RECORD(TREE_NULL_MOVE, ply, depth, alpha, beta, score);
+                return score >= MATE_BOUND ? beta : score;
+            }
+        }
+    }
+
+    Move moves[MAX_MOVES];
+    int  scores[MAX_MOVES];
+
+    int count;
+
+    if (root) {
+        std::copy_n(root_moves, root_count, moves);
+        count = root_count;
+    }
+    else count = Movegen::get_legal_moves(board, moves);
+
+    if (count == 0)
+        return in_check ? -MATE + ply : 0;
+
+    score_moves(moves, scores, count, tt_move, ply, color);
+
+    Move quiets[64];
+    int  quiet_count = 0;
+
+    int   best_score = -SCORE_INF;
+    Move  best_move;
+    Bound bound = BOUND_UPPER;
+
+    for (int i = 0; i < count; i++) {
+
+        // the moves are sorted lazily, since most nodes are cut off after a few of them
+        for (int j = i + 1; j < count; j++) {
+            if (scores[j] > scores[i]) {
+                std::swap(scores[i], scores[j]);
+                std::swap(moves[i], moves[j]);
+            }
+        }
+
+        const Move move  = moves[i];
+        const bool quiet = !move.is_capture() && !move.is_promotion();
+
+        TRACE_ZONE_IF(root, "root move");
+
+        if (root)
+            print_currmove(depth, move, i + 1);
+
+        Board child = board.clone();
+        DirtyPieces dirty;
+        child.play_move(move, dirty);
+
+        keys.push_back(board.key);
+        acc.push(child, dirty);
+
+        // checks are extended, so we don't end the search right before a mate
+        const bool gives_check = Movegen::is_in_check(child, child.color);
+        const int  new_depth   = depth - 1 + gives_check;
+
+        int score;
+        if (i == 0) {
+            score = -negamax(child, new_depth, ply + 1, -beta, -alpha, true);
+            TREE_RECORD(TREE_CHILD, ply, new_depth, alpha, beta, score, move);
+        }
+        else {
+            // late quiet moves are unlikely to be good, so they are searched with
+            // reduced depth first, and only searched fully if they beat alpha
+            int reduction = 0;
+            if (depth >= 3 && i >= 3 && quiet && !in_check && !gives_check) {
+                reduction = LMR_TABLE[std::min(depth, 63)][std::min(i, 63)] - pv_node;
+                reduction = std::clamp(reduction, 0, new_depth - 1);
+            }
+
+            if (reduction)
+                STATS_INC(STAT_LMR_SEARCHES);
+
+            score = -negamax(child, new_depth - reduction, ply + 1, -alpha - 1, -alpha, true);
+            TREE_RECORD(reduction ? TREE_CHILD_REDUCED : TREE_CHILD, ply, new_depth - reduction, alpha, alpha + 1, score, move, reduction);
+
+            if (score > alpha && reduction) {
+                STATS_INC(STAT_LMR_RESEARCHES);
+                score = -negamax(child, new_depth, ply + 1, -alpha - 1, -alpha, true);
+                TREE_RECORD(TREE_CHILD_RESEARCH, ply, new_depth, alpha, alpha + 1, score, move);
+            }
+
+            if (score > alpha && score < beta) {
+                score = -negamax(child, new_depth, ply + 1, -beta, -alpha, true);
+                TREE_RECORD(TREE_CHILD_RESEARCH, ply, new_depth, alpha, beta, score, move);
+            }
+        }
+
+        acc.pop();
+        keys.pop_back();
+
+        if (stopped)
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            best_move  = move;
+
+            if (score > alpha) {
+                alpha = score;
+                bound = BOUND_EXACT;
+
+                pv[ply][0] = move;
+                std::copy_n(pv[ply + 1], pv_length[ply + 1], pv[ply] + 1);
+                pv_length[ply] = pv_length[ply + 1] + 1;
+
+                if (score >= beta) {
+                    bound = BOUND_LOWER;
+                    STATS_CUTOFF(i);
+                    TREE_RECORD(TREE_BETA_CUTOFF, ply, depth, alpha, beta, score, move, 0, i);
+
+                    if (quiet) {
+                        update_quiet(move, depth, ply, color);
+
+                        // the quiet moves, which didn't cause the cutoff, are penalized
+                        const int malus = depth * depth;
+                        for (int q = 0; q < quiet_count; q++) {
+                            int &entry = history_table[color][quiets[q].start()][quiets[q].end()];
+                            entry -= malus + entry * malus / 16384;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (quiet && quiet_count < 64)
+            quiets[quiet_count++] = move;
+    }
+
+    tt.store(board.key, best_move, score_to_tt(best_score, ply), depth, bound);
+    return best_score;
+}
+
+// only captures are searched until the position is quiet, so the evaluation
+// isn't done in the middle of an exchange
+int Searcher::qsearch(const Board &board, const int ply, int alpha, const int beta) {
+    pv_length[ply] = 0;
+
+    if (should_stop())
+        return 0;
+
+    nodes++;
+    STATS_INC(STAT_QNODES);
+
+    const int stand_pat = std::clamp(acc.evaluate(board), -MATE_BOUND + 1, MATE_BOUND - 1);
+
+    if (ply >= MAX_PLY - 1 || stand_pat >= beta)
+        return stand_pat;
+
+    alpha = std::max(alpha, stand_pat);
+
+    Move moves[MAX_MOVES];
+    int  scores[MAX_MOVES];
+
+    const int count = Movegen::get_legal_moves(board, moves, true);
+    score_moves(moves, scores, count, Move(), ply, board.color);
+
+    int best_score = stand_pat;
+
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (scores[j] > scores[i]) {
+                std::swap(scores[i], scores[j]);
+                std::swap(moves[i], moves[j]);
+            }
+        }
+
+        Board child = board.clone();
+        DirtyPieces dirty;
+        child.play_move(moves[i], dirty);
+
+        acc.push(child, dirty);
+        const int score = -qsearch(child, ply + 1, -beta, -alpha);
+        acc.pop();
+
+        if (stopped)
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+
+            if (score > alpha) {
+                alpha = score;
+
+                if (score >= beta)
+                    break;
+            }
+        }
+    }
+
+    return best_score;
+}
+
+// the move from the transposition table goes first, then captures sorted by
+// MVV-LVA (most valuable victim, least valuable attacker), promotions, killers
+// and finally the remaining quiet moves sorted by their history
+void Searcher::score_moves(const Move *moves, int *scores, const int count, const Move tt_move, const int ply, const Color color) const {
+    for (int i = 0; i < count; i++) {
+        const Move move = moves[i];
+
+        if (move == tt_move) {
+            scores[i] = 1'000'000;
+        }
+        else if (move.is_capture()) {
+
+            // en passant doesn't have a captured piece, but it's always a pawn
+            const PieceType victim = move.capture() == PT_NONE
+                ? PT_PAWN
+                : move.capture();
+
+            scores[i] = 100'000 + victim * 100 - move.piece();
+        }
+        else if (move.is_promotion()) {
+            scores[i] = 90'000 + move.promotion();
+        }
+        else if (move == killers[ply][0]) {
+            scores[i] = 80'000;
+        }
+        else if (move == killers[ply][1]) {
+            scores[i] = 79'000;
+        }
+        else scores[i] = history_table[color][move.start()][move.end()];
+    }
+}
+
+void Searcher::update_quiet(const Move move, const int depth, const int ply, const Color color) {
+    if (killers[ply][0] != move) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+
+    // the bonus shrinks as the entry grows, so the history stays bounded
+    const int bonus = depth * depth;
+    int &entry = history_table[color][move.start()][move.end()];
+    entry += bonus - entry * bonus / 16384;
+}
+
+// mate scores are printed as the number of moves (not plies) until the mate
+std::string Searcher::score_to_str(const int score) {
+    return std::abs(score) >= MATE_BOUND
+        ? std::format("mate {}", score > 0 ? (MATE - score + 1) / 2 : -(MATE + score) / 2)
+        : std::format("cp {}", score);
+}
+
+void Searcher::print_info(const int depth, const int score) const {
+    if (silent)
+        return;
+
+    const int64_t time = elapsed();
+
+    std::string pv_str;
+    for (int i = 0; i < pv_length[0]; i++) {
+        pv_str += ' ';
+        pv_str += Move::to_str(pv[0][i]);
+    }
+
+    UCI::log(std::format("info depth {} score {} nodes {} nps {} time {} hashfull {} tbhits {} pv{}",
+        depth, score_to_str(score), nodes, nodes * 1000 / std::max<int64_t>(time, 1), time, tt.hashfull(), tb_hits, pv_str));
+}
+
+// short searches would only flood the gui, so the current move is reported in longer ones
+void Searcher::print_currmove(const int depth, const Move move, const int number) const {
+    if (silent)
+        return;
+
+    const int64_t time = elapsed();
+    if (time < CURRMOVE_DELAY)
+        return;
+
+    UCI::log_progress(std::format("info depth {} currmove {} currmovenumber {} nodes {} nps {} time {}",
+        depth, Move::to_str(move), number, nodes, nodes * 1000 / std::max<int64_t>(time, 1), time));
+}
+
+}
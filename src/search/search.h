@@ -0,0 +1,162 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tree_log.h"
+#include "tt.h"
+#include "src/board.h"
+#include "src/stats.h"
+#include "src/movegen/movegen.h"
+#include "src/eval/nnue.h"
+
+namespace Kreveta {
+
+constexpr int MAX_PLY = 128;
+
+// mate scores are stored as the distance from the root, so anything
+// above MATE_BOUND is a forced mate in at most MAX_PLY plies
+constexpr int SCORE_INF  = 32001;
+constexpr int MATE       = 32000;
+constexpr int MATE_BOUND = MATE - MAX_PLY;
+
+// tablebase wins are below all mates, but still distance-adjusted, so the
+// search prefers reaching a won tablebase position sooner
+constexpr int TB_WIN       = MATE_BOUND - 1;
+constexpr int TB_WIN_BOUND = TB_WIN - MAX_PLY;
+
+// everything that can be passed to the "go" command. zero means no limit
+struct SearchLimits {
+    int      depth     = MAX_PLY;
+    uint64_t nodes     = 0;
+    int64_t  movetime  = 0;
+    int64_t  time[2]   = { 0, 0 };
+    int64_t  inc[2]    = { 0, 0 };
+    int      movestogo = 0;
+    bool     infinite  = false;
+
+    // look for a mate in this many moves instead of searching normally
+    int      mate      = 0;
+};
+
+struct SearchResult {
+    Move     best;
+    int      score = 0;
+    int      depth = 0;
+    uint64_t nodes = 0;
+};
+
+// a single search thread. all searchers may share the transposition table, but
+// everything else (the evaluation stack, move ordering tables) is owned by one
+// searcher only. the accumulator stack is large, so these should be heap-allocated
+class Searcher {
+public:
+    explicit Searcher(TranspositionTable &tt) : tt(tt) {}
+
+    // don't print any info lines (when searching from offline tools)
+    bool silent = false;
+
+    // whether the search ages the transposition table. when the table is shared by
+    // several threads, it must be aged just once before all of them start instead
+    bool age_tt = true;
+
+    // whether the syzygy tables are probed (if any are loaded)
+    bool use_tb = true;
+
+    // when several threads search together, the node limit applies to their total.
+    // every thread adds its nodes to this shared counter in small batches
+    std::atomic<uint64_t> *shared_nodes = nullptr;
+
+    SearchResult search(const Board &board, const std::vector<uint64_t> &history, const SearchLimits &limits);
+
+    // may be called from any thread, the search returns as soon as possible. the
+    // flag stays set until it's reset, so even a search, which hasn't started
+    // yet, can't miss it. it must be reset before starting the next search
+    void stop()       { stop_flag.store(true,  std::memory_order_relaxed); }
+    void reset_stop() { stop_flag.store(false, std::memory_order_relaxed); }
+
+    // forget the move ordering statistics (new game)
+    void clear();
+
+    [[nodiscard]] uint64_t node_count() const { return nodes; }
+
+    // the score as printed in "info" lines ("cp 25" or "mate 3")
+    [[nodiscard]] static std::string score_to_str(int score);
+
+    // only counted when built with the KREVETA_STATS option
+    [[nodiscard]] const SearchStats &stats() const { return search_stats; }
+
+#ifdef KREVETA_TREE_LOG
+    // appends the searched trees to the file. an empty path stops the recording
+    void set_tree_log(const std::string &path);
+#endif
+
+private:
+    TranspositionTable &tt;
+    AccumulatorStack    acc;
+
+    std::atomic<bool> stop_flag = false;
+    bool              stopped   = false;
+
+    uint64_t nodes      = 0;
+    uint64_t tb_hits    = 0;
+
+    // the nodes already added to the shared counter
+    uint64_t shared_reported = 0;
+
+    SearchStats search_stats;
+
+#ifdef KREVETA_TREE_LOG
+    std::unique_ptr<TreeLog> tree_log;
+#endif
+
+    int      root_depth = 0;
+
+    // the legal moves in the root, possibly filtered by the tablebases. when
+    // the root moves were ranked by the tablebases, they aren't probed in the search
+    Move root_moves[MAX_MOVES];
+    int  root_count  = 0;
+    bool tb_probing  = false;
+
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point start_time;
+    int64_t soft_limit = 0;
+    int64_t hard_limit = 0;
+
+    // milliseconds after which the root moves are reported as they are searched
+    static constexpr int64_t CURRMOVE_DELAY = 1000;
+
+    // keys of the game history followed by the current search path
+    std::vector<uint64_t> keys;
+
+    Move killers[MAX_PLY][2]{};
+    int  history_table[2][64][64]{};
+
+    Move pv[MAX_PLY][MAX_PLY]{};
+    int  pv_length[MAX_PLY]{};
+
+    void allocate_time(Color color);
+    [[nodiscard]] int64_t elapsed() const;
+    [[nodiscard]] bool should_stop();
+    [[nodiscard]] uint64_t limit_nodes();
+
+    int negamax(const Board &board, int depth, int ply, int alpha, int beta, bool null_allowed);
+    int qsearch(const Board &board, int ply, int alpha, int beta);
+
+    [[nodiscard]] bool is_repetition(const Board &board) const;
+
+    void score_moves(const Move *moves, int *scores, int count, Move tt_move, int ply, Color color) const;
+    void update_quiet(Move move, int depth, int ply, Color color);
+
+    void print_info(int depth, int score) const;
+    void print_currmove(int depth, Move move, int number) const;
+};
+
+}
+
+#endif //SEARCH_H
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <atomic>
+#include <format>
+
+#include "smp.h"
+
+#include "src/trace.h"
+
+namespace Kreveta {
+
+LazySMP::LazySMP(TranspositionTable &tt, const int threads) : tt(tt) {
+    set_threads(threads);
+}
+
+void LazySMP::set_threads(int threads) {
+    threads = std::max(threads, 1);
+
+    searchers.clear();
+    for (int i = 0; i < threads; i++) {
+        searchers.push_back(std::make_unique<Searcher>(tt));
+
+        // the helpers would only confuse the gui with their own info lines
+        searchers.back()->silent = i != 0;
+        searchers.back()->age_tt = threads == 1;
+    }
+
+    pool = threads > 1
+        ? std::make_unique<ThreadPool>(threads)
+        : nullptr;
+
+#ifdef KREVETA_TREE_LOG
+    set_tree_log(tree_log_prefix);
+#endif
+}
+
+SearchResult LazySMP::search(const Board &board, const std::vector<uint64_t> &history, const SearchLimits &limits) {
+    if (!pool)
+        return searchers[0]->search(board, history, limits);
+
+    tt.new_search();
+
+    // the node limit applies to all threads together
+    std::atomic<uint64_t> total_nodes = 0;
+    for (const auto &searcher : searchers)
+        searcher->shared_nodes = limits.nodes ? &total_nodes : nullptr;
+
+    SearchResult result;
+
+#ifdef KREVETA_TRACE
+    int64_t main_finished = 0;
+#endif
+
+    pool->run([&](const int thread) {
+        if (thread != 0) {
+            (void)searchers[thread]->search(board, history, limits);
+            return;
+        }
+
+        result = searchers[0]->search(board, history, limits);
+
+#ifdef KREVETA_TRACE
+        main_finished = Trace::now();
+#endif
+
+        for (std::size_t i = 1; i < searchers.size(); i++)
+            searchers[i]->stop();
+    });
+
+    // the helpers should finish right after being stopped
+#ifdef KREVETA_TRACE
+    Trace::record("helper wait", main_finished, Trace::now());
+#endif
+
+    // all threads are finished here, so their counters can be read safely
+    result.nodes = 0;
+    for (const auto &searcher : searchers) {
+        result.nodes += searcher->node_count();
+        searcher->shared_nodes = nullptr;
+    }
+
+    return result;
+}
+
+void LazySMP::stop() {
+    for (const auto &searcher : searchers)
+        searcher->stop();
+}
+
+void LazySMP::reset_stop() {
+    for (const auto &searcher : searchers)
+        searcher->reset_stop();
+}
+
+void LazySMP::clear() {
+    for (const auto &searcher : searchers)
+        searcher->clear();
+}
+
+void LazySMP::set_silent(const bool silent) {
+    searchers[0]->silent = silent;
+}
+
+void LazySMP::set_tablebases(const bool enabled) {
+    for (const auto &searcher : searchers)
+        searcher->use_tb = enabled;
+}
+
+#ifdef KREVETA_TREE_LOG
+void LazySMP::set_tree_log(const std::string &prefix) {
+    tree_log_prefix = prefix;
+
+    for (std::size_t i = 0; i < searchers.size(); i++)
+        searchers[i]->set_tree_log(prefix.empty() ? "" : std::format("{}.{}", prefix, i));
+}
+#endif
+
+SearchStats LazySMP::stats() const {
+    SearchStats total;
+    for (const auto &searcher : searchers)
+        total += searcher->stats();
+
+    return total;
+}
+
+}
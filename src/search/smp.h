@@ -0,0 +1,61 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "search.h"
+#include "src/threads/thread_pool.h"
+
+namespace Kreveta {
+
+// lazy smp: all threads search the same position independently and only share
+// the transposition table, so the helpers mostly fill it with results the main
+// thread can use. the main thread alone reports the search and picks the move,
+// and the helpers are stopped as soon as it's finished
+class LazySMP {
+public:
+    explicit LazySMP(TranspositionTable &tt, int threads = 1);
+
+    // changing the number of threads also forgets the move ordering statistics
+    void set_threads(int threads);
+    [[nodiscard]] int thread_count() const { return static_cast<int>(searchers.size()); }
+
+    // the returned node count is the total of all threads
+    SearchResult search(const Board &board, const std::vector<uint64_t> &history, const SearchLimits &limits);
+
+    void stop();
+    void reset_stop();
+    void clear();
+
+    // don't print any info lines
+    void set_silent(bool silent);
+
+    // don't probe the syzygy tables, even when they are loaded
+    void set_tablebases(bool enabled);
+
+    // the counters of all threads from the last search
+    [[nodiscard]] SearchStats stats() const;
+
+#ifdef KREVETA_TREE_LOG
+    // every thread records its tree into its own file, "<prefix>.<thread>"
+    void set_tree_log(const std::string &prefix);
+#endif
+
+private:
+    TranspositionTable &tt;
+
+    // the first searcher is the main thread. with a single thread,
+    // the search runs directly on the caller's thread
+    std::vector<std::unique_ptr<Searcher>> searchers;
+    std::unique_ptr<ThreadPool>            pool;
+
+#ifdef KREVETA_TREE_LOG
+    std::string tree_log_prefix;
+#endif
+};
+
+}
+
+#endif //SMP_H
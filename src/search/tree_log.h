@@ -0,0 +1,119 @@
+#ifndef TREE_LOG_H
+#define TREE_LOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "src/movegen/move.h"
+
+namespace Kreveta {
+
+enum TreeEvent : uint8_t {
+
+    // a new iteration of the search starts (the depth is the iteration depth)
+    TREE_ITERATION,
+
+    // a child was searched: with the full depth, with a reduced depth, or again
+    // after the reduced or null window search failed high
+    TREE_CHILD,
+    TREE_CHILD_REDUCED,
+    TREE_CHILD_RESEARCH,
+
+    // the node was cut off by a move, the index of the move is stored
+    TREE_BETA_CUTOFF,
+
+    // the node was pruned before searching any moves
+    TREE_TT_CUTOFF,
+    TREE_TB_CUTOFF,
+    TREE_REVERSE_FUTILITY,
+    TREE_NULL_MOVE,
+
+    TREE_EVENT_COUNT
+};
+
+// a single record of the search tree. the scores and the window are from the point
+// of view of the side to move in the node, where the event happened (for children,
+// that is the parent node), and the ply is the ply of that node
+struct TreeRecord {
+    static constexpr uint8_t NO_CUTOFF = 0xFF;
+
+    uint32_t move;
+    int16_t  alpha;
+    int16_t  beta;
+    int16_t  score;
+    uint8_t  ply;
+    int8_t   depth;
+    uint8_t  reduction;
+    uint8_t  cutoff;
+    uint8_t  event;
+    uint8_t  reserved;
+
+    [[nodiscard]] static TreeRecord make(const TreeEvent event, const int ply, const int depth, const int alpha,
+        const int beta, const int score, const Move move = Move(), const int reduction = 0, const int cutoff = NO_CUTOFF) {
+
+        return {
+            .move      = move.raw(),
+            .alpha     = static_cast<int16_t>(alpha),
+            .beta      = static_cast<int16_t>(beta),
+            .score     = static_cast<int16_t>(score),
+            .ply       = static_cast<uint8_t>(ply),
+            .depth     = static_cast<int8_t>(depth),
+            .reduction = static_cast<uint8_t>(reduction),
+            .cutoff    = static_cast<uint8_t>(cutoff),
+            .event     = event,
+            .reserved  = 0
+        };
+    }
+};
+
+static_assert(sizeof(TreeRecord) == 16, "tree records must stay compact");
+
+// every search thread has its own writer, so recording needs no locks. the records
+// are buffered and written in large blocks, since the search visits millions of nodes
+class TreeLog {
+public:
+    static constexpr std::size_t BUFFER_SIZE = 1 << 16;
+
+    explicit TreeLog(const std::string &path) : file(path, std::ios::binary | std::ios::app) {
+        buffer.reserve(BUFFER_SIZE);
+    }
+
+    ~TreeLog() { flush(); }
+
+    TreeLog(const TreeLog &)            = delete;
+    TreeLog &operator=(const TreeLog &) = delete;
+
+    [[nodiscard]] bool is_open() const { return file.is_open(); }
+
+    void write(const TreeRecord &record) {
+        buffer.push_back(record);
+
+        if (buffer.size() == BUFFER_SIZE)
+            flush();
+    }
+
+    void flush() {
+        file.write(reinterpret_cast<const char *>(buffer.data()),
+            static_cast<std::streamsize>(buffer.size() * sizeof(TreeRecord)));
+
+        file.flush();
+        buffer.clear();
+    }
+
+private:
+    std::ofstream           file;
+    std::vector<TreeRecord> buffer;
+};
+
+// the recording is only compiled with the KREVETA_TREE_LOG option
+#ifdef KREVETA_TREE_LOG
+#define TREE_RECORD(...) do { if (tree_log) tree_log->write(TreeRecord::make(__VA_ARGS__)); } while (false)
+#else
+#define TREE_RECORD(...) ((void)0)
+#endif
+
+}
+
+#endif //TREE_LOG_H
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <vector>
+
+#include "tt.h"
+
+#include "src/stats.h"
+#include "src/trace.h"
+#include "src/uci.h"
+#include "src/zobrist.h"
+#include "src/io/mapped_file.h"
+
+namespace Kreveta {
+
+TranspositionTable::TranspositionTable(const std::size_t mb) {
+    resize(mb);
+}
+
+void TranspositionTable::resize(const std::size_t mb) {
+    count = std::max<std::size_t>(mb, 1) * (1 << 20) / sizeof(TTEntry);
+
+    entries = std::make_unique_for_overwrite<TTEntry[]>(count);
+    clear();
+}
+
+void TranspositionTable::clear() {
+    TRACE_ZONE("hash clear");
+
+    std::memset(entries.get(), 0, count * sizeof(TTEntry));
+    age.store(0, std::memory_order_relaxed);
+}
+
+// the table doesn't have to be a power of two, so instead of masking the key we
+// map it into [0, count) by taking the upper half of a 128-bit multiplication
+std::size_t TranspositionTable::index(const uint64_t key) const {
+    return static_cast<std::size_t>(static_cast<unsigned __int128>(key) * count >> 64);
+}
+
+bool TranspositionTable::probe(const uint64_t key, TTData &out) const {
+    TTEntry &entry = entries[index(key)];
+    STATS_INC(STAT_TT_PROBES);
+
+    const uint64_t check = std::atomic_ref(entry.check).load(std::memory_order_relaxed);
+    const uint64_t data  = std::atomic_ref(entry.data).load(std::memory_order_relaxed);
+
+    if ((check ^ data) != key || data == 0)
+        return false;
+
+    STATS_INC(STAT_TT_HITS);
+
+    out = std::bit_cast<TTData>(data);
+    return true;
+}
+
+void TranspositionTable::store(const uint64_t key, const Move move, const int score, const int depth, const Bound bound) {
+    TTEntry &entry = entries[index(key)];
+
+    const uint64_t old_check = std::atomic_ref(entry.check).load(std::memory_order_relaxed);
+    const uint64_t old_data  = std::atomic_ref(entry.data).load(std::memory_order_relaxed);
+
+    const auto old      = std::bit_cast<TTData>(old_data);
+    const bool same_key = (old_check ^ old_data) == key;
+
+    const uint8_t age = this->age.load(std::memory_order_relaxed);
+
+    // deeper entries of the same search are more valuable, so they are only
+    // replaced by exact scores or searches of a similar depth
+    if (same_key || old.age() != age || bound == BOUND_EXACT || depth + 3 >= old.depth) {
+
+        // keep the old move if we didn't find a better one
+        const uint32_t raw = move == Move() && same_key
+            ? old.move
+            : move.raw();
+
+        const TTData data {
+            .move      = raw,
+            .score     = static_cast<int16_t>(score),
+            .depth     = static_cast<uint8_t>(depth),
+            .bound_age = static_cast<uint8_t>(age << 2 | bound)
+        };
+
+        const auto new_data = std::bit_cast<uint64_t>(data);
+
+        std::atomic_ref(entry.check).store(key ^ new_data, std::memory_order_relaxed);
+        std::atomic_ref(entry.data).store(new_data, std::memory_order_relaxed);
+    }
+}
+
+int TranspositionTable::hashfull() const {
+    const uint8_t age = this->age.load(std::memory_order_relaxed);
+    int used = 0;
+
+    for (std::size_t i = 0; i < std::min<std::size_t>(count, 1000); i++) {
+        const auto data = std::bit_cast<TTData>(entries[i].data);
+        if (entries[i].data && data.age() == age)
+            used++;
+    }
+
+    return used;
+}
+
+bool TranspositionTable::save(const std::string &path, const int min_depth) const {
+    std::ofstream output(path, std::ios::binary);
+    if (!output) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    TTFileHeader header{};
+    std::memcpy(header.magic, TTFileHeader::MAGIC, sizeof(header.magic));
+
+    header.version    = TTFileHeader::VERSION;
+    header.entry_size = sizeof(TTEntry);
+    header.zobrist    = ZOBRIST.side;
+    header.age        = age.load(std::memory_order_relaxed);
+    header.min_depth  = static_cast<uint8_t>(std::clamp(min_depth, 0, 255));
+
+    // the count isn't known until all entries are written
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    // the entries are collected into a buffer, so we don't write them one by one
+    constexpr std::size_t BUFFER_SIZE = 1 << 16;
+    std::vector<TTEntry> buffer;
+    buffer.reserve(BUFFER_SIZE);
+
+    const auto flush = [&] {
+        output.write(reinterpret_cast<const char *>(buffer.data()),
+            static_cast<std::streamsize>(buffer.size() * sizeof(TTEntry)));
+
+        header.count += buffer.size();
+        buffer.clear();
+    };
+
+    for (std::size_t i = 0; i < count; i++) {
+        const TTEntry &entry = entries[i];
+
+        if (entry.data == 0 || std::bit_cast<TTData>(entry.data).depth < header.min_depth)
+            continue;
+
+        buffer.push_back(entry);
+        if (buffer.size() == BUFFER_SIZE)
+            flush();
+    }
+
+    flush();
+
+    output.seekp(0);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    if (!output) {
+        UCI::log(std::format("Unable to write '{}'", path));
+        return false;
+    }
+
+    return true;
+}
+
+bool TranspositionTable::load(const std::string &path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    TTFileHeader header;
+    if (file.size() < sizeof(header)) {
+        UCI::log(std::format("'{}' is not a hash file", path));
+        return false;
+    }
+
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    // the count is compared to the number of entries, which fit into the file, first,
+    // since a corrupted count could overflow when computing the expected file size
+    if (std::memcmp(header.magic, TTFileHeader::MAGIC, sizeof(header.magic)) != 0
+        || header.entry_size != sizeof(TTEntry)
+        || header.count > (file.size() - sizeof(header)) / sizeof(TTEntry)
+        || file.size() != sizeof(header) + header.count * sizeof(TTEntry)) {
+
+        UCI::log(std::format("'{}' is not a hash file", path));
+        return false;
+    }
+
+    if (header.version != TTFileHeader::VERSION || header.zobrist != ZOBRIST.side) {
+        UCI::log(std::format("'{}' was saved by an incompatible version", path));
+        return false;
+    }
+
+    clear();
+    file.advise_sequential();
+
+    const unsigned char *data = file.data() + sizeof(header);
+
+    for (std::size_t i = 0; i < header.count; i++) {
+        TTEntry saved;
+        std::memcpy(&saved, data + i * sizeof(TTEntry), sizeof(TTEntry));
+
+        const uint64_t key = saved.check ^ saved.data;
+        TTEntry &entry     = entries[index(key)];
+
+        // a smaller table has fewer slots than the saved one,
+        // so the deepest entry of every slot is kept
+        if (entry.data == 0 || std::bit_cast<TTData>(entry.data).depth < std::bit_cast<TTData>(saved.data).depth)
+            entry = saved;
+    }
+
+    // the loaded entries belong to the current search
+    age.store(header.age, std::memory_order_relaxed);
+    return true;
+}
+
+}
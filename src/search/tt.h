@@ -0,0 +1,103 @@
+#ifndef TT_H
+#define TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "src/movegen/move.h"
+
+namespace Kreveta {
+
+enum Bound : uint8_t {
+    BOUND_NONE  = 0,
+    BOUND_UPPER = 1,
+    BOUND_LOWER = 2,
+    BOUND_EXACT = 3
+};
+
+// everything stored about a single position. it fits into 64 bits,
+// so it can be written and read atomically along with the key
+struct TTData {
+    uint32_t move;
+    int16_t  score;
+    uint8_t  depth;
+
+    // the lowest two bits are the bound, the rest is the age
+    uint8_t  bound_age;
+
+    [[nodiscard]] Bound bound() const { return static_cast<Bound>(bound_age & 3); }
+    [[nodiscard]] uint8_t age() const { return bound_age >> 2; }
+};
+
+static_assert(sizeof(TTData) == 8, "transposition table data must fit into 64 bits");
+
+// the key is stored xored with the data. when two threads write the same entry at once,
+// the key and data may end up coming from different writes, which then simply doesn't
+// match the key when probing, so the table doesn't need any locks
+struct TTEntry {
+    uint64_t check;
+    uint64_t data;
+};
+
+// the header of a saved table. the entries follow right after it
+struct TTFileHeader {
+    static constexpr char     MAGIC[8] = { 'K', 'R', 'V', 'T', 'T', 'B', 'L', '\0' };
+    static constexpr uint32_t VERSION  = 1;
+
+    char     magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+
+    // a single zobrist key, so tables hashed differently are rejected
+    uint64_t zobrist;
+    uint64_t count;
+
+    uint8_t  age;
+    uint8_t  min_depth;
+    uint8_t  padding[6];
+};
+
+static_assert(sizeof(TTFileHeader) == 40, "the table file header must not contain any implicit padding");
+
+class TranspositionTable {
+public:
+    explicit TranspositionTable(std::size_t mb = 16);
+
+    void resize(std::size_t mb);
+    void clear();
+
+    // must be called before each search, so older entries get replaced first. the
+    // searches only read the age, so it may change while they are running, but it
+    // must only be increased by one thread at a time
+    void new_search() { age.store((age.load(std::memory_order_relaxed) + 1) & 63, std::memory_order_relaxed); }
+
+    [[nodiscard]] bool probe(uint64_t key, TTData &out) const;
+    void store(uint64_t key, Move move, int score, int depth, Bound bound);
+
+    // write the table into a file. entries shallower than the minimum
+    // depth are left out, which makes the file much smaller
+    bool save(const std::string &path, int min_depth = 0) const;
+
+    // replace the contents of the table with a saved one. the table keeps its size,
+    // so the file doesn't have to come from a table of the same size
+    bool load(const std::string &path);
+
+    [[nodiscard]] std::size_t size_mb() const { return count * sizeof(TTEntry) >> 20; }
+
+    // an estimate of how full the table is in permille (for "info hashfull")
+    [[nodiscard]] int hashfull() const;
+
+private:
+    std::unique_ptr<TTEntry[]> entries;
+    std::size_t                count = 0;
+    std::atomic<uint8_t>       age   = 0;
+
+    [[nodiscard]] std::size_t index(uint64_t key) const;
+};
+
+}
+
+#endif //TT_H
@@ -0,0 +1,83 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+
+namespace Kreveta {
+
+enum Stat : uint8_t {
+    STAT_MOVEGEN_CALLS,
+    STAT_MOVES_GENERATED,
+    STAT_NODES,
+    STAT_QNODES,
+    STAT_TT_PROBES,
+    STAT_TT_HITS,
+    STAT_BETA_CUTOFFS,
+    STAT_NULL_TRIES,
+    STAT_NULL_CUTOFFS,
+    STAT_LMR_SEARCHES,
+    STAT_LMR_RESEARCHES,
+    STAT_COUNT
+};
+
+// beta cutoffs are counted by the index of the move, which caused them. the
+// last slot collects all later moves
+constexpr int CUTOFF_SLOTS = 8;
+
+// the counters of a single search thread. every thread writes only its own
+// counters, and they are aligned to a cache line, so the threads don't keep
+// invalidating each other's caches
+struct alignas(64) SearchStats {
+    uint64_t counters[STAT_COUNT]{};
+    uint64_t cutoffs[CUTOFF_SLOTS]{};
+
+    SearchStats &operator+=(const SearchStats &other) {
+        for (int i = 0; i < STAT_COUNT; i++)   counters[i] += other.counters[i];
+        for (int i = 0; i < CUTOFF_SLOTS; i++) cutoffs[i]  += other.cutoffs[i];
+        return *this;
+    }
+};
+
+// the counters are only compiled with the KREVETA_STATS option, otherwise all
+// the macros below expand to nothing, so the hot paths aren't slowed down at all
+class Stats {
+public:
+    // the counters of the search running on this thread, or null outside
+    // of a search (move generation is also used by the offline tools)
+    static inline thread_local SearchStats *local = nullptr;
+
+    static void add(const Stat stat, const uint64_t n) {
+        if (local) local->counters[stat] += n;
+    }
+
+    static void cutoff(const int index) {
+        if (!local)
+            return;
+
+        local->counters[STAT_BETA_CUTOFFS]++;
+        local->cutoffs[index < CUTOFF_SLOTS ? index : CUTOFF_SLOTS - 1]++;
+    }
+};
+
+// attaches the counters to the current thread until the end of the scope
+struct StatsScope {
+    explicit StatsScope(SearchStats &stats) { Stats::local = &stats; }
+    ~StatsScope() { Stats::local = nullptr; }
+
+    StatsScope(const StatsScope &)            = delete;
+    StatsScope &operator=(const StatsScope &) = delete;
+};
+
+#ifdef KREVETA_STATS
+#define STATS_ADD(stat, n)   Stats::add(stat, n)
+#define STATS_CUTOFF(index)  Stats::cutoff(index)
+#else
+#define STATS_ADD(stat, n)   ((void)0)
+#define STATS_CUTOFF(index)  ((void)0)
+#endif
+
+#define STATS_INC(stat)      STATS_ADD(stat, 1)
+
+}
+
+#endif //STATS_H
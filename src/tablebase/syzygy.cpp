@@ -0,0 +1,1271 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
+#include "syzygy.h"
+
+#include "src/bitboard.h"
+#include "src/trace.h"
+#include "src/uci.h"
+#include "src/io/mapped_file.h"
+#include "src/movegen/movegen.h"
+
+namespace Kreveta {
+
+// the tables are generated with squares starting from a1 (and going by ranks),
+// while our squares start from a8, so all squares are first converted like this.
+// all squares in this file are the tablebase squares, unless stated otherwise
+static constexpr int to_tb_square(const int sq) { return sq ^ 56; }
+
+static constexpr int rank_of(const int sq)    { return sq >> 3; }
+static constexpr int file_of(const int sq)    { return sq & 7; }
+static constexpr int flip_rank(const int sq)  { return sq ^ 56; }
+static constexpr int flip_file(const int sq)  { return sq ^ 7; }
+
+// positive below the a1-h8 diagonal, negative above it and zero on it
+static constexpr int off_diagonal(const int sq) { return rank_of(sq) - file_of(sq); }
+
+constexpr int TB_PIECES = 7;
+constexpr int MAX_DTZ   = 1 << 18;
+
+// pieces in the table files are numbered 1 (white pawn) to 6 (white king)
+// and 9 (black pawn) to 14 (black king), so the color is flipped by xoring 8
+static constexpr uint8_t tb_piece(const Color col, const PieceType pt) {
+    return static_cast<uint8_t>(pt + 1 + col * 8);
+}
+
+enum TBType { TB_WDL, TB_DTZ };
+
+enum TBFlag : uint8_t {
+    FLAG_STM          = 1,
+    FLAG_MAPPED       = 2,
+    FLAG_WIN_PLIES    = 4,
+    FLAG_LOSS_PLIES   = 8,
+    FLAG_WIDE         = 16,
+    FLAG_SINGLE_VALUE = 128
+};
+
+// the first four bytes of every file
+constexpr uint8_t TB_MAGIC[2][4] = {
+    { 0x71, 0xE8, 0x23, 0x5D }, // wdl
+    { 0xD7, 0x66, 0x0C, 0xA5 }  // dtz
+};
+
+// tables for computing the index of a position, filled in init
+static int     map_pawns[64];
+static int     map_b1h1h7[64];
+static int     map_a1d1d4[64];
+static int     map_kk[10][64];
+static int64_t binomial[6][64];
+static int64_t lead_pawn_idx[6][64];
+static int64_t lead_pawns_size[6][4];
+
+template<typename T, bool LittleEndian>
+static T read_number(const uint8_t *addr) {
+    T value;
+    std::memcpy(&value, addr, sizeof(T));
+
+    if constexpr (sizeof(T) > 1) {
+        if ((std::endian::native == std::endian::little) != LittleEndian)
+            value = std::byteswap(value);
+    }
+
+    return value;
+}
+
+// moves resetting the fifty-move counter don't have a valid dtz stored, but
+// the dtz right before such move is known from the result of the position
+static int dtz_before_zeroing(const WDLScore wdl) {
+    return wdl == WDL_WIN          ?  1
+         : wdl == WDL_CURSED_WIN   ?  101
+         : wdl == WDL_BLESSED_LOSS ? -101
+         : wdl == WDL_LOSS         ? -1 : 0;
+}
+
+static int sign_of(const int value) {
+    return (0 < value) - (value < 0);
+}
+
+// the values are compressed by recursive pairing: the most common pair of adjacent
+// symbols is replaced by a new symbol, over and over again. the symbols are then
+// encoded using a canonical huffman code
+using Sym = uint16_t;
+
+// the children of a symbol, two 12-bit numbers packed into three bytes
+struct LR {
+    uint8_t lr[3];
+
+    [[nodiscard]] Sym left()  const { return static_cast<Sym>((lr[1] & 0xF) << 8 | lr[0]); }
+    [[nodiscard]] Sym right() const { return static_cast<Sym>(lr[2] << 4 | lr[1] >> 4); }
+};
+
+static_assert(sizeof(LR) == 3);
+
+// a block number (4 bytes) and the offset within the block (2 bytes), little-endian
+constexpr std::size_t SPARSE_ENTRY_SIZE = 6;
+
+struct PairsData {
+    uint8_t     flags               = 0;
+    std::size_t block_size          = 0;
+    std::size_t span                = 0;
+    int         block_count         = 0;
+    int         max_sym_len         = 0;
+    int         min_sym_len         = 0;
+    std::size_t block_lengths_size  = 0;
+    std::size_t sparse_index_size   = 0;
+
+    const uint8_t *lowest_sym    = nullptr;
+    const LR      *btree         = nullptr;
+    const uint8_t *block_lengths = nullptr;
+    const uint8_t *sparse_index  = nullptr;
+    const uint8_t *data          = nullptr;
+
+    // base64[l - min_sym_len] is the lowest symbol of length l padded to 64 bits
+    std::vector<uint64_t> base64;
+
+    // how many values (minus one) the symbol expands to
+    std::vector<uint8_t> sym_len;
+
+    // the pieces in the order they are encoded in. the pieces of the same
+    // type and color form a group and are encoded together
+    uint8_t  pieces[TB_PIECES]{};
+    uint64_t group_idx[TB_PIECES + 1]{};
+    int      group_len[TB_PIECES + 1]{};
+
+    // where the dtz values of each result start in the map (dtz only)
+    uint16_t map_idx[4]{};
+
+    [[nodiscard]] uint16_t block_length(const std::size_t block) const {
+        return read_number<uint16_t, true>(block_lengths + block * 2);
+    }
+};
+
+template<TBType Type>
+struct TBTable {
+    using Ret = std::conditional_t<Type == TB_WDL, WDLScore, int>;
+
+    // the dtz tables only store one side to move
+    static constexpr int SIDES = Type == TB_WDL ? 2 : 1;
+
+    std::atomic<bool> ready = false;
+    MappedFile        file;
+
+    // the dtz values are stored in a smaller range and mapped back using this
+    const uint8_t *map = nullptr;
+
+    // the table is used for both colors, the key is the material
+    // with white as the stronger side, and the second the opposite
+    uint64_t key  = 0;
+    uint64_t key2 = 0;
+
+    int     piece_count       = 0;
+    bool    has_pawns         = false;
+    bool    has_unique_pieces = false;
+    uint8_t pawn_count[2]{};
+
+    // [side to move][file of the leading pawn]
+    PairsData items[SIDES][4];
+
+    PairsData *get(const int stm, const int file) {
+        return &items[stm % SIDES][has_pawns ? file : 0];
+    }
+};
+
+struct TableEntry {
+    TBTable<TB_WDL> *wdl;
+    TBTable<TB_DTZ> *dtz;
+};
+
+int Syzygy::max_cardinality = 0;
+
+static std::vector<std::string> tb_paths;
+
+// deques don't move their elements when growing, so the pointers stay valid
+static std::deque<TBTable<TB_WDL>> wdl_tables;
+static std::deque<TBTable<TB_DTZ>> dtz_tables;
+static std::unordered_map<uint64_t, TableEntry> tables;
+
+static void init_index_tables() {
+
+    // squares below the a1-h8 diagonal
+    int code = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        if (off_diagonal(sq) < 0)
+            map_b1h1h7[sq] = code++;
+    }
+
+    // squares in the a1-d1-d4 triangle, with the ones on the diagonal going last
+    std::vector<int> diagonal;
+    code = 0;
+    for (int rank = 0; rank < 4; rank++) {
+        for (int file = 0; file < 4; file++) {
+            const int sq = rank * 8 + file;
+
+            if (off_diagonal(sq) < 0)
+                map_a1d1d4[sq] = code++;
+            else if (off_diagonal(sq) == 0)
+                diagonal.push_back(sq);
+        }
+    }
+
+    for (const int sq : diagonal)
+        map_a1d1d4[sq] = code++;
+
+    // all 462 legal placements of two kings, where the first one is in the a1-d1-d4
+    // triangle, and if it's on the diagonal, the second one isn't above it
+    std::vector<std::pair<int, int>> both_on_diagonal;
+    code = 0;
+    for (int idx = 0; idx < 10; idx++) {
+        for (int s1 = 0; s1 < 28; s1++) {
+            if (file_of(s1) > 3 || rank_of(s1) > 3 || map_a1d1d4[s1] != idx || (idx == 0 && s1 != 1))
+                continue;
+
+            for (int s2 = 0; s2 < 64; s2++) {
+                const bool touching = std::abs(rank_of(s1) - rank_of(s2)) <= 1
+                                   && std::abs(file_of(s1) - file_of(s2)) <= 1;
+
+                if (touching)
+                    continue;
+
+                if (!off_diagonal(s1) && off_diagonal(s2) > 0)
+                    continue;
+
+                if (!off_diagonal(s1) && !off_diagonal(s2))
+                    both_on_diagonal.emplace_back(idx, s2);
+                else map_kk[idx][s2] = code++;
+            }
+        }
+    }
+
+    for (const auto &[idx, s2] : both_on_diagonal)
+        map_kk[idx][s2] = code++;
+
+    // binomial[k][n] is the number of ways to choose k elements out of n
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++) {
+        for (int k = 0; k < 6 && k <= n; k++) {
+            binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0)
+                           + (k < n ? binomial[k][n - 1]     : 0);
+        }
+    }
+
+    // the pawns are numbered from the edges and the lower ranks, so the leading pawn
+    // (the one with the highest number) is the one closest to the edge. for each
+    // leading pawn square, we count the placements of the other leading pawns
+    int available = 47;
+    for (int lead = 1; lead <= 5; lead++) {
+        for (int file = 0; file < 4; file++) {
+            int64_t idx = 0;
+
+            for (int rank = 1; rank < 7; rank++) {
+                const int sq = rank * 8 + file;
+
+                if (lead == 1) {
+                    map_pawns[sq]            = available--;
+                    map_pawns[flip_file(sq)] = available--;
+                }
+
+                lead_pawn_idx[lead][sq] = idx;
+                idx += binomial[lead - 1][map_pawns[sq]];
+            }
+
+            lead_pawns_size[lead][file] = idx;
+        }
+    }
+}
+
+static bool pawns_compare(const int a, const int b) {
+    return map_pawns[a] < map_pawns[b];
+}
+
+// read the values of the pieces' groups. the first group is either the leading
+// pawns, or three unique pieces, or just the two kings if there aren't enough
+// unique pieces. all other groups are pieces of the same type and color
+template<TBType Type>
+static void set_groups(const TBTable<Type> &e, PairsData *d, const int order[2], const int file) {
+    int n = 0;
+    int first_len = e.has_pawns ? 0 : e.has_unique_pieces ? 3 : 2;
+
+    d->group_len[n] = 1;
+
+    for (int i = 1; i < e.piece_count; i++) {
+        if (--first_len > 0 || d->pieces[i] == d->pieces[i - 1])
+            d->group_len[n]++;
+        else d->group_len[++n] = 1;
+    }
+
+    d->group_len[++n] = 0;
+
+    // the groups are encoded in the order stored in the file, where the first
+    // group is at order[0] and the remaining pawns (if both sides have pawns) at
+    // order[1]. the index of a position is then g1 * N(g2) * N(g3) + g2 * N(g3) + g3
+    const bool pp   = e.has_pawns && e.pawn_count[1];
+    int next        = pp ? 2 : 1;
+    int free_sq     = 64 - d->group_len[0] - (pp ? d->group_len[1] : 0);
+    uint64_t idx    = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+        if (k == order[0]) {
+            d->group_idx[0] = idx;
+            idx *= e.has_pawns         ? lead_pawns_size[d->group_len[0]][file]
+                 : e.has_unique_pieces ? 31332 : 462;
+        }
+        else if (k == order[1]) {
+            d->group_idx[1] = idx;
+            idx *= binomial[d->group_len[1]][48 - d->group_len[0]];
+        }
+        else {
+            d->group_idx[next] = idx;
+            idx *= binomial[d->group_len[next]][free_sq];
+            free_sq -= d->group_len[next++];
+        }
+    }
+
+    d->group_idx[n] = idx;
+}
+
+// the number of values a symbol expands to is the sum of both of its children
+static uint8_t set_sym_len(PairsData *d, const Sym s, std::vector<bool> &visited) {
+    visited[s] = true;
+
+    const Sym right = d->btree[s].right();
+    if (right == 0xFFF)
+        return 0;
+
+    const Sym left = d->btree[s].left();
+
+    if (!visited[left])  d->sym_len[left]  = set_sym_len(d, left, visited);
+    if (!visited[right]) d->sym_len[right] = set_sym_len(d, right, visited);
+
+    return d->sym_len[left] + d->sym_len[right] + 1;
+}
+
+static const uint8_t *set_sizes(PairsData *d, const uint8_t *data) {
+    d->flags = *data++;
+
+    // all positions have the same value, which is stored right away
+    if (d->flags & FLAG_SINGLE_VALUE) {
+        d->block_count        = 0;
+        d->block_lengths_size = 0;
+        d->sparse_index_size  = 0;
+        d->span               = 0;
+        d->block_size         = 0;
+        d->min_sym_len        = *data++;
+        return data;
+    }
+
+    // the last group index is the number of positions in the table
+    const uint64_t tb_size = d->group_idx[std::find(d->group_len, d->group_len + TB_PIECES, 0) - d->group_len];
+
+    d->block_size        = 1ULL << *data++;
+    d->span              = 1ULL << *data++;
+    d->sparse_index_size = static_cast<std::size_t>((tb_size + d->span - 1) / d->span);
+
+    const int padding = *data++;
+    d->block_count = static_cast<int>(read_number<uint32_t, true>(data));
+    data += sizeof(uint32_t);
+
+    // the padding makes sure the sparse index never points outside the table
+    d->block_lengths_size = d->block_count + padding;
+
+    d->max_sym_len = *data++;
+    d->min_sym_len = *data++;
+    d->lowest_sym  = data;
+
+    d->base64.resize(d->max_sym_len - d->min_sym_len + 1);
+
+    const auto lowest = [&](const std::size_t i) {
+        return read_number<Sym, true>(d->lowest_sym + i * sizeof(Sym));
+    };
+
+    // longer symbols have lower values in the canonical code, so the lowest symbol
+    // of each length (padded to 64 bits) tells which length the next symbol has
+    for (int i = static_cast<int>(d->base64.size()) - 2; i >= 0; i--)
+        d->base64[i] = (d->base64[i + 1] + lowest(i) - lowest(i + 1)) / 2;
+
+    for (std::size_t i = 0; i < d->base64.size(); i++)
+        d->base64[i] <<= 64 - i - d->min_sym_len;
+
+    data += d->base64.size() * sizeof(Sym);
+
+    d->sym_len.resize(read_number<uint16_t, true>(data));
+    data += sizeof(uint16_t);
+
+    d->btree = reinterpret_cast<const LR *>(data);
+
+    std::vector<bool> visited(d->sym_len.size());
+    for (std::size_t s = 0; s < d->sym_len.size(); s++) {
+        if (!visited[s])
+            d->sym_len[s] = set_sym_len(d, static_cast<Sym>(s), visited);
+    }
+
+    return data + d->sym_len.size() * sizeof(LR) + (d->sym_len.size() & 1);
+}
+
+static const uint8_t *set_dtz_map(TBTable<TB_WDL> &, const uint8_t *data, int) {
+    return data;
+}
+
+static const uint8_t *set_dtz_map(TBTable<TB_DTZ> &e, const uint8_t *data, const int max_file) {
+    e.map = data;
+
+    for (int f = 0; f <= max_file; f++) {
+        PairsData *d = e.get(0, f);
+
+        if (!(d->flags & FLAG_MAPPED))
+            continue;
+
+        if (d->flags & FLAG_WIDE) {
+            data += reinterpret_cast<uintptr_t>(data) & 1;
+
+            for (uint16_t &idx : d->map_idx) {
+                idx   = static_cast<uint16_t>((data - e.map) / 2 + 1);
+                data += 2 * read_number<uint16_t, true>(data) + 2;
+            }
+        }
+        else {
+            for (uint16_t &idx : d->map_idx) {
+                idx   = static_cast<uint16_t>(data - e.map + 1);
+                data += *data + 1;
+            }
+        }
+    }
+
+    return data + (reinterpret_cast<uintptr_t>(data) & 1);
+}
+
+// read the headers of the just mapped file
+template<TBType Type>
+static bool set(TBTable<Type> &e, const uint8_t *data) {
+    constexpr uint8_t SPLIT     = 1;
+    constexpr uint8_t HAS_PAWNS = 2;
+
+    if (e.has_pawns != static_cast<bool>(*data & HAS_PAWNS)
+     || (e.key != e.key2) != static_cast<bool>(*data & SPLIT))
+        return false;
+
+    data++;
+
+    const int  sides    = TBTable<Type>::SIDES == 2 && e.key != e.key2 ? 2 : 1;
+    const int  max_file = e.has_pawns ? 3 : 0;
+    const bool pp       = e.has_pawns && e.pawn_count[1];
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++)
+            *e.get(i, f) = PairsData();
+
+        const int order[2][2] = {
+            { *data & 0xF, pp ? *(data + 1) & 0xF : 0xF },
+            { *data >> 4,  pp ? *(data + 1) >> 4  : 0xF }
+        };
+
+        data += 1 + pp;
+
+        for (int k = 0; k < e.piece_count; k++, data++) {
+            for (int i = 0; i < sides; i++)
+                e.get(i, f)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+        }
+
+        for (int i = 0; i < sides; i++)
+            set_groups(e, e.get(i, f), order[i], f);
+    }
+
+    data += reinterpret_cast<uintptr_t>(data) & 1;
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++)
+            data = set_sizes(e.get(i, f), data);
+    }
+
+    data = set_dtz_map(e, data, max_file);
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+            PairsData *d = e.get(i, f);
+            d->sparse_index = data;
+            data += d->sparse_index_size * SPARSE_ENTRY_SIZE;
+        }
+    }
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+            PairsData *d = e.get(i, f);
+            d->block_lengths = data;
+            data += d->block_lengths_size * sizeof(uint16_t);
+        }
+    }
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+
+            // the compressed data is aligned to 64 bytes
+            data = reinterpret_cast<const uint8_t *>((reinterpret_cast<uintptr_t>(data) + 0x3F) & ~uintptr_t{0x3F});
+
+            PairsData *d = e.get(i, f);
+            d->data = data;
+            data += static_cast<std::size_t>(d->block_count) * d->block_size;
+        }
+    }
+
+    return true;
+}
+
+// the name of the file with the material of the board, stronger side first (e.g. "KRPvKR")
+static std::string table_name(const Board &board, const bool white_first) {
+    constexpr std::string_view NAMES = "PNBRQK";
+
+    std::string w;
+    std::string b;
+
+    for (int pt = PT_KING; pt >= PT_PAWN; pt--) {
+        w.append(std::popcount(board.pieces[COL_WHITE][pt]), NAMES[pt]);
+        b.append(std::popcount(board.pieces[COL_BLACK][pt]), NAMES[pt]);
+    }
+
+    return white_first ? w + 'v' + b : b + 'v' + w;
+}
+
+// the file is only mapped when the table is first probed. this may happen
+// from several search threads at the same time, so it's guarded by a lock
+template<TBType Type>
+static bool mapped(TBTable<Type> &e, const Board &board) {
+    static std::mutex mutex;
+
+    if (e.ready.load(std::memory_order_acquire))
+        return e.file.is_open();
+
+    std::lock_guard lock(mutex);
+
+    if (e.ready.load(std::memory_order_relaxed))
+        return e.file.is_open();
+
+    TRACE_ZONE("tablebase load");
+
+    const std::string name = table_name(board, e.key == board.material_key())
+        + (Type == TB_WDL ? ".rtbw" : ".rtbz");
+
+    for (const std::string &dir : tb_paths) {
+        if (!e.file.open((std::filesystem::path(dir) / name).string()))
+            continue;
+
+        // the size of a valid file is always 16 bytes above a multiple of 64
+        if (e.file.size() % 64 != 16 || std::memcmp(e.file.data(), TB_MAGIC[Type], 4) != 0) {
+            UCI::log(std::format("info string Corrupted tablebase file '{}'", name));
+            e.file.close();
+            break;
+        }
+
+        if (!set(e, e.file.data() + 4)) {
+            UCI::log(std::format("info string Corrupted tablebase file '{}'", name));
+            e.file.close();
+        }
+
+        break;
+    }
+
+    e.ready.store(true, std::memory_order_release);
+    return e.file.is_open();
+}
+
+// find the value at the index. the blocks are located using the sparse index, and
+// then the huffman symbols in the block are read until reaching the one, which
+// contains the value. the symbol is then expanded into its pairs until only the
+// single value is left
+static int decompress_pairs(const PairsData *d, const uint64_t idx) {
+    if (d->flags & FLAG_SINGLE_VALUE)
+        return d->min_sym_len;
+
+    // every span values there is an entry in the sparse index, which points to the
+    // block and the offset within the block of the value at k * span + span / 2
+    const uint64_t k = idx / d->span;
+
+    uint32_t block  = read_number<uint32_t, true>(d->sparse_index + k * SPARSE_ENTRY_SIZE);
+    int      offset = read_number<uint16_t, true>(d->sparse_index + k * SPARSE_ENTRY_SIZE + 4);
+
+    offset += static_cast<int>(idx % d->span) - static_cast<int>(d->span / 2);
+
+    // each block stores block_length + 1 values
+    while (offset < 0)
+        offset += d->block_length(--block) + 1;
+
+    while (offset > d->block_length(block))
+        offset -= d->block_length(block++) + 1;
+
+    const uint8_t *ptr = d->data + static_cast<uint64_t>(block) * d->block_size;
+
+    uint64_t buf64      = read_number<uint64_t, false>(ptr);
+    int      buf64_size = 64;
+    ptr += 8;
+
+    Sym sym;
+
+    while (true) {
+        int len = 0;
+
+        // the length of the symbol at the start of the buffer
+        while (buf64 < d->base64[len])
+            len++;
+
+        // all symbols of the same length are consecutive
+        sym = static_cast<Sym>((buf64 - d->base64[len]) >> (64 - len - d->min_sym_len));
+        sym += read_number<Sym, true>(d->lowest_sym + len * sizeof(Sym));
+
+        if (offset < d->sym_len[sym] + 1)
+            break;
+
+        offset -= d->sym_len[sym] + 1;
+        len    += d->min_sym_len;
+
+        buf64 <<= len;
+        buf64_size -= len;
+
+        if (buf64_size <= 32) {
+            buf64_size += 32;
+            buf64 |= static_cast<uint64_t>(read_number<uint32_t, false>(ptr)) << (64 - buf64_size);
+            ptr += 4;
+        }
+    }
+
+    // the children of a symbol are adjacent, so we go left or right
+    // depending on how many values the left child expands to
+    while (d->sym_len[sym]) {
+        const Sym left = d->btree[sym].left();
+
+        if (offset < d->sym_len[left] + 1) {
+            sym = left;
+        }
+        else {
+            offset -= d->sym_len[left] + 1;
+            sym = d->btree[sym].right();
+        }
+    }
+
+    return d->btree[sym].left();
+}
+
+static bool check_dtz_stm(TBTable<TB_WDL> *, int, int) {
+    return true;
+}
+
+static bool check_dtz_stm(TBTable<TB_DTZ> *e, const int stm, const int file) {
+    const uint8_t flags = e->get(stm, file)->flags;
+    return (flags & FLAG_STM) == stm || (e->key == e->key2 && !e->has_pawns);
+}
+
+static WDLScore map_score(TBTable<TB_WDL> *, int, const int value, WDLScore) {
+    return static_cast<WDLScore>(value - 2);
+}
+
+// the dtz values are sorted by how often they appear and stored as their order,
+// the map converts them back. the values may also be stored in moves, not plies
+static int map_score(TBTable<TB_DTZ> *e, const int file, int value, const WDLScore wdl) {
+    constexpr int WDL_MAP[] = { 1, 3, 0, 2, 0 };
+
+    const PairsData *d = e->get(0, file);
+
+    if (d->flags & FLAG_MAPPED) {
+        const int idx = d->map_idx[WDL_MAP[wdl + 2]] + value;
+
+        value = d->flags & FLAG_WIDE
+            ? read_number<uint16_t, true>(e->map + idx * 2)
+            : e->map[idx];
+    }
+
+    if ((wdl == WDL_WIN  && !(d->flags & FLAG_WIN_PLIES))
+     || (wdl == WDL_LOSS && !(d->flags & FLAG_LOSS_PLIES))
+     ||  wdl == WDL_CURSED_WIN
+     ||  wdl == WDL_BLESSED_LOSS)
+        value *= 2;
+
+    return value + 1;
+}
+
+// compute the index of the position in the table and decompress the value. the
+// pieces of a group (k pieces of the same type and color) on the squares
+// s1 < s2 < ... < sk are encoded as binomial[1][s1] + binomial[2][s2] + ...
+template<TBType Type, typename Ret = typename TBTable<Type>::Ret>
+static Ret do_probe_table(const Board &board, TBTable<Type> *e, const WDLScore wdl, ProbeState &state) {
+    int      squares[TB_PIECES];
+    uint8_t  pieces[TB_PIECES];
+    uint64_t idx;
+    int      size      = 0;
+    int      lead_count = 0;
+    int      tb_file   = 0;
+    uint64_t lead_pawns = 0ULL;
+
+    // both colors with the same material only store white to move. otherwise
+    // the tables have white as the stronger side. in both cases, the colors
+    // may have to be swapped and the board flipped
+    const bool symmetric_black = e->key == e->key2 && board.color == COL_BLACK;
+    const bool black_stronger  = board.material_key() != e->key;
+
+    const bool flip         = symmetric_black || black_stronger;
+    const int  flip_color   = flip * 8;
+    const int  flip_squares = flip * 56;
+    const int  stm          = flip ^ board.color;
+
+    // tables with pawns are split into four, based on the file of the leading pawn
+    if (e->has_pawns) {
+        const uint8_t pc = e->get(0, 0)->pieces[0] ^ flip_color;
+        const Color lead_color = pc >> 3 ? COL_BLACK : COL_WHITE;
+
+        lead_pawns = board.pieces[lead_color][PT_PAWN];
+
+        uint64_t bb = lead_pawns;
+        while (bb) squares[size++] = to_tb_square(ls1b_reset(bb)) ^ flip_squares;
+
+        lead_count = size;
+
+        std::swap(squares[0], *std::max_element(squares, squares + lead_count, pawns_compare));
+        tb_file = std::min(file_of(squares[0]), 7 - file_of(squares[0]));
+    }
+
+    if (!check_dtz_stm(e, stm, tb_file)) {
+        state = PROBE_CHANGE_STM;
+        return Ret();
+    }
+
+    for (int col = 0; col < 2; col++) {
+        for (int pt = 0; pt < 6; pt++) {
+            uint64_t bb = board.pieces[col][pt] & ~lead_pawns;
+
+            while (bb) {
+                squares[size]  = to_tb_square(ls1b_reset(bb)) ^ flip_squares;
+                pieces[size++] = tb_piece(static_cast<Color>(col), static_cast<PieceType>(pt)) ^ flip_color;
+            }
+        }
+    }
+
+    PairsData *d = e->get(stm, tb_file);
+
+    // order the pieces the same way as in the table
+    for (int i = lead_count; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            if (d->pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // the leading piece is always on the a-d files
+    if (file_of(squares[0]) > 3) {
+        for (int i = 0; i < size; i++)
+            squares[i] = flip_file(squares[i]);
+    }
+
+    if (e->has_pawns) {
+        idx = lead_pawn_idx[lead_count][squares[0]];
+
+        std::stable_sort(squares + 1, squares + lead_count, pawns_compare);
+
+        for (int i = 1; i < lead_count; i++)
+            idx += binomial[i][map_pawns[squares[i]]];
+    }
+    else {
+        // without pawns, the leading piece is also below the fifth rank
+        if (rank_of(squares[0]) > 3) {
+            for (int i = 0; i < size; i++)
+                squares[i] = flip_rank(squares[i]);
+        }
+
+        // and the first piece of the leading group, which isn't on the
+        // a1-h8 diagonal, is mirrored to be below the diagonal
+        for (int i = 0; i < d->group_len[0]; i++) {
+            if (!off_diagonal(squares[i]))
+                continue;
+
+            if (off_diagonal(squares[i]) > 0) {
+                for (int j = i; j < size; j++)
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+
+            break;
+        }
+
+        if (e->has_unique_pieces) {
+            const int adjust1 =  squares[1] > squares[0];
+            const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (off_diagonal(squares[0])) {
+                idx = (map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            }
+            else if (off_diagonal(squares[1])) {
+                idx = (6 * 63 + rank_of(squares[0]) * 28 + map_b1h1h7[squares[1]]) * 62 + squares[2] - adjust2;
+            }
+            else if (off_diagonal(squares[2])) {
+                idx = 6 * 63 * 62 + 4 * 28 * 62
+                    +  rank_of(squares[0])             * 7 * 28
+                    + (rank_of(squares[1]) - adjust1)  * 28
+                    +  map_b1h1h7[squares[2]];
+            }
+            else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                    +  rank_of(squares[0])             * 7 * 6
+                    + (rank_of(squares[1]) - adjust1)  * 6
+                    + (rank_of(squares[2]) - adjust2);
+            }
+        }
+
+        // without three unique pieces, only the kings are encoded together
+        else idx = map_kk[map_a1d1d4[squares[0]]][squares[1]];
+    }
+
+    idx *= d->group_idx[0];
+
+    int *group_sq = squares + d->group_len[0];
+    bool remaining_pawns = e->has_pawns && e->pawn_count[1];
+
+    // the remaining groups. the squares taken by the previous groups are skipped
+    for (int next = 1; d->group_len[next]; next++) {
+        std::stable_sort(group_sq, group_sq + d->group_len[next]);
+        uint64_t n = 0;
+
+        for (int i = 0; i < d->group_len[next]; i++) {
+            const auto adjust = std::count_if(squares, group_sq, [&](const int s) { return group_sq[i] > s; });
+            n += binomial[i + 1][group_sq[i] - adjust - 8 * remaining_pawns];
+        }
+
+        remaining_pawns = false;
+        idx += n * d->group_idx[next];
+        group_sq += d->group_len[next];
+    }
+
+    return map_score(e, tb_file, decompress_pairs(d, idx), wdl);
+}
+
+template<TBType Type, typename Ret = typename TBTable<Type>::Ret>
+static Ret probe_table(const Board &board, ProbeState &state, const WDLScore wdl = WDL_DRAW) {
+
+    // just the two kings
+    if (!(board.occupied() & ~(board.pieces[COL_WHITE][PT_KING] | board.pieces[COL_BLACK][PT_KING])))
+        return Ret(WDL_DRAW);
+
+    const auto it = tables.find(board.material_key());
+    if (it == tables.end()) {
+        state = PROBE_FAIL;
+        return Ret();
+    }
+
+    TBTable<Type> *e;
+    if constexpr (Type == TB_WDL) e = it->second.wdl;
+    else                          e = it->second.dtz;
+
+    if (!mapped(*e, board)) {
+        state = PROBE_FAIL;
+        return Ret();
+    }
+
+    return do_probe_table<Type>(board, e, wdl, state);
+}
+
+// the tables don't store the value of positions, where the side to move can win
+// by a capture (or draw by a capture in a lost position), since these can be
+// found by a short search instead. this helps the compression a lot, but means
+// the captures must be searched before probing the table itself. the dtz tables
+// also don't store positions, where the best move is a pawn move
+template<bool CheckZeroingMoves>
+static WDLScore search(const Board &board, ProbeState &state) {
+    WDLScore best  = WDL_LOSS;
+    WDLScore value;
+
+    Move moves[MAX_MOVES];
+    const int total = Movegen::get_legal_moves(board, moves);
+    int searched    = 0;
+
+    for (int i = 0; i < total; i++) {
+        const Move move = moves[i];
+
+        if (!move.is_capture() && (!CheckZeroingMoves || move.piece() != PT_PAWN))
+            continue;
+
+        searched++;
+
+        Board child = board.clone();
+        child.play_move(move);
+
+        value = static_cast<WDLScore>(-search<false>(child, state));
+
+        if (state == PROBE_FAIL)
+            return WDL_DRAW;
+
+        if (value > best) {
+            best = value;
+
+            if (value >= WDL_WIN) {
+                state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    // when all moves were captures, the table doesn't have to be probed at all.
+    // this also matters for en passant, which the tables don't know about
+    const bool no_more_moves = searched && searched == total;
+
+    if (no_more_moves) {
+        value = best;
+    }
+    else {
+        value = probe_table<TB_WDL>(board, state);
+
+        if (state == PROBE_FAIL)
+            return WDL_DRAW;
+    }
+
+    if (best >= value) {
+        state = best > WDL_DRAW || no_more_moves
+            ? PROBE_ZEROING_BEST_MOVE
+            : PROBE_OK;
+        return best;
+    }
+
+    state = PROBE_OK;
+    return value;
+}
+
+// add the table to the list, if its wdl file exists. the pieces of the stronger
+// side go first, starting with the king, and the weaker side starts with its king.
+// returns the number of pieces in the table, or zero if it wasn't found
+static int add_table(const std::vector<PieceType> &pieces) {
+    constexpr std::string_view NAMES = "PNBRQK";
+
+    std::string name;
+    uint64_t key  = 0;
+    uint64_t key2 = 0;
+    int pawns[2]  = { 0, 0 };
+    int counts[2][6]{};
+
+    Color col = COL_NONE;
+    for (const PieceType pt : pieces) {
+        if (pt == PT_KING) {
+            col = col == COL_NONE ? COL_WHITE : COL_BLACK;
+            if (col == COL_BLACK) name += 'v';
+        }
+
+        name += NAMES[pt];
+        counts[col][pt]++;
+
+        if (pt != PT_KING) {
+            key  += 1ULL << (col * 5 + pt) * 4;
+            key2 += 1ULL << ((col ^ 1) * 5 + pt) * 4;
+        }
+
+        if (pt == PT_PAWN)
+            pawns[col]++;
+    }
+
+    const bool found = std::ranges::any_of(tb_paths, [&](const std::string &dir) {
+        std::error_code ec;
+        return std::filesystem::exists(std::filesystem::path(dir) / (name + ".rtbw"), ec);
+    });
+
+    if (!found)
+        return 0;
+
+    TBTable<TB_WDL> &wdl = wdl_tables.emplace_back();
+
+    wdl.key         = key;
+    wdl.key2        = key2;
+    wdl.piece_count = static_cast<int>(pieces.size());
+    wdl.has_pawns   = pawns[COL_WHITE] || pawns[COL_BLACK];
+
+    for (const auto &col_counts : counts) {
+        for (int pt = PT_PAWN; pt < PT_KING; pt++) {
+            if (col_counts[pt] == 1)
+                wdl.has_unique_pieces = true;
+        }
+    }
+
+    // the leading color is the one with fewer pawns (but at least one), since
+    // this gives better compression
+    const bool white_leads = !pawns[COL_BLACK] || (pawns[COL_WHITE] && pawns[COL_BLACK] >= pawns[COL_WHITE]);
+
+    wdl.pawn_count[0] = static_cast<uint8_t>(white_leads ? pawns[COL_WHITE] : pawns[COL_BLACK]);
+    wdl.pawn_count[1] = static_cast<uint8_t>(white_leads ? pawns[COL_BLACK] : pawns[COL_WHITE]);
+
+    TBTable<TB_DTZ> &dtz = dtz_tables.emplace_back();
+
+    dtz.key               = wdl.key;
+    dtz.key2              = wdl.key2;
+    dtz.piece_count       = wdl.piece_count;
+    dtz.has_pawns         = wdl.has_pawns;
+    dtz.has_unique_pieces = wdl.has_unique_pieces;
+    dtz.pawn_count[0]     = wdl.pawn_count[0];
+    dtz.pawn_count[1]     = wdl.pawn_count[1];
+
+    tables[key]  = { &wdl, &dtz };
+    tables[key2] = { &wdl, &dtz };
+
+    return wdl.piece_count;
+}
+
+void Syzygy::init(const std::string &path) {
+    static bool index_tables_ready = false;
+
+    if (!index_tables_ready) {
+        init_index_tables();
+        index_tables_ready = true;
+    }
+
+    tables.clear();
+    wdl_tables.clear();
+    dtz_tables.clear();
+    tb_paths.clear();
+
+    max_cardinality = 0;
+
+    if (path.empty() || path == "<empty>")
+        return;
+
+#ifdef _WIN32
+    constexpr char SEPARATOR = ';';
+#else
+    constexpr char SEPARATOR = ':';
+#endif
+
+    std::size_t begin = 0;
+    while (begin <= path.size()) {
+        std::size_t end = path.find(SEPARATOR, begin);
+        if (end == std::string::npos)
+            end = path.size();
+
+        if (end > begin)
+            tb_paths.emplace_back(path.substr(begin, end - begin));
+
+        begin = end + 1;
+    }
+
+    // all combinations of up to five pieces besides the kings, where the
+    // first side is at least as strong as the second (queens first)
+    for (int p1 = PT_PAWN; p1 < PT_KING; p1++) {
+        const auto p1t = static_cast<PieceType>(p1);
+
+        max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, PT_KING }));
+
+        for (int p2 = PT_PAWN; p2 <= p1; p2++) {
+            const auto p2t = static_cast<PieceType>(p2);
+
+            max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, PT_KING }));
+            max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, PT_KING, p2t }));
+
+            for (int p3 = PT_PAWN; p3 < PT_KING; p3++) {
+                const auto p3t = static_cast<PieceType>(p3);
+                max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, PT_KING, p3t }));
+            }
+
+            for (int p3 = PT_PAWN; p3 <= p2; p3++) {
+                const auto p3t = static_cast<PieceType>(p3);
+
+                max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, p3t, PT_KING }));
+
+                for (int p4 = PT_PAWN; p4 <= p3; p4++) {
+                    const auto p4t = static_cast<PieceType>(p4);
+
+                    max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, p3t, p4t, PT_KING }));
+
+                    for (int p5 = PT_PAWN; p5 <= p4; p5++) {
+                        const auto p5t = static_cast<PieceType>(p5);
+                        max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, p3t, p4t, p5t, PT_KING }));
+                    }
+
+                    for (int p5 = PT_PAWN; p5 < PT_KING; p5++) {
+                        const auto p5t = static_cast<PieceType>(p5);
+                        max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, p3t, p4t, PT_KING, p5t }));
+                    }
+                }
+
+                for (int p4 = PT_PAWN; p4 < PT_KING; p4++) {
+                    const auto p4t = static_cast<PieceType>(p4);
+
+                    max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, p3t, PT_KING, p4t }));
+
+                    for (int p5 = PT_PAWN; p5 <= p4; p5++) {
+                        const auto p5t = static_cast<PieceType>(p5);
+                        max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, p3t, PT_KING, p4t, p5t }));
+                    }
+                }
+            }
+
+            for (int p3 = PT_PAWN; p3 <= p1; p3++) {
+                for (int p4 = PT_PAWN; p4 <= (p1 == p3 ? p2 : p3); p4++) {
+                    const auto p3t = static_cast<PieceType>(p3);
+                    const auto p4t = static_cast<PieceType>(p4);
+
+                    max_cardinality = std::max(max_cardinality, add_table({ PT_KING, p1t, p2t, PT_KING, p3t, p4t }));
+                }
+            }
+        }
+    }
+}
+
+WDLScore Syzygy::probe_wdl(const Board &board, ProbeState &state) {
+    state = PROBE_OK;
+    return search<false>(board, state);
+}
+
+int Syzygy::probe_dtz(const Board &board, ProbeState &state) {
+    state = PROBE_OK;
+    const WDLScore wdl = search<true>(board, state);
+
+    if (state == PROBE_FAIL || wdl == WDL_DRAW)
+        return 0;
+
+    // the best move resets the counter, so its dtz is known right away
+    if (state == PROBE_ZEROING_BEST_MOVE)
+        return dtz_before_zeroing(wdl);
+
+    int dtz = probe_table<TB_DTZ>(board, state, wdl);
+
+    if (state == PROBE_FAIL)
+        return 0;
+
+    if (state != PROBE_CHANGE_STM)
+        return (dtz + 100 * (wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN)) * sign_of(wdl);
+
+    // the table only stores the other side to move, so we must search one ply. the
+    // best dtz is the lowest one, which keeps the result (when winning, the quickest
+    // win, and when losing, the one delaying the loss as much as possible)
+    int min_dtz = 0xFFFF;
+
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    for (int i = 0; i < count; i++) {
+        const bool zeroing = moves[i].is_capture() || moves[i].piece() == PT_PAWN;
+
+        Board child = board.clone();
+        child.play_move(moves[i]);
+
+        dtz = zeroing
+            ? -dtz_before_zeroing(search<false>(child, state))
+            : -probe_dtz(child, state);
+
+        if (state == PROBE_FAIL)
+            return 0;
+
+        // a mate always has dtz one
+        if (dtz == 1 && Movegen::is_in_check(child, child.color)) {
+            Move replies[MAX_MOVES];
+            if (Movegen::get_legal_moves(child, replies) == 0)
+                min_dtz = 1;
+        }
+
+        // the move itself is one more ply, unless it resets the counter
+        if (!zeroing)
+            dtz += sign_of(dtz);
+
+        if (dtz < min_dtz && sign_of(dtz) == sign_of(wdl))
+            min_dtz = dtz;
+    }
+
+    // all moves lose, and none of them is zeroing
+    return min_dtz == 0xFFFF ? -1 : min_dtz;
+}
+
+bool Syzygy::rank_root_moves(const Board &board, const std::vector<uint64_t> &history, Move *moves, int &count) {
+    if (count == 0 || board.castling_rights != CR_NONE || std::popcount(board.occupied()) > max_cardinality)
+        return false;
+
+    const int rule50 = board.halfmove_clock;
+
+    // the position after a move is drawn by a repetition, which happened after the last
+    // irreversible move. a position repeated even before the root can't be won in time
+    const auto repeated = [&](const uint64_t key, const int clock) {
+        const int size = static_cast<int>(history.size());
+        for (int i = size - 1; i >= std::max(size - clock, 0); i--) {
+            if (history[i] == key)
+                return true;
+        }
+
+        return false;
+    };
+
+    const bool root_repeated = repeated(board.key, rule50);
+
+    std::vector<int> ranks(count);
+    ProbeState state = PROBE_OK;
+
+    bool dtz_available = true;
+
+    for (int i = 0; i < count; i++) {
+        Board child = board.clone();
+        child.play_move(moves[i]);
+
+        int dtz;
+
+        // a zeroing move has the dtz right before zeroing (one of -101, -1, 0, 1, 101)
+        if (child.halfmove_clock == 0) {
+            dtz = dtz_before_zeroing(static_cast<WDLScore>(-probe_wdl(child, state)));
+        }
+        else if (child.halfmove_clock >= 100 || repeated(child.key, child.halfmove_clock - 1)) {
+            dtz = 0;
+        }
+        else {
+            dtz = -probe_dtz(child, state);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+
+        // a mating move is always ranked as the quickest win
+        if (dtz == 2 && Movegen::is_in_check(child, child.color)) {
+            Move replies[MAX_MOVES];
+            if (Movegen::get_legal_moves(child, replies) == 0)
+                dtz = 1;
+        }
+
+        if (state == PROBE_FAIL) {
+            dtz_available = false;
+            break;
+        }
+
+        // the quickest wins are ranked highest, unless the fifty-move rule would make
+        // them draws. losses are delayed as much as possible for the same reason
+        ranks[i] = dtz > 0 ? (dtz + rule50 <= 99 && !root_repeated ? MAX_DTZ - dtz : MAX_DTZ / 2 - (dtz + rule50))
+                 : dtz < 0 ? (-dtz * 2 + rule50 < 100 ? -MAX_DTZ - dtz : -MAX_DTZ / 2 + (-dtz + rule50))
+                 : 0;
+    }
+
+    // without the dtz tables, the moves are only ranked by their result
+    if (!dtz_available) {
+        constexpr int WDL_RANKS[] = { -MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ };
+
+        for (int i = 0; i < count; i++) {
+            Board child = board.clone();
+            child.play_move(moves[i]);
+
+            const bool drawn = child.halfmove_clock >= 100
+                || (child.halfmove_clock != 0 && repeated(child.key, child.halfmove_clock - 1));
+
+            const WDLScore wdl = drawn
+                ? WDL_DRAW
+                : static_cast<WDLScore>(-probe_wdl(child, state));
+
+            if (state == PROBE_FAIL)
+                return false;
+
+            ranks[i] = WDL_RANKS[wdl + 2];
+        }
+    }
+
+    // only the moves with the best rank are kept
+    const int best = *std::max_element(ranks.begin(), ranks.end());
+
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (ranks[i] == best)
+            moves[kept++] = moves[i];
+    }
+
+    count = kept;
+    return true;
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/board.h"
+#include "src/movegen/move.h"
+
+namespace Kreveta {
+
+// the result of a position from the point of view of the side to move. cursed
+// wins and blessed losses are wins and losses, which are drawn by the fifty-move rule
+enum WDLScore : int8_t {
+    WDL_LOSS         = -2,
+    WDL_BLESSED_LOSS = -1,
+    WDL_DRAW         =  0,
+    WDL_CURSED_WIN   =  1,
+    WDL_WIN          =  2
+};
+
+enum ProbeState : int8_t {
+    PROBE_FAIL              =  0,
+    PROBE_OK                =  1,
+
+    // the dtz table only stores the other side to move
+    PROBE_CHANGE_STM        = -1,
+
+    // the best move resets the fifty-move counter (capture or pawn move)
+    PROBE_ZEROING_BEST_MOVE =  2
+};
+
+// syzygy endgame tablebases. only the names of the available tables are found
+// when setting the path, each file is memory-mapped the first time it's probed.
+// the tables don't store positions with castling rights, and the wdl tables don't
+// take the fifty-move counter into account, so it's best to only probe the wdl
+// tables right after a capture or a pawn move
+class Syzygy {
+public:
+
+    // the path may contain several directories separated by ':' (or ';' on windows).
+    // an empty path (or "<empty>") unloads all tables
+    static void init(const std::string &path);
+
+    // the most pieces (kings included) of any table found, zero if there are none
+    [[nodiscard]] static int max_pieces() { return max_cardinality; }
+
+    [[nodiscard]] static WDLScore probe_wdl(const Board &board, ProbeState &state);
+
+    // number of plies until the fifty-move counter is reset by a winning (positive)
+    // or losing (negative) side. zero means the position is drawn
+    [[nodiscard]] static int probe_dtz(const Board &board, ProbeState &state);
+
+    // remove all root moves, which don't keep the best result in the tablebases.
+    // the history (keys of the previous positions) is needed to find repetitions,
+    // which make the moves drawn. returns false if the tables couldn't be probed
+    static bool rank_root_moves(const Board &board, const std::vector<uint64_t> &history, Move *moves, int &count);
+
+private:
+    static int max_cardinality;
+};
+
+}
+
+#endif //SYZYGY_H
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <atomic>
+
+#include "thread_pool.h"
+
+namespace Kreveta {
+
+ThreadPool::ThreadPool(int thread_count) {
+    if (thread_count <= 0)
+        thread_count = static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+
+    workers.reserve(thread_count);
+    for (int i = 0; i < thread_count; i++)
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    job_ready.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::run(const std::function<void(int)> &job) {
+    std::unique_lock lock(mutex);
+
+    this->job = &job;
+    running   = size();
+    generation++;
+
+    job_ready.notify_all();
+    job_done.wait(lock, [&] { return running == 0; });
+
+    this->job = nullptr;
+}
+
+void ThreadPool::parallel_for(const std::size_t count, const std::size_t chunk,
+    const std::function<void(std::size_t, std::size_t, int)> &job) {
+
+    std::atomic<std::size_t> next = 0;
+
+    run([&](const int thread) {
+        for (std::size_t begin = next.fetch_add(chunk); begin < count; begin = next.fetch_add(chunk))
+            job(begin, std::min(begin + chunk, count), thread);
+    });
+}
+
+void ThreadPool::worker_loop(const int index) {
+    uint64_t last_generation = 0;
+
+    while (true) {
+        const std::function<void(int)> *cur_job;
+        {
+            std::unique_lock lock(mutex);
+            job_ready.wait(lock, [&] { return stopping || generation != last_generation; });
+
+            if (stopping)
+                return;
+
+            last_generation = generation;
+            cur_job         = job;
+        }
+
+        (*cur_job)(index);
+
+        std::lock_guard lock(mutex);
+        if (--running == 0)
+            job_done.notify_one();
+    }
+}
+
+}
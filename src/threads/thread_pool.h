@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Kreveta {
+
+// a fixed number of worker threads, which all run the same job and then go back
+// to sleep. the threads are kept alive between jobs, so running many small jobs
+// doesn't pay for creating new threads every time
+class ThreadPool {
+public:
+    // zero threads means one thread per hardware core
+    explicit ThreadPool(int thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] int size() const { return static_cast<int>(workers.size()); }
+
+    // run the job on every thread (the argument is the thread index)
+    // and wait until all of them are finished
+    void run(const std::function<void(int)> &job);
+
+    // split [0, count) into chunks, which are handed out to the threads one by one
+    // until none are left. the job receives the range and the thread index
+    void parallel_for(std::size_t count, std::size_t chunk,
+        const std::function<void(std::size_t, std::size_t, int)> &job);
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex;
+    std::condition_variable job_ready;
+    std::condition_variable job_done;
+
+    const std::function<void(int)> *job = nullptr;
+
+    // every new job increases the generation, so the workers know there is work
+    uint64_t generation = 0;
+    int      running    = 0;
+    bool     stopping   = false;
+
+    void worker_loop(int index);
+};
+
+}
+
+#endif //THREAD_POOL_H
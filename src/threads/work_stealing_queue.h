@@ -0,0 +1,66 @@
+#ifndef WORK_STEALING_QUEUE_H
+#define WORK_STEALING_QUEUE_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace Kreveta {
+
+// one queue per thread. every thread takes work from the front of its own queue,
+// and once it's empty, it steals from the back of the other queues. the threads,
+// which got the easier work, then help with the rest instead of waiting, and
+// they mostly don't touch the same queue, so the locks are rarely contended
+template<typename T>
+class WorkStealingQueue {
+public:
+    explicit WorkStealingQueue(const int count)
+        : queues(std::make_unique<Queue[]>(count)), count(count) {}
+
+    [[nodiscard]] int size() const { return count; }
+
+    void push(const int queue, T item) {
+        Queue &q = queues[queue % count];
+
+        std::lock_guard lock(q.mutex);
+        q.items.push_back(std::move(item));
+    }
+
+    // returns false when all queues are empty
+    bool pop(const int queue, T &out) {
+        for (int i = 0; i < count; i++) {
+            Queue &q = queues[(queue + i) % count];
+
+            std::lock_guard lock(q.mutex);
+            if (q.items.empty())
+                continue;
+
+            // our own queue is used from the front, and the others from the back
+            if (i == 0) {
+                out = std::move(q.items.front());
+                q.items.pop_front();
+            }
+            else {
+                out = std::move(q.items.back());
+                q.items.pop_back();
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    struct alignas(64) Queue {
+        std::mutex    mutex;
+        std::deque<T> items;
+    };
+
+    std::unique_ptr<Queue[]> queues;
+    int                      count;
+};
+
+}
+
+#endif //WORK_STEALING_QUEUE_H
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+
+#include "book_builder.h"
+
+#include "src/position.h"
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/book/book.h"
+#include "src/global/consts.h"
+#include "src/movegen/movegen.h"
+#include "src/threads/thread_pool.h"
+
+namespace Kreveta {
+
+// every thread gets this many chunks on average, so the threads which happen
+// to get chunks with shorter games don't end up waiting for the others
+constexpr std::size_t CHUNKS_PER_THREAD = 16;
+
+bool BookBuilder::run(const BookBuildSettings &settings) {
+    MappedFile file;
+    if (!file.open(settings.pgn)) {
+        UCI::log(std::format("Unable to open '{}'", settings.pgn));
+        return false;
+    }
+
+    file.advise_sequential();
+
+    ThreadPool pool(settings.threads);
+    std::vector<Shard> shards(SHARD_COUNT);
+
+    const auto start  = std::chrono::steady_clock::now();
+    const auto bounds = split(file, pool.size() * CHUNKS_PER_THREAD);
+
+    std::vector<Buffer>   buffers(pool.size());
+    std::atomic<uint64_t> games = 0;
+
+    pool.parallel_for(bounds.size() - 1, 1, [&](const std::size_t begin, const std::size_t end, const int thread) {
+        for (std::size_t i = begin; i < end; i++) {
+            const std::string_view text{reinterpret_cast<const char *>(file.data()) + bounds[i], bounds[i + 1] - bounds[i]};
+            games += parse_chunk(text, settings, shards, buffers[thread]);
+        }
+    });
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    UCI::log(std::format("Parsed {} games ({} ms)", format_uint64_t(games.load()), elapsed));
+
+    return write(settings.output, shards, settings, pool);
+}
+
+// the chunks are split evenly by size first, and then each boundary is moved
+// forward to the start of the next game, so no game is split between two chunks
+std::vector<std::size_t> BookBuilder::split(const MappedFile &file, const std::size_t chunks) {
+    const std::string_view text{reinterpret_cast<const char *>(file.data()), file.size()};
+
+    std::vector<std::size_t> bounds = { 0 };
+
+    for (std::size_t i = 1; i < chunks; i++) {
+        const std::size_t pos  = std::max(text.size() / chunks * i, bounds.back());
+        const std::size_t next = text.find("\n[Event ", pos);
+
+        if (next == std::string_view::npos)
+            break;
+
+        if (next + 1 > bounds.back())
+            bounds.push_back(next + 1);
+    }
+
+    bounds.push_back(text.size());
+    return bounds;
+}
+
+uint64_t BookBuilder::parse_chunk(const std::string_view text, const BookBuildSettings &settings,
+    std::vector<Shard> &shards, Buffer &buffer) {
+
+    uint64_t games = 0;
+
+    std::vector<std::string_view> moves;
+    std::string_view fen;
+    GameResult       result     = RESULT_UNKNOWN;
+    bool             in_moves   = false;
+    int              variations = 0;
+
+    // the game is finished either by the result at the end of the moves,
+    // or by the tags of the next game if the result is missing
+    const auto finish_game = [&] {
+        Board board = Board::make_startpos();
+
+        // the fen is parsed into an empty board, since it only adds the pieces
+        if (!fen.empty()) {
+            const std::string fen_str{fen};
+
+            board = Board();
+            if (!Position::try_parse_fen(str_split(fen_str), board))
+                moves.clear();
+        }
+
+        if (result != RESULT_UNKNOWN && !moves.empty()) {
+            add_game(board, moves, result, shards, buffer);
+            games++;
+        }
+
+        moves.clear();
+        fen        = {};
+        result     = RESULT_UNKNOWN;
+        in_moves   = false;
+        variations = 0;
+    };
+
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        const char c = text[pos];
+
+        // tags are always at the start of the line
+        if (c == '[' && (pos == 0 || text[pos - 1] == '\n')) {
+            if (in_moves)
+                finish_game();
+
+            const std::size_t end = std::min(text.find('\n', pos), text.size());
+            const std::string_view tag = text.substr(pos, end - pos);
+            pos = end;
+
+            // [Name "Value"]
+            const std::size_t quote = tag.find('"');
+            const std::size_t last  = tag.rfind('"');
+            if (quote == std::string_view::npos || last <= quote)
+                continue;
+
+            const std::string_view value = tag.substr(quote + 1, last - quote - 1);
+
+            if      (tag.starts_with("[Result ")) result = parse_game_result(value);
+            else if (tag.starts_with("[FEN "))    fen    = value;
+            continue;
+        }
+
+        // comments and variations are skipped entirely
+        if (c == '{') {
+            pos = std::min(text.find('}', pos), text.size());
+            pos++;
+            continue;
+        }
+
+        if (c == ';') {
+            pos = std::min(text.find('\n', pos), text.size());
+            continue;
+        }
+
+        if (c == '(' || c == ')') {
+            variations = std::max(0, variations + (c == '(' ? 1 : -1));
+            pos++;
+            continue;
+        }
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pos++;
+            continue;
+        }
+
+        std::size_t end = pos;
+        while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end]))
+            && text[end] != '{' && text[end] != '(' && text[end] != ')' && text[end] != ';')
+            end++;
+
+        std::string_view token = text.substr(pos, end - pos);
+        pos      = end;
+        in_moves = true;
+
+        if (variations > 0 || token.starts_with('$'))
+            continue;
+
+        // the result also marks the end of the game
+        if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+            if (result == RESULT_UNKNOWN)
+                result = parse_game_result(token);
+
+            finish_game();
+            continue;
+        }
+
+        // move numbers ("12." or "12...") may be directly followed by the move
+        if (std::isdigit(static_cast<unsigned char>(token[0]))) {
+            const std::size_t move_start = token.find_first_not_of("0123456789.");
+            if (move_start == std::string_view::npos)
+                continue;
+
+            token.remove_prefix(move_start);
+        }
+
+        if (moves.size() < static_cast<std::size_t>(settings.max_ply))
+            moves.push_back(token);
+    }
+
+    if (in_moves)
+        finish_game();
+
+    for (int i = 0; i < SHARD_COUNT; i++)
+        flush(buffer.shards[i], shards[i]);
+
+    return games;
+}
+
+void BookBuilder::add_game(const Board &start, const std::vector<std::string_view> &moves, const GameResult result,
+    std::vector<Shard> &shards, Buffer &buffer) {
+
+    Board board = start;
+
+    for (const std::string_view san : moves) {
+        const Move move = Move::san_to_move(san, board);
+
+        // the rest of the game can't be replayed without this move
+        if (move == Move())
+            break;
+
+        // the score is from the point of view of the side playing the move
+        const uint8_t score = result == RESULT_DRAW ? 1
+            : (result == RESULT_WHITE_WIN) == (board.color == COL_WHITE) ? 2 : 0;
+
+        const uint64_t key   = Book::key(board);
+        const int      shard = static_cast<int>(key >> (64 - SHARD_BITS));
+
+        buffer.shards[shard].push_back({ key, Book::encode_move(move), score });
+        if (buffer.shards[shard].size() >= FLUSH_SIZE)
+            flush(buffer.shards[shard], shards[shard]);
+
+        board.play_move(move);
+    }
+}
+
+void BookBuilder::flush(std::vector<Record> &records, Shard &shard) {
+    if (records.empty())
+        return;
+
+    {
+        std::lock_guard lock(shard.mutex);
+
+        for (const Record &record : records) {
+            MoveStats &stats = shard.moves[{ record.key, record.move }];
+            stats.games++;
+            stats.score += record.score;
+        }
+    }
+
+    records.clear();
+}
+
+bool BookBuilder::write(const std::string &path, std::vector<Shard> &shards, const BookBuildSettings &settings, ThreadPool &pool) {
+    std::vector<std::vector<PolyglotEntry>> entries(SHARD_COUNT);
+
+    // the shards are sorted in parallel, and since they already follow the order
+    // of the keys, they can then simply be written one after another
+    pool.parallel_for(SHARD_COUNT, 1, [&](const std::size_t begin, const std::size_t end, int) {
+        for (std::size_t s = begin; s < end; s++) {
+            auto &shard = entries[s];
+
+            std::vector<std::pair<MoveKey, MoveStats>> moves;
+            moves.reserve(shards[s].moves.size());
+
+            // moves which have never scored anything would never be picked anyway
+            for (const auto &[move, stats] : shards[s].moves) {
+                if (stats.games >= static_cast<uint32_t>(settings.min_games) && stats.score > 0)
+                    moves.emplace_back(move, stats);
+            }
+
+            shards[s].moves.clear();
+
+            std::ranges::sort(moves, [](const auto &a, const auto &b) {
+                return a.first.key != b.first.key
+                    ? a.first.key    < b.first.key
+                    : a.second.score > b.second.score;
+            });
+
+            // the weights only have 16 bits, so when the best move doesn't fit, all
+            // moves in the position are scaled down to keep their proportions. the
+            // best move is always the first one, since the moves are sorted by score
+            double scale = 1.0;
+
+            for (std::size_t i = 0; i < moves.size(); i++) {
+                const auto &[move, stats] = moves[i];
+
+                if (i == 0 || moves[i - 1].first.key != move.key)
+                    scale = std::min(1.0, 65535.0 / stats.score);
+
+                shard.push_back({
+                    .key    = move.key,
+                    .move   = move.move,
+                    .weight = static_cast<uint16_t>(std::max(1.0, stats.score * scale))
+                });
+            }
+        }
+    });
+
+    std::ofstream out{path, std::ios::binary};
+    if (!out) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    std::vector<unsigned char> buffer;
+    uint64_t written = 0;
+
+    for (const auto &shard : entries) {
+        buffer.resize(shard.size() * PolyglotEntry::SIZE);
+
+        for (std::size_t i = 0; i < shard.size(); i++)
+            shard[i].write(buffer.data() + i * PolyglotEntry::SIZE);
+
+        out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        written += shard.size();
+    }
+
+    if (!out) {
+        UCI::log(std::format("Unable to write '{}'", path));
+        return false;
+    }
+
+    UCI::log(std::format("Book with {} entries written to '{}'", format_uint64_t(written), path));
+    return true;
+}
+
+}
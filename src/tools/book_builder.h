@@ -0,0 +1,101 @@
+#ifndef BOOK_BUILDER_H
+#define BOOK_BUILDER_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "src/board.h"
+#include "src/io/mapped_file.h"
+#include "src/io/packed_position.h"
+#include "src/threads/thread_pool.h"
+
+namespace Kreveta {
+
+struct BookBuildSettings {
+    std::string pgn;
+    std::string output = "book.bin";
+
+    // zero threads means one thread per hardware core
+    int threads   = 0;
+
+    // only the first plies of every game are added to the book
+    int max_ply   = 24;
+
+    // moves played in fewer games than this are left out
+    int min_games = 3;
+};
+
+// builds a polyglot book from a PGN file. the file is mapped into memory and
+// split into chunks at game boundaries, which are parsed in parallel. all moves
+// are counted in hash maps split into shards by the top bits of the position's
+// key, so the threads rarely wait for each other, and since the shards also
+// follow the order of the keys, each of them can be sorted separately
+class BookBuilder {
+public:
+    static bool run(const BookBuildSettings &settings);
+
+private:
+    static constexpr int SHARD_BITS  = 6;
+    static constexpr int SHARD_COUNT = 1 << SHARD_BITS;
+
+    // how many moves a thread collects for a single shard before adding them
+    static constexpr std::size_t FLUSH_SIZE = 4096;
+
+    struct MoveStats {
+        uint32_t games = 0;
+
+        // two points for every win of the side that played the move and one for every draw
+        uint32_t score = 0;
+    };
+
+    struct Record {
+        uint64_t key;
+        uint16_t move;
+        uint8_t  score;
+    };
+
+    struct MoveKey {
+        uint64_t key;
+        uint16_t move;
+
+        bool operator==(const MoveKey &) const = default;
+    };
+
+    // the position's key is already random, so it only has to be mixed with the move
+    struct MoveKeyHash {
+        std::size_t operator()(const MoveKey &k) const {
+            return k.key ^ k.move * 0x9E3779B97F4A7C15ULL;
+        }
+    };
+
+    struct Shard {
+        std::mutex                                          mutex;
+        std::unordered_map<MoveKey, MoveStats, MoveKeyHash> moves;
+    };
+
+    // the moves found by a single thread, waiting to be added to the shards
+    struct Buffer {
+        std::vector<Record> shards[SHARD_COUNT];
+    };
+
+    [[nodiscard]] static std::vector<std::size_t> split(const MappedFile &file, std::size_t chunks);
+
+    // parse all games in the range. returns the number of games added
+    static uint64_t parse_chunk(std::string_view text, const BookBuildSettings &settings,
+        std::vector<Shard> &shards, Buffer &buffer);
+
+    static void add_game(const Board &start, const std::vector<std::string_view> &moves, GameResult result,
+        std::vector<Shard> &shards, Buffer &buffer);
+
+    static void flush(std::vector<Record> &records, Shard &shard);
+
+    static bool write(const std::string &path, std::vector<Shard> &shards, const BookBuildSettings &settings, ThreadPool &pool);
+};
+
+}
+
+#endif //BOOK_BUILDER_H
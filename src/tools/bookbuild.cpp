@@ -0,0 +1,36 @@
+#include <format>
+#include <string>
+
+#include "book_builder.h"
+
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/movegen/movetables.h"
+
+// Kreveta_2_bookbuild <pgn> [output] [threads] [max ply] [min games]
+int main(const int argc, char *argv[]) {
+    using namespace Kreveta;
+
+    if (argc < 2) {
+        UCI::log("Usage: Kreveta_2_bookbuild <pgn> [output] [threads] [max ply] [min games]");
+        return 1;
+    }
+
+    // the moves are parsed against the generated legal moves
+    MoveTables::init();
+
+    BookBuildSettings settings;
+    settings.pgn = argv[1];
+
+    if (argc > 2) settings.output = argv[2];
+
+    if ((argc > 3 && !try_parse(argv[3], settings.threads))
+     || (argc > 4 && !try_parse(argv[4], settings.max_ply))
+     || (argc > 5 && !try_parse(argv[5], settings.min_games))
+     || settings.threads < 0 || settings.max_ply < 1 || settings.min_games < 1) {
+        UCI::log("Invalid book builder arguments");
+        return 1;
+    }
+
+    return BookBuilder::run(settings) ? 0 : 1;
+}
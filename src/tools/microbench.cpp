@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/bitboard.h"
+#include "src/board.h"
+#include "src/position.h"
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/eval/endgame.h"
+#include "src/eval/kpk.h"
+#include "src/global/consts.h"
+#include "src/movegen/movegen.h"
+#include "src/movegen/movetables.h"
+
+using namespace Kreveta;
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    uint64_t    ops_per_round = 0;
+    uint64_t    rounds        = 0;
+    double      ns_per_op     = 0.0;
+
+    // every kernel sums its results, so the compiler can't remove the work, and
+    // a changed checksum shows that the kernel itself returns something different
+    uint64_t    checksum      = 0;
+};
+
+// the kernel is repeated until it has run for at least this long in total. the
+// fastest round is reported, since it's the least affected by other processes
+constexpr int64_t MIN_TIME_NS = 250'000'000;
+constexpr int     MIN_ROUNDS  = 5;
+
+BenchResult measure(const std::string &name, const std::function<uint64_t(uint64_t &)> &kernel) {
+    BenchResult result;
+    result.name = name;
+
+    int64_t total   = 0;
+    int64_t fastest = INT64_MAX;
+
+    while (total < MIN_TIME_NS || result.rounds < MIN_ROUNDS) {
+        uint64_t checksum = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t ops = kernel(checksum);
+        const int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        total  += time;
+        fastest = std::min(fastest, time);
+
+        result.ops_per_round = ops;
+        result.checksum      = checksum;
+        result.rounds++;
+    }
+
+    result.ns_per_op = static_cast<double>(fastest) / static_cast<double>(std::max<uint64_t>(result.ops_per_round, 1));
+    return result;
+}
+
+// every non-empty line must start with a FEN (extra EPD operations are ignored)
+bool load_corpus(const std::string &path, std::vector<std::string> &fens) {
+    std::ifstream input(path);
+    if (!input) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(input, line)) {
+        if (is_str_blank(line))
+            continue;
+
+        const auto tokens = str_split(line);
+        if (tokens.size() < 4)
+            continue;
+
+        // epd lines don't have the move counters
+        std::string fen;
+        for (std::size_t i = 0; i < std::min<std::size_t>(tokens.size(), 6); i++) {
+            if (i >= 4 && !std::ranges::all_of(tokens[i], [](const char c) { return c >= '0' && c <= '9'; }))
+                break;
+
+            if (!fen.empty()) fen += ' ';
+            fen += tokens[i];
+        }
+
+        fens.push_back(fen);
+    }
+
+    return true;
+}
+
+void write_json(std::ostream &out, const std::vector<BenchResult> &results, const std::size_t positions) {
+    out << "{\n";
+    out << std::format("  \"positions\": {},\n", positions);
+    out << "  \"benchmarks\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+
+        out << std::format("    {{ \"name\": \"{}\", \"ops\": {}, \"rounds\": {}, \"ns_per_op\": {:.3f}, \"checksum\": {} }}{}\n",
+            r.name, r.ops_per_round, r.rounds, r.ns_per_op, r.checksum, i + 1 < results.size() ? "," : "");
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+}
+
+}
+
+// Kreveta_2_microbench [output.json] [corpus.epd]. without an output file
+// the json is written to the standard output. the default corpus is the
+// set of positions used by "bench"
+int main(const int argc, char *argv[]) {
+    MoveTables::init();
+    KPK::init();
+    Endgames::init();
+
+    std::vector<std::string> fens;
+
+    if (argc > 2) {
+        if (!load_corpus(argv[2], fens))
+            return 1;
+    }
+    else fens.assign(std::begin(BENCH_FENS), std::end(BENCH_FENS));
+
+    std::vector<Board> boards;
+    std::vector<std::vector<std::string_view>> fen_fields;
+
+    for (const std::string &fen : fens) {
+        Board board;
+        if (!Position::try_parse_fen(str_split(fen), board)) {
+            UCI::log(std::format("Skipping invalid position '{}'", fen));
+            continue;
+        }
+
+        boards.push_back(board);
+
+        // the fields point into the fen strings, which are kept alive
+        fen_fields.push_back(str_split(fen));
+    }
+
+    if (boards.empty()) {
+        UCI::log("No positions to benchmark");
+        return 1;
+    }
+
+    // the kernels are repeated over the corpus, so a single round isn't too short to time
+    constexpr int REPEAT = 64;
+
+    std::vector<BenchResult> results;
+
+    results.push_back(measure("rook_targets", [&](uint64_t &checksum) {
+        uint64_t ops = 0;
+
+        for (int r = 0; r < REPEAT; r++) {
+            for (const Board &board : boards) {
+                const Color    color    = board.color;
+                const uint64_t occupied = board.occupied();
+                const uint64_t free     = ~(color == COL_WHITE ? board.w_occupied : board.b_occupied);
+
+                uint64_t rooks = board.pieces[color][PT_ROOK] | board.pieces[color][PT_QUEEN];
+                while (rooks) {
+                    const uint8_t sq = ls1b_reset(rooks);
+                    checksum += MoveTables::get_rook_targets(1ULL << sq, free, occupied);
+                    ops++;
+                }
+            }
+        }
+
+        return ops;
+    }));
+
+    results.push_back(measure("bishop_targets", [&](uint64_t &checksum) {
+        uint64_t ops = 0;
+
+        for (int r = 0; r < REPEAT; r++) {
+            for (const Board &board : boards) {
+                const Color    color    = board.color;
+                const uint64_t occupied = board.occupied();
+                const uint64_t free     = ~(color == COL_WHITE ? board.w_occupied : board.b_occupied);
+
+                uint64_t bishops = board.pieces[color][PT_BISHOP] | board.pieces[color][PT_QUEEN];
+                while (bishops) {
+                    const uint8_t sq = ls1b_reset(bishops);
+                    checksum += MoveTables::get_bishop_targets(1ULL << sq, free, occupied);
+                    ops++;
+                }
+            }
+        }
+
+        return ops;
+    }));
+
+    results.push_back(measure("legal_moves", [&](uint64_t &checksum) {
+        uint64_t ops = 0;
+
+        for (int r = 0; r < REPEAT; r++) {
+            for (const Board &board : boards) {
+                Move moves[MAX_MOVES];
+                const int count = Movegen::get_legal_moves(board, moves);
+
+                checksum += count;
+                ops++;
+            }
+        }
+
+        return ops;
+    }));
+
+    // the moves are generated beforehand, so only playing them is measured
+    std::vector<std::vector<Move>> legal_moves;
+    for (const Board &board : boards) {
+        Move moves[MAX_MOVES];
+        const int count = Movegen::get_legal_moves(board, moves);
+        legal_moves.emplace_back(moves, moves + count);
+    }
+
+    results.push_back(measure("play_move", [&](uint64_t &checksum) {
+        uint64_t ops = 0;
+
+        for (int r = 0; r < REPEAT; r++) {
+            for (std::size_t i = 0; i < boards.size(); i++) {
+                for (const Move move : legal_moves[i]) {
+                    Board child = boards[i].clone();
+                    child.play_move(move);
+
+                    checksum += child.key;
+                    ops++;
+                }
+            }
+        }
+
+        return ops;
+    }));
+
+    // the parser itself rather than the position command, which skips the
+    // parsing when the same position is sent again. the parser logs into the
+    // standard output on errors only, and all positions have been checked above
+    results.push_back(measure("parse_fen", [&](uint64_t &checksum) {
+        uint64_t ops = 0;
+
+        for (const auto &fields : fen_fields) {
+            Board board;
+            Position::try_parse_fen(fields, board);
+
+            checksum += board.key;
+            ops++;
+        }
+
+        return ops;
+    }));
+
+    if (argc > 1) {
+        std::ofstream output(argv[1]);
+        if (!output) {
+            UCI::log(std::format("Unable to open '{}'", argv[1]));
+            return 1;
+        }
+
+        write_json(output, results, boards.size());
+
+        for (const BenchResult &r : results)
+            UCI::log(std::format("{:<18} {:>10.2f} ns/op", r.name, r.ns_per_op));
+    }
+    else {
+        std::ostringstream json;
+        write_json(json, results, boards.size());
+
+        // the json must go through the same writer as the messages above
+        std::string text = json.str();
+        text.pop_back();
+
+        UCI::log(text);
+    }
+
+    return 0;
+}
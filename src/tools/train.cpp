@@ -0,0 +1,31 @@
+#include <format>
+#include <string>
+
+#include "trainer.h"
+
+#include "src/uci.h"
+#include "src/utils.h"
+
+// Kreveta_2_train <dataset> <output> [threads] [epochs] [batch size]
+int main(const int argc, char *argv[]) {
+    using namespace Kreveta;
+
+    if (argc < 3) {
+        UCI::log("Usage: Kreveta_2_train <dataset> <output> [threads] [epochs] [batch size]");
+        return 1;
+    }
+
+    TrainSettings settings;
+    settings.dataset = argv[1];
+    settings.output  = argv[2];
+
+    if ((argc > 3 && !try_parse(argv[3], settings.threads))
+     || (argc > 4 && !try_parse(argv[4], settings.epochs))
+     || (argc > 5 && !try_parse(argv[5], settings.batch_size))
+     || settings.threads < 0 || settings.epochs < 1 || settings.batch_size < 1) {
+        UCI::log("Invalid trainer arguments");
+        return 1;
+    }
+
+    return Trainer::run(settings) ? 0 : 1;
+}
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <memory>
+#include <numeric>
+#include <random>
+
+#include "trainer.h"
+
+#include "src/bitboard.h"
+#include "src/uci.h"
+#include "src/utils.h"
+
+namespace Kreveta {
+
+// the output layer weights are stored as int8 scaled by QB, so they must stay in this range
+constexpr float MAX_OUT_WEIGHT = 127.0f / NNUE_QB;
+
+static float sigmoid(const float x) {
+    return 1.0f / (1.0f + std::exp(-x));
+}
+
+// ---LOADER--------------------------------------------------------------------
+
+BatchLoader::BatchLoader(const PackedReader &reader, const int batch_size, const uint64_t batches,
+    const double wdl, const uint64_t seed)
+    : reader(reader), batch_size(batch_size), batches(batches), wdl(wdl), seed(seed) {
+
+    thread = std::thread(&BatchLoader::run, this);
+}
+
+BatchLoader::~BatchLoader() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    not_full.notify_all();
+    thread.join();
+}
+
+bool BatchLoader::next(std::vector<TrainSample> &batch) {
+    std::unique_lock lock(mutex);
+    not_empty.wait(lock, [&] { return !queue.empty() || finished; });
+
+    if (queue.empty())
+        return false;
+
+    batch = std::move(queue.front());
+    queue.pop_front();
+
+    lock.unlock();
+    not_full.notify_one();
+
+    return true;
+}
+
+void BatchLoader::run() {
+    std::mt19937_64 rng(seed);
+
+    std::vector<uint32_t> window;
+    std::size_t window_start = 0;
+    std::size_t window_pos   = 0;
+
+    // damaged records are skipped. a file without a single valid one would never fill a batch
+    std::size_t invalid_in_row = 0;
+
+    for (uint64_t b = 0; b < batches && invalid_in_row < reader.size(); b++) {
+        std::vector<TrainSample> batch;
+        batch.reserve(batch_size);
+
+        while (static_cast<int>(batch.size()) < batch_size && invalid_in_row < reader.size()) {
+
+            // the next window of positions is visited in a random order. the
+            // windows themselves go through the file sequentially, which
+            // keeps the reads from the mapped file mostly sequential too
+            if (window_pos == window.size()) {
+                if (window_start >= reader.size())
+                    window_start = 0;
+
+                const std::size_t size = std::min(WINDOW_SIZE, reader.size() - window_start);
+
+                window.resize(size);
+                std::iota(window.begin(), window.end(), 0U);
+                std::ranges::shuffle(window, rng);
+
+                window_pos = 0;
+                window_start += size;
+            }
+
+            const std::size_t index = window_start - window.size() + window[window_pos++];
+
+            if (!reader[index].is_valid()) {
+                invalid_in_row++;
+                continue;
+            }
+
+            invalid_in_row = 0;
+            batch.push_back(Trainer::make_sample(reader[index], wdl));
+        }
+
+        if (batch.empty())
+            break;
+
+        std::unique_lock lock(mutex);
+        not_full.wait(lock, [&] { return queue.size() < QUEUE_SIZE || stopping; });
+
+        if (stopping)
+            return;
+
+        queue.push_back(std::move(batch));
+
+        lock.unlock();
+        not_empty.notify_one();
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        finished = true;
+    }
+
+    not_empty.notify_all();
+}
+
+// ---TRAINER-------------------------------------------------------------------
+
+TrainSample Trainer::make_sample(const PackedPosition &packed, const double wdl) {
+    const Board board = packed.to_board();
+    const Color stm   = board.color;
+
+    TrainSample sample{};
+
+    for (int p = 0; p < 2; p++) {
+        const Color   persp  = p == 0 ? stm : col_flip(stm);
+        const uint8_t bucket = NNUE::king_bucket(board, persp);
+
+        int count = 0;
+        for (int col = 0; col < 2; col++) {
+            for (int pt = 0; pt < 6; pt++) {
+                uint64_t bb = board.pieces[col][pt];
+
+                while (bb && count < 32) {
+                    const uint8_t sq = ls1b_reset(bb);
+                    sample.features[p][count++] = static_cast<uint16_t>(NNUE::feature_index(
+                        persp, bucket, static_cast<Color>(col), static_cast<PieceType>(pt), sq));
+                }
+            }
+        }
+
+        sample.count = static_cast<uint8_t>(count);
+    }
+
+    // both the score and the result are stored from white's point of view. the
+    // network is trained to predict the side to move's expected result, which
+    // is a blend of the actual game result and the result the score implies
+    const float score  = static_cast<float>(stm == COL_WHITE ? packed.score : -packed.score);
+    const float result = packed.result() == RESULT_UNKNOWN
+        ? sigmoid(score / NNUE_SCALE)
+        : stm == COL_WHITE
+            ? static_cast<float>(packed.result()) / 2.0f
+            : 1.0f - static_cast<float>(packed.result()) / 2.0f;
+
+    sample.target = static_cast<float>(wdl * result + (1.0 - wdl) * sigmoid(score / NNUE_SCALE));
+    return sample;
+}
+
+bool Trainer::run(const TrainSettings &settings) {
+    PackedReader reader;
+    if (!reader.open(settings.dataset))
+        return false;
+
+    if (reader.size() == 0) {
+        UCI::log("The dataset is empty");
+        return false;
+    }
+
+    ThreadPool pool(settings.threads);
+
+    const uint64_t batches_per_epoch = std::max<uint64_t>(reader.size() / settings.batch_size, 1);
+
+    UCI::log(std::format("Training on {} positions, {} batches of {} per epoch, {} threads",
+        format_uint64_t(reader.size()), batches_per_epoch, settings.batch_size, pool.size()));
+
+    const auto model    = std::make_unique<Model>();
+    const auto momentum = std::make_unique<Model>();
+    const auto velocity = std::make_unique<Model>();
+
+    init_model(*model, settings.seed);
+
+    std::vector<Gradient> grads(pool.size());
+
+    BatchLoader loader(reader, settings.batch_size, batches_per_epoch * settings.epochs, settings.wdl, settings.seed);
+    std::vector<TrainSample> batch;
+
+    int step = 0;
+
+    for (int epoch = 1; epoch <= settings.epochs; epoch++) {
+        const auto start = std::chrono::steady_clock::now();
+        double loss = 0.0;
+
+        for (uint64_t b = 0; b < batches_per_epoch && loader.next(batch); b++) {
+            const float scale = 1.0f / static_cast<float>(batch.size());
+
+            // the batch is split between the threads, which all accumulate
+            // into their own gradients, so nothing has to be synchronized
+            pool.parallel_for(batch.size(), 256, [&](const std::size_t begin, const std::size_t end, const int thread) {
+                for (std::size_t i = begin; i < end; i++)
+                    backprop(*model, batch[i], scale, grads[thread]);
+            });
+
+            for (Gradient &grad : grads) {
+                loss += grad.loss;
+                grad.loss = 0.0;
+            }
+
+            apply_gradients(*model, *momentum, *velocity, grads, pool, settings.learning_rate, ++step);
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        const uint64_t positions = batches_per_epoch * settings.batch_size;
+
+        UCI::log(std::format("epoch {} loss {:.6f} ({} pos/s)", epoch,
+            loss / static_cast<double>(positions),
+            format_uint64_t(positions * 1000 / std::max<int64_t>(elapsed, 1))));
+
+        // the network is saved after every epoch, so the training can be stopped at any time
+        if (!export_network(*model, settings.output))
+            return false;
+    }
+
+    UCI::log(std::format("Network saved to '{}'", settings.output));
+    return true;
+}
+
+void Trainer::init_model(Model &model, const uint64_t seed) {
+    std::mt19937_64 rng(seed);
+
+    // there are about 32 active features, so their sum stays in the
+    // unclipped range of the activation at the start of the training
+    std::normal_distribution ft_dist(0.0f, 0.05f);
+    std::normal_distribution out_dist(0.0f, 1.0f / std::sqrt(2.0f * HIDDEN_SIZE));
+
+    for (float &w : model.ft_weights)  w = ft_dist(rng);
+    for (float &w : model.out_weights) w = out_dist(rng);
+
+    std::ranges::fill(model.ft_biases, 0.1f);
+    model.out_bias = 0.0f;
+}
+
+// the forward and backward pass of a single position. the loops over the hidden
+// layer are kept simple, so the compiler vectorizes them
+void Trainer::backprop(const Model &model, const TrainSample &sample, const float scale, Gradient &grad) {
+    alignas(64) float acc[2][HIDDEN_SIZE];
+    alignas(64) float acc_grad[2][HIDDEN_SIZE];
+
+    for (int p = 0; p < 2; p++) {
+        std::copy_n(model.ft_biases.data(), HIDDEN_SIZE, acc[p]);
+
+        for (int f = 0; f < sample.count; f++) {
+            const float *row = model.ft_weights.data() + sample.features[p][f] * HIDDEN_SIZE;
+
+            for (int i = 0; i < HIDDEN_SIZE; i++)
+                acc[p][i] += row[i];
+        }
+    }
+
+    float output = model.out_bias;
+    for (int p = 0; p < 2; p++) {
+        const float *weights = model.out_weights.data() + p * HIDDEN_SIZE;
+
+        for (int i = 0; i < HIDDEN_SIZE; i++)
+            output += std::clamp(acc[p][i], 0.0f, 1.0f) * weights[i];
+    }
+
+    // the output is in units of NNUE_SCALE centipawns, which is
+    // exactly what the sigmoid of the target was computed from
+    const float predicted = sigmoid(output);
+    const float error     = predicted - sample.target;
+
+    grad.loss += error * error;
+
+    const float out_grad = 2.0f * error * predicted * (1.0f - predicted) * scale;
+    grad.model.out_bias += out_grad;
+
+    for (int p = 0; p < 2; p++) {
+        const float *weights  = model.out_weights.data() + p * HIDDEN_SIZE;
+        float       *w_grad   = grad.model.out_weights.data() + p * HIDDEN_SIZE;
+
+        for (int i = 0; i < HIDDEN_SIZE; i++) {
+            const bool active = acc[p][i] > 0.0f && acc[p][i] < 1.0f;
+
+            w_grad[i]      += std::clamp(acc[p][i], 0.0f, 1.0f) * out_grad;
+            acc_grad[p][i]  = active ? weights[i] * out_grad : 0.0f;
+        }
+    }
+
+    for (int i = 0; i < HIDDEN_SIZE; i++)
+        grad.model.ft_biases[i] += acc_grad[0][i] + acc_grad[1][i];
+
+    for (int p = 0; p < 2; p++) {
+        for (int f = 0; f < sample.count; f++) {
+            const int feature = sample.features[p][f];
+            float    *row     = grad.model.ft_weights.data() + feature * HIDDEN_SIZE;
+
+            for (int i = 0; i < HIDDEN_SIZE; i++)
+                row[i] += acc_grad[p][i];
+
+            grad.touched[feature] = 1;
+        }
+    }
+}
+
+// adam with lazy updates of the first layer - rows, which didn't appear in the
+// batch, keep their moments unchanged. the touched rows are summed up from all
+// threads and updated in parallel, and the gradients are cleared along the way
+void Trainer::apply_gradients(Model &model, Model &momentum, Model &velocity, std::vector<Gradient> &grads,
+    ThreadPool &pool, const double learning_rate, const int step) {
+
+    constexpr float BETA1   = 0.9f;
+    constexpr float BETA2   = 0.999f;
+    constexpr float EPSILON = 1e-8f;
+
+    const float lr = static_cast<float>(learning_rate
+        * std::sqrt(1.0 - std::pow(BETA2, step)) / (1.0 - std::pow(BETA1, step)));
+
+    const auto adam = [&](float &param, float &m, float &v, const float g) {
+        m = BETA1 * m + (1.0f - BETA1) * g;
+        v = BETA2 * v + (1.0f - BETA2) * g * g;
+        param -= lr * m / (std::sqrt(v) + EPSILON);
+    };
+
+    std::vector<int> rows;
+    for (int row = 0; row < INPUT_SIZE; row++) {
+        for (Gradient &grad : grads) {
+            if (grad.touched[row]) {
+                rows.push_back(row);
+                break;
+            }
+        }
+    }
+
+    pool.parallel_for(rows.size(), 16, [&](const std::size_t begin, const std::size_t end, int) {
+        alignas(64) float sum[HIDDEN_SIZE];
+
+        for (std::size_t r = begin; r < end; r++) {
+            const std::size_t offset = static_cast<std::size_t>(rows[r]) * HIDDEN_SIZE;
+            std::fill_n(sum, HIDDEN_SIZE, 0.0f);
+
+            for (Gradient &grad : grads) {
+                if (!grad.touched[rows[r]])
+                    continue;
+
+                float *row = grad.model.ft_weights.data() + offset;
+                for (int i = 0; i < HIDDEN_SIZE; i++) {
+                    sum[i] += row[i];
+                    row[i]  = 0.0f;
+                }
+
+                grad.touched[rows[r]] = 0;
+            }
+
+            for (int i = 0; i < HIDDEN_SIZE; i++)
+                adam(model.ft_weights[offset + i], momentum.ft_weights[offset + i], velocity.ft_weights[offset + i], sum[i]);
+        }
+    });
+
+    // the remaining layers are small and always updated
+    for (int i = 0; i < HIDDEN_SIZE; i++) {
+        float sum = 0.0f;
+        for (Gradient &grad : grads) {
+            sum += grad.model.ft_biases[i];
+            grad.model.ft_biases[i] = 0.0f;
+        }
+
+        adam(model.ft_biases[i], momentum.ft_biases[i], velocity.ft_biases[i], sum);
+    }
+
+    for (int i = 0; i < 2 * HIDDEN_SIZE; i++) {
+        float sum = 0.0f;
+        for (Gradient &grad : grads) {
+            sum += grad.model.out_weights[i];
+            grad.model.out_weights[i] = 0.0f;
+        }
+
+        adam(model.out_weights[i], momentum.out_weights[i], velocity.out_weights[i], sum);
+        model.out_weights[i] = std::clamp(model.out_weights[i], -MAX_OUT_WEIGHT, MAX_OUT_WEIGHT);
+    }
+
+    float sum = 0.0f;
+    for (Gradient &grad : grads) {
+        sum += grad.model.out_bias;
+        grad.model.out_bias = 0.0f;
+    }
+
+    adam(model.out_bias, momentum.out_bias, velocity.out_bias, sum);
+}
+
+// the activations are in [0, 1] during the training, which the engine
+// represents as [0, QA]. the output weights are then scaled by QB
+bool Trainer::export_network(const Model &model, const std::string &path) {
+    const auto network = std::make_unique<Network>();
+
+    const auto quantize = [](const float value, const float scale, const float limit) {
+        return std::clamp(std::round(value * scale), -limit, limit);
+    };
+
+    for (std::size_t i = 0; i < model.ft_weights.size(); i++)
+        network->ft_weights[i] = static_cast<int16_t>(quantize(model.ft_weights[i], NNUE_QA, 32767.0f));
+
+    for (int i = 0; i < HIDDEN_SIZE; i++)
+        network->ft_biases[i] = static_cast<int16_t>(quantize(model.ft_biases[i], NNUE_QA, 32767.0f));
+
+    for (int i = 0; i < 2 * HIDDEN_SIZE; i++)
+        network->out_weights[i] = static_cast<int8_t>(quantize(model.out_weights[i], NNUE_QB, 127.0f));
+
+    network->out_bias = static_cast<int32_t>(std::round(model.out_bias * NNUE_QA * NNUE_QB));
+
+    return NNUE::save(path, *network);
+}
+
+}
@@ -0,0 +1,123 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/eval/nnue.h"
+#include "src/io/packed_position.h"
+#include "src/threads/thread_pool.h"
+
+namespace Kreveta {
+
+struct TrainSettings {
+    std::string dataset;
+    std::string output;
+
+    // zero threads means one thread per hardware core
+    int      threads       = 0;
+    int      epochs        = 10;
+    int      batch_size    = 16384;
+    double   learning_rate = 0.001;
+
+    // how much the game result is trusted compared to the search score
+    double   wdl           = 0.5;
+    uint64_t seed          = 0;
+};
+
+// a single training position, already converted to the active features of
+// both perspectives (the side to move first) and the expected result
+struct TrainSample {
+    uint16_t features[2][32];
+    uint8_t  count;
+    float    target;
+};
+
+// reads the packed positions straight from the mapped file on a separate thread
+// and prepares the batches ahead, while the training threads work on the current
+// one. the positions are shuffled in windows, so only the indices of the current
+// window are kept in memory and the dataset can be far larger than the memory
+class BatchLoader {
+public:
+    BatchLoader(const PackedReader &reader, int batch_size, uint64_t batches, double wdl, uint64_t seed);
+    ~BatchLoader();
+
+    BatchLoader(const BatchLoader &)            = delete;
+    BatchLoader &operator=(const BatchLoader &) = delete;
+
+    // wait for the next batch. returns false once all batches were handed out
+    bool next(std::vector<TrainSample> &batch);
+
+private:
+    static constexpr std::size_t QUEUE_SIZE  = 4;
+    static constexpr std::size_t WINDOW_SIZE = 1 << 20;
+
+    const PackedReader &reader;
+    const int           batch_size;
+    const uint64_t      batches;
+    const double        wdl;
+    const uint64_t      seed;
+
+    std::deque<std::vector<TrainSample>> queue;
+
+    std::mutex              mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+
+    bool finished = false;
+    bool stopping = false;
+
+    std::thread thread;
+
+    void run();
+};
+
+// trains the network on the CPU. the parameters are kept as floats during the
+// training and quantized into the engine's network format when saving. only a
+// few features are active in every position, so the first layer is computed
+// and updated sparsely - only the rows of the active features are ever touched
+class Trainer {
+public:
+    static bool run(const TrainSettings &settings);
+
+private:
+    static constexpr int INPUT_SIZE  = NNUE_KING_BUCKETS * NNUE_INPUTS;
+    static constexpr int HIDDEN_SIZE = NNUE_HIDDEN_SIZE;
+
+    struct Model {
+        std::vector<float> ft_weights  = std::vector<float>(INPUT_SIZE * HIDDEN_SIZE);
+        std::vector<float> ft_biases   = std::vector<float>(HIDDEN_SIZE);
+        std::vector<float> out_weights = std::vector<float>(2 * HIDDEN_SIZE);
+        float              out_bias    = 0.0f;
+    };
+
+    // every thread owns its gradients. the first layer remembers which rows it
+    // has touched, so only those have to be summed up and updated afterward
+    struct Gradient {
+        Model                model;
+        std::vector<uint8_t> touched = std::vector<uint8_t>(INPUT_SIZE);
+        double               loss    = 0.0;
+    };
+
+    static void init_model(Model &model, uint64_t seed);
+
+    static void backprop(const Model &model, const TrainSample &sample, float scale, Gradient &grad);
+
+    static void apply_gradients(Model &model, Model &momentum, Model &velocity, std::vector<Gradient> &grads,
+        ThreadPool &pool, double learning_rate, int step);
+
+    [[nodiscard]] static TrainSample make_sample(const PackedPosition &packed, double wdl);
+
+    static bool export_network(const Model &model, const std::string &path);
+
+    friend class BatchLoader;
+};
+
+}
+
+#endif //TRAINER_H
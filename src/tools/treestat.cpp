@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <array>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "src/uci.h"
+#include "src/utils.h"
+#include "src/search/search.h"
+#include "src/search/tree_log.h"
+
+using namespace Kreveta;
+
+namespace {
+
+struct TreeSummary {
+    uint64_t records = 0;
+
+    // searched children in all iterations of the same depth
+    std::array<uint64_t, MAX_PLY> iteration_nodes{};
+
+    std::array<uint64_t, TREE_EVENT_COUNT> events{};
+
+    // cutoffs by the index of the move, the last slot collects all later moves
+    std::array<uint64_t, 8> cutoffs{};
+};
+
+bool read_log(const std::string &path, TreeSummary &summary) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    std::vector<TreeRecord> buffer(TreeLog::BUFFER_SIZE);
+    int iteration = 0;
+
+    while (input) {
+        input.read(reinterpret_cast<char *>(buffer.data()),
+            static_cast<std::streamsize>(buffer.size() * sizeof(TreeRecord)));
+
+        const auto count = static_cast<std::size_t>(input.gcount()) / sizeof(TreeRecord);
+
+        for (std::size_t i = 0; i < count; i++) {
+            const TreeRecord &record = buffer[i];
+
+            if (record.event >= TREE_EVENT_COUNT)
+                continue;
+
+            summary.records++;
+            summary.events[record.event]++;
+
+            switch (record.event) {
+                case TREE_ITERATION:
+                    iteration = std::clamp<int>(record.depth, 0, MAX_PLY - 1);
+                    break;
+
+                case TREE_CHILD:
+                case TREE_CHILD_REDUCED:
+                case TREE_CHILD_RESEARCH:
+                    summary.iteration_nodes[iteration]++;
+                    break;
+
+                case TREE_BETA_CUTOFF:
+                    summary.cutoffs[std::min<std::size_t>(record.cutoff, summary.cutoffs.size() - 1)]++;
+                    break;
+
+                default: break;
+            }
+        }
+    }
+
+    return true;
+}
+
+uint64_t percent(const uint64_t part, const uint64_t total) {
+    return total ? part * 100 / total : 0;
+}
+
+void print_summary(const TreeSummary &s) {
+    UCI::log(std::format("records: {}", format_uint64_t(s.records)));
+
+    // the effective branching factor is how many times more nodes
+    // an iteration needed than the previous one
+    UCI::log("\ndepth         nodes     ebf");
+    for (int depth = 1; depth < MAX_PLY; depth++) {
+        if (!s.iteration_nodes[depth])
+            continue;
+
+        const uint64_t prev = s.iteration_nodes[depth - 1];
+        UCI::log(std::format("{:>5} {:>13} {:>7}", depth, format_uint64_t(s.iteration_nodes[depth]),
+            prev ? std::format("{:.2f}", static_cast<double>(s.iteration_nodes[depth]) / static_cast<double>(prev)) : "-"));
+    }
+
+    const uint64_t cutoffs = s.events[TREE_BETA_CUTOFF];
+
+    UCI::log(std::format("\nbeta cutoffs: {}", format_uint64_t(cutoffs)));
+    for (std::size_t i = 0; i < s.cutoffs.size(); i++) {
+        UCI::log(std::format("  move {}{:<3} {:>3}%", i + 1, i + 1 == s.cutoffs.size() ? "+" : "",
+            percent(s.cutoffs[i], cutoffs)));
+    }
+
+    UCI::log("\npruning:");
+    UCI::log(std::format("  tt cutoffs          {:>13}", format_uint64_t(s.events[TREE_TT_CUTOFF])));
+    UCI::log(std::format("  tablebase cutoffs   {:>13}", format_uint64_t(s.events[TREE_TB_CUTOFF])));
+    UCI::log(std::format("  reverse futility    {:>13}", format_uint64_t(s.events[TREE_REVERSE_FUTILITY])));
+    UCI::log(std::format("  null move           {:>13}", format_uint64_t(s.events[TREE_NULL_MOVE])));
+
+    UCI::log("\nsearched children:");
+    UCI::log(std::format("  full depth          {:>13}", format_uint64_t(s.events[TREE_CHILD])));
+    UCI::log(std::format("  reduced             {:>13}", format_uint64_t(s.events[TREE_CHILD_REDUCED])));
+    UCI::log(std::format("  re-searched         {:>13}", format_uint64_t(s.events[TREE_CHILD_RESEARCH])));
+}
+
+}
+
+// Kreveta_2_treestat <log> [log ...]. the logs of all threads
+// (or several searches) are summarized together
+int main(const int argc, char *argv[]) {
+    if (argc < 2) {
+        UCI::log("Usage: Kreveta_2_treestat <log> [log ...]");
+        return 1;
+    }
+
+    TreeSummary summary;
+
+    for (int i = 1; i < argc; i++) {
+        if (!read_log(argv[i], summary))
+            return 1;
+    }
+
+    print_summary(summary);
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <format>
+#include <string>
+
+#include "tuner.h"
+
+#include "src/uci.h"
+#include "src/utils.h"
+
+// Kreveta_2_tune <dataset> [output] [threads] [epochs]
+int main(const int argc, char *argv[]) {
+    using namespace Kreveta;
+
+    if (argc < 2) {
+        UCI::log("Usage: Kreveta_2_tune <dataset> [output] [threads] [epochs]");
+        return 1;
+    }
+
+    TuneSettings settings;
+    settings.dataset = argv[1];
+
+    if (argc > 2) settings.output = argv[2];
+
+    if ((argc > 3 && !try_parse(argv[3], settings.threads))
+     || (argc > 4 && !try_parse(argv[4], settings.epochs))
+     || settings.threads < 0 || settings.epochs < 0) {
+        UCI::log("Invalid tuner arguments");
+        return 1;
+    }
+
+    return Tuner::run(settings) ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <numeric>
+
+#include "tuner.h"
+
+#include "src/bitboard.h"
+#include "src/position.h"
+#include "src/uci.h"
+#include "src/utils.h"
+
+namespace Kreveta {
+
+// the scores are scaled by this before the sigmoid, so k stays around one
+constexpr double SIGMOID_SCALE = 400.0;
+
+// each thread processes this many positions at once
+constexpr std::size_t CHUNK_SIZE = 1 << 14;
+
+static double sigmoid(const double score, const double k) {
+    return 1.0 / (1.0 + std::exp(-k * score / SIGMOID_SCALE));
+}
+
+bool Tuner::run(const TuneSettings &settings) {
+    Dataset data;
+    if (!load(settings.dataset, data))
+        return false;
+
+    if (data.entries.empty()) {
+        UCI::log("The dataset doesn't contain any labeled positions");
+        return false;
+    }
+
+    UCI::log(std::format("Loaded {} positions ({} coefficients)",
+        format_uint64_t(data.entries.size()), format_uint64_t(data.coefs.size())));
+
+    ThreadPool pool(settings.threads);
+
+    Params params;
+    for (int pt = 0; pt < 6; pt++) {
+        for (int sq = 0; sq < PSQT_SQUARES; sq++)
+            params[pt * PSQT_SQUARES + sq] = PSQT_VALUES[pt][sq];
+    }
+
+    // k maps the scores to the expected results. it's fitted to the current
+    // values first and then stays fixed, so only the values are tuned
+    const double k = find_k(data, params, pool);
+    UCI::log(std::format("k = {:.4f}, initial error {:.6f}", k, total_error(data, params, k, pool)));
+
+    // adam keeps a running average of the gradients and their squares, so each
+    // parameter effectively gets its own learning rate. this matters a lot here,
+    // since pawns appear in almost every position while queens on some squares
+    // appear only rarely
+    constexpr double BETA1   = 0.9;
+    constexpr double BETA2   = 0.999;
+    constexpr double EPSILON = 1e-8;
+
+    Params gradient;
+    Params momentum{};
+    Params velocity{};
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int epoch = 1; epoch <= settings.epochs; epoch++) {
+        compute_gradient(data, params, k, pool, gradient);
+
+        const double correction1 = 1.0 - std::pow(BETA1, epoch);
+        const double correction2 = 1.0 - std::pow(BETA2, epoch);
+
+        for (int i = 0; i < PARAM_COUNT; i++) {
+            momentum[i] = BETA1 * momentum[i] + (1.0 - BETA1) * gradient[i];
+            velocity[i] = BETA2 * velocity[i] + (1.0 - BETA2) * gradient[i] * gradient[i];
+
+            params[i] -= settings.learning_rate * (momentum[i] / correction1)
+                / (std::sqrt(velocity[i] / correction2) + EPSILON);
+        }
+
+        if (epoch % 100 == 0 || epoch == settings.epochs) {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+            UCI::log(std::format("epoch {} error {:.6f} ({} ms)", epoch, total_error(data, params, k, pool), elapsed));
+        }
+    }
+
+    return write_header(settings.output, params, data.entries.size(), total_error(data, params, k, pool));
+}
+
+// the dataset is either a file of packed positions, or a text file with a FEN
+// followed by the game result on each line (see parse_game_result)
+bool Tuner::load(const std::string &path, Dataset &data) {
+    if (path.ends_with(".bin")) {
+        PackedReader reader;
+        if (!reader.open(path))
+            return false;
+
+        data.entries.reserve(reader.size());
+
+        for (const PackedPosition &packed : reader) {
+            if (packed.result() != RESULT_UNKNOWN && packed.is_valid())
+                add_position(packed.to_board(), packed.result(), data);
+        }
+
+        return true;
+    }
+
+    std::ifstream input{path};
+    if (!input) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(input, line)) {
+        if (is_str_blank(line))
+            continue;
+
+        const auto tokens = str_split(line);
+
+        Board board;
+        if (!Position::try_parse_fen(tokens, board) || !board.has_valid_material())
+            continue;
+
+        GameResult result = RESULT_UNKNOWN;
+        for (std::size_t i = 4; i < tokens.size() && result == RESULT_UNKNOWN; i++)
+            result = parse_game_result(tokens[i]);
+
+        if (result != RESULT_UNKNOWN)
+            add_position(board, result, data);
+    }
+
+    return true;
+}
+
+void Tuner::add_position(const Board &board, const GameResult result, Dataset &data) {
+
+    // the coefficient of a parameter is the number of white pieces using
+    // it minus the number of black pieces, so the score is from white's
+    // point of view. the table is relative to the owner of the piece
+    int8_t coefs[PARAM_COUNT]{};
+
+    for (int pt = 0; pt < 6; pt++) {
+        uint64_t white = board.pieces[COL_WHITE][pt];
+        uint64_t black = board.pieces[COL_BLACK][pt];
+
+        while (white) coefs[pt * PSQT_SQUARES + psqt_index(ls1b_reset(white) ^ 56)]++;
+        while (black) coefs[pt * PSQT_SQUARES + psqt_index(ls1b_reset(black))]--;
+    }
+
+    Entry entry {
+        .first  = static_cast<uint32_t>(data.params.size()),
+        .count  = 0,
+        .result = static_cast<float>(result) / 2.0f
+    };
+
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        if (coefs[i] == 0)
+            continue;
+
+        data.params.push_back(static_cast<uint8_t>(i));
+        data.coefs.push_back(coefs[i]);
+        entry.count++;
+    }
+
+    data.entries.push_back(entry);
+}
+
+double Tuner::evaluate(const Dataset &data, const Entry &entry, const Params &params) {
+    double score = 0.0;
+
+    for (uint32_t i = entry.first; i < entry.first + entry.count; i++)
+        score += data.coefs[i] * params[data.params[i]];
+
+    return score;
+}
+
+double Tuner::total_error(const Dataset &data, const Params &params, const double k, ThreadPool &pool) {
+    std::vector<double> errors(pool.size(), 0.0);
+
+    pool.parallel_for(data.entries.size(), CHUNK_SIZE, [&](const std::size_t begin, const std::size_t end, const int thread) {
+        double error = 0.0;
+
+        for (std::size_t i = begin; i < end; i++) {
+            const double diff = data.entries[i].result - sigmoid(evaluate(data, data.entries[i], params), k);
+            error += diff * diff;
+        }
+
+        errors[thread] += error;
+    });
+
+    return std::accumulate(errors.begin(), errors.end(), 0.0) / static_cast<double>(data.entries.size());
+}
+
+// the error has a single minimum in k, so a ternary search keeps narrowing the range around it
+double Tuner::find_k(const Dataset &data, const Params &params, ThreadPool &pool) {
+    double low  = 0.0;
+    double high = 10.0;
+
+    while (high - low > 1e-4) {
+        const double a = low  + (high - low) / 3.0;
+        const double b = high - (high - low) / 3.0;
+
+        if (total_error(data, params, a, pool) < total_error(data, params, b, pool))
+            high = b;
+        else low = a;
+    }
+
+    return (low + high) / 2.0;
+}
+
+// every thread sums the gradients of its positions separately, and the
+// sums are only added together at the end, so the threads never share
+// anything they write to
+void Tuner::compute_gradient(const Dataset &data, const Params &params, const double k, ThreadPool &pool, Params &gradient) {
+    const auto partial = std::make_unique<Params[]>(pool.size());
+
+    for (int t = 0; t < pool.size(); t++)
+        std::fill_n(partial[t], PARAM_COUNT, 0.0);
+
+    pool.parallel_for(data.entries.size(), CHUNK_SIZE, [&](const std::size_t begin, const std::size_t end, const int thread) {
+        Params &local = partial[thread];
+
+        for (std::size_t i = begin; i < end; i++) {
+            const Entry &entry = data.entries[i];
+            const double s     = sigmoid(evaluate(data, entry, params), k);
+
+            // derivative of (result - sigmoid)^2 with respect to the score
+            const double d = -2.0 * (entry.result - s) * s * (1.0 - s) * k / SIGMOID_SCALE;
+
+            for (uint32_t j = entry.first; j < entry.first + entry.count; j++)
+                local[data.params[j]] += d * data.coefs[j];
+        }
+    });
+
+    for (int i = 0; i < PARAM_COUNT; i++) {
+        gradient[i] = 0.0;
+
+        for (int t = 0; t < pool.size(); t++)
+            gradient[i] += partial[t][i];
+
+        gradient[i] /= static_cast<double>(data.entries.size());
+    }
+}
+
+// the output has exactly the same layout as psqt.h, so it can simply replace it
+bool Tuner::write_header(const std::string &path, const Params &params, const std::size_t positions, const double error) {
+    std::ofstream out{path};
+    if (!out) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    constexpr std::string_view PIECE_NAMES[6] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+
+    out << "//\n// Generated by Kreveta_2_tune.\n//\n\n"
+        << "#ifndef PSQT_H\n#define PSQT_H\n\n"
+        << "#include <cstdint>\n\n"
+        << "namespace Kreveta {\n\n"
+        << "// value of each piece on each square in centipawns, which the bootstrap network is\n"
+        << "// built from. the squares are relative to the owner of the piece (the first rank is\n"
+        << "// the owner's back rank) and the files are folded, so only the a-d files are stored.\n"
+        << "// this file can be regenerated from labeled positions by the Kreveta_2_tune tool\n"
+        << "constexpr int PSQT_SQUARES = 32;\n\n"
+        << "[[nodiscard]] constexpr int psqt_index(const uint8_t rel_sq) {\n"
+        << "    const int file = rel_sq & 7;\n"
+        << "    return (rel_sq >> 3) * 4 + (file < 4 ? file : 7 - file);\n"
+        << "}\n\n"
+        << std::format("// tuned on {} positions, final error {:.6f}\n", positions, error)
+        << "constexpr int16_t PSQT_VALUES[6][PSQT_SQUARES] = {\n";
+
+    for (int pt = 0; pt < 6; pt++) {
+        out << "    // " << PIECE_NAMES[pt] << "\n    {\n";
+
+        for (int rank = 0; rank < 8; rank++) {
+            out << "       ";
+
+            for (int file = 0; file < 4; file++) {
+                const double value = params[pt * PSQT_SQUARES + rank * 4 + file];
+                out << std::format(" {:>3},", std::lround(std::clamp(value, -32000.0, 32000.0)));
+            }
+
+            out << '\n';
+        }
+
+        out << "    },\n";
+    }
+
+    out << "};\n\n}\n\n#endif //PSQT_H\n";
+
+    UCI::log(std::format("Tuned values written to '{}'", path));
+    return static_cast<bool>(out);
+}
+
+}
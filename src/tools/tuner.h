@@ -0,0 +1,67 @@
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/board.h"
+#include "src/eval/psqt.h"
+#include "src/io/packed_position.h"
+#include "src/threads/thread_pool.h"
+
+namespace Kreveta {
+
+struct TuneSettings {
+    std::string dataset;
+    std::string output = "psqt.h";
+
+    // zero threads means one thread per hardware core
+    int    threads       = 0;
+    int    epochs        = 2000;
+    double learning_rate = 1.0;
+};
+
+// texel tuning of the piece-square table, which the bootstrap network is built from.
+// the evaluation is linear in the parameters, so every position is reduced to the
+// few parameters it actually uses (with the piece counts as coefficients) just once
+// when loading, and each epoch only has to go through these short sparse vectors
+class Tuner {
+public:
+    static bool run(const TuneSettings &settings);
+
+private:
+    static constexpr int PARAM_COUNT = 6 * PSQT_SQUARES;
+
+    // the coefficients of a single position are stored in one shared
+    // array, the entry only remembers where they start and end
+    struct Entry {
+        uint32_t first;
+        uint8_t  count;
+        float    result;
+    };
+
+    struct Dataset {
+        std::vector<Entry>   entries;
+        std::vector<uint8_t> params;
+        std::vector<int8_t>  coefs;
+    };
+
+    using Params = double[PARAM_COUNT];
+
+    static bool load(const std::string &path, Dataset &data);
+    static void add_position(const Board &board, GameResult result, Dataset &data);
+
+    [[nodiscard]] static double evaluate(const Dataset &data, const Entry &entry, const Params &params);
+
+    [[nodiscard]] static double total_error(const Dataset &data, const Params &params, double k, ThreadPool &pool);
+    [[nodiscard]] static double find_k(const Dataset &data, const Params &params, ThreadPool &pool);
+
+    static void compute_gradient(const Dataset &data, const Params &params, double k, ThreadPool &pool, Params &gradient);
+
+    static bool write_header(const std::string &path, const Params &params, std::size_t positions, double error);
+};
+
+}
+
+#endif //TUNER_H
@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "src/uci.h"
+#include "src/utils.h"
+
+using namespace Kreveta;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// the engine runs as a child process connected through pipes, exactly like under
+// a gui. the output is read by its own thread, so waiting for a line can time out
+class EngineProcess {
+public:
+    EngineProcess() = default;
+    ~EngineProcess() { close(); }
+
+    EngineProcess(const EngineProcess &)            = delete;
+    EngineProcess &operator=(const EngineProcess &) = delete;
+
+    bool start(const std::string &path);
+    void close();
+
+    void write_line(const std::string &line);
+
+    // the time, when a line starting with the prefix was received. all lines
+    // before it are skipped. returns nothing if the engine didn't answer in time
+    std::optional<Clock::time_point> wait_for(std::string_view prefix, std::chrono::milliseconds timeout,
+        std::string *line_out = nullptr);
+
+private:
+    struct Line {
+        std::string       text;
+        Clock::time_point time;
+    };
+
+    std::thread             reader;
+    std::mutex              mutex;
+    std::condition_variable line_ready;
+    std::deque<Line>        lines;
+    bool                    finished = false;
+
+#ifdef _WIN32
+    HANDLE process = nullptr;
+    HANDLE input   = nullptr;
+    HANDLE output  = nullptr;
+#else
+    pid_t pid    = -1;
+    int   input  = -1;
+    int   output = -1;
+#endif
+
+    // returns the number of bytes read, zero once the engine exited
+    std::size_t read_raw(char *buffer, std::size_t size);
+
+    void read_loop();
+};
+
+#ifdef _WIN32
+bool EngineProcess::start(const std::string &path) {
+    SECURITY_ATTRIBUTES attributes{ sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+
+    HANDLE child_in_read, child_out_write;
+    if (!CreatePipe(&child_in_read, &input, &attributes, 0) || !CreatePipe(&output, &child_out_write, &attributes, 0))
+        return false;
+
+    // our ends of the pipes mustn't be inherited by the engine
+    SetHandleInformation(input,  HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA startup{};
+    startup.cb         = sizeof(startup);
+    startup.dwFlags    = STARTF_USESTDHANDLES;
+    startup.hStdInput  = child_in_read;
+    startup.hStdOutput = child_out_write;
+    startup.hStdError  = GetStdHandle(STD_ERROR_HANDLE);
+
+    PROCESS_INFORMATION info{};
+    std::string command = path;
+
+    const bool created = CreateProcessA(nullptr, command.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &info);
+
+    CloseHandle(child_in_read);
+    CloseHandle(child_out_write);
+
+    if (!created)
+        return false;
+
+    CloseHandle(info.hThread);
+    process = info.hProcess;
+
+    reader = std::thread(&EngineProcess::read_loop, this);
+    return true;
+}
+
+void EngineProcess::close() {
+    if (input) {
+        write_line("quit");
+        CloseHandle(input);
+        input = nullptr;
+    }
+
+    if (process) {
+        if (WaitForSingleObject(process, 2000) != WAIT_OBJECT_0)
+            TerminateProcess(process, 1);
+
+        CloseHandle(process);
+        process = nullptr;
+    }
+
+    if (reader.joinable())
+        reader.join();
+
+    if (output) {
+        CloseHandle(output);
+        output = nullptr;
+    }
+}
+
+void EngineProcess::write_line(const std::string &line) {
+    const std::string data = line + '\n';
+
+    DWORD written;
+    WriteFile(input, data.data(), static_cast<DWORD>(data.size()), &written, nullptr);
+}
+
+std::size_t EngineProcess::read_raw(char *buffer, const std::size_t size) {
+    DWORD read = 0;
+    return ReadFile(output, buffer, static_cast<DWORD>(size), &read, nullptr) ? read : 0;
+}
+#else
+bool EngineProcess::start(const std::string &path) {
+    int to_child[2], from_child[2];
+    if (pipe(to_child) != 0 || pipe(from_child) != 0)
+        return false;
+
+    pid = fork();
+    if (pid < 0)
+        return false;
+
+    if (pid == 0) {
+        dup2(to_child[0],   STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+
+        ::close(to_child[0]);   ::close(to_child[1]);
+        ::close(from_child[0]); ::close(from_child[1]);
+
+        execl(path.c_str(), path.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    ::close(to_child[0]);
+    ::close(from_child[1]);
+
+    input  = to_child[1];
+    output = from_child[0];
+
+    // a crashed engine mustn't kill the harness when writing to it
+    std::signal(SIGPIPE, SIG_IGN);
+
+    reader = std::thread(&EngineProcess::read_loop, this);
+    return true;
+}
+
+void EngineProcess::close() {
+    if (input != -1) {
+        write_line("quit");
+        ::close(input);
+        input = -1;
+    }
+
+    if (pid > 0) {
+        int status;
+        const auto deadline = Clock::now() + std::chrono::seconds(2);
+
+        while (waitpid(pid, &status, WNOHANG) == 0) {
+            if (Clock::now() > deadline) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                break;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        pid = -1;
+    }
+
+    if (reader.joinable())
+        reader.join();
+
+    if (output != -1) {
+        ::close(output);
+        output = -1;
+    }
+}
+
+void EngineProcess::write_line(const std::string &line) {
+    const std::string data = line + '\n';
+    (void)!write(input, data.data(), data.size());
+}
+
+std::size_t EngineProcess::read_raw(char *buffer, const std::size_t size) {
+    const ssize_t count = read(output, buffer, size);
+    return count > 0 ? static_cast<std::size_t>(count) : 0;
+}
+#endif
+
+// lines are timestamped as soon as they arrive, so the measured latency
+// doesn't depend on when the main thread gets to them
+void EngineProcess::read_loop() {
+    char        buffer[4096];
+    std::string pending;
+
+    while (const std::size_t count = read_raw(buffer, sizeof(buffer))) {
+        const auto time = Clock::now();
+
+        pending.append(buffer, count);
+
+        std::size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            std::lock_guard lock(mutex);
+            lines.push_back({ std::move(line), time });
+        }
+
+        line_ready.notify_all();
+    }
+
+    std::lock_guard lock(mutex);
+    finished = true;
+    line_ready.notify_all();
+}
+
+std::optional<Clock::time_point> EngineProcess::wait_for(const std::string_view prefix,
+    const std::chrono::milliseconds timeout, std::string *line_out) {
+
+    const auto deadline = Clock::now() + timeout;
+    std::unique_lock lock(mutex);
+
+    while (true) {
+        while (!lines.empty()) {
+            Line line = std::move(lines.front());
+            lines.pop_front();
+
+            if (line.text.starts_with(prefix)) {
+                if (line_out) *line_out = std::move(line.text);
+                return line.time;
+            }
+        }
+
+        if (finished || (line_ready.wait_until(lock, deadline) == std::cv_status::timeout && lines.empty()))
+            return std::nullopt;
+    }
+}
+
+// latencies of a single kind of command in microseconds
+struct Samples {
+    std::string          name;
+    std::vector<int64_t> values;
+
+    void add(const int64_t value) { values.push_back(value); }
+
+    void print() {
+        if (values.empty()) {
+            UCI::log(std::format("{:<20} no samples", name));
+            return;
+        }
+
+        std::ranges::sort(values);
+
+        const auto percentile = [&](const double p) {
+            return values[std::min(values.size() - 1, static_cast<std::size_t>(p * static_cast<double>(values.size())))];
+        };
+
+        UCI::log(std::format("{:<20} {:>6} {:>10} {:>10} {:>10} {:>10}", name, values.size(),
+            percentile(0.50), percentile(0.90), percentile(0.99), values.back()));
+    }
+};
+
+int64_t micros(const Clock::time_point from, const Clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+}
+
+// Kreveta_2_ucilatency <engine> [movetime] [rounds]. all latencies are measured
+// from writing the command until the answer arrives, and the go overshoot is the
+// time after the requested movetime, until the bestmove arrived
+int main(const int argc, char *argv[]) {
+    if (argc < 2) {
+        UCI::log("Usage: Kreveta_2_ucilatency <engine> [movetime] [rounds]");
+        return 1;
+    }
+
+    int movetime = 100;
+    int rounds   = 20;
+
+    if ((argc > 2 && (!try_parse(argv[2], movetime) || movetime < 1))
+     || (argc > 3 && (!try_parse(argv[3], rounds)   || rounds   < 1))) {
+        UCI::log("Invalid movetime or round count");
+        return 1;
+    }
+
+    EngineProcess engine;
+    if (!engine.start(argv[1])) {
+        UCI::log(std::format("Unable to start '{}'", argv[1]));
+        return 1;
+    }
+
+    constexpr auto TIMEOUT = std::chrono::milliseconds(10'000);
+
+    Samples uci       { "uci -> uciok" };
+    Samples isready   { "isready -> readyok" };
+    Samples position  { "position+isready" };
+    Samples overshoot { "go movetime overshoot" };
+    Samples stop      { "stop -> bestmove" };
+
+    // sends the command and measures the time until the answer
+    const auto request = [&](const std::string &command, const std::string_view answer, Samples &samples,
+        std::string *line = nullptr) {
+
+        const auto sent     = Clock::now();
+        engine.write_line(command);
+
+        const auto received = engine.wait_for(answer, TIMEOUT, line);
+        if (!received) {
+            UCI::log(std::format("No '{}' received after '{}'", answer, command));
+            return false;
+        }
+
+        samples.add(micros(sent, *received));
+        return true;
+    };
+
+    // this also includes the startup of the engine (tables, bitbases, network)
+    if (!request("uci", "uciok", uci))
+        return 1;
+
+    for (int i = 0; i < 100; i++) {
+        if (!request("isready", "readyok", isready))
+            return 1;
+    }
+
+    // a game against itself, so the position commands grow like in a real game
+    std::string moves;
+
+    for (int round = 0; round < rounds; round++) {
+        const std::string position_cmd = moves.empty()
+            ? "position startpos"
+            : "position startpos moves" + moves;
+
+        const auto sent = Clock::now();
+        engine.write_line(position_cmd);
+        engine.write_line("isready");
+
+        const auto ready = engine.wait_for("readyok", TIMEOUT);
+        if (!ready) {
+            UCI::log("No 'readyok' received after 'position'");
+            return 1;
+        }
+
+        position.add(micros(sent, *ready));
+
+        std::string line;
+        const auto go_sent = Clock::now();
+        engine.write_line(std::format("go movetime {}", movetime));
+
+        const auto bestmove = engine.wait_for("bestmove", TIMEOUT, &line);
+        if (!bestmove) {
+            UCI::log("No 'bestmove' received after 'go movetime'");
+            return 1;
+        }
+
+        overshoot.add(micros(go_sent, *bestmove) - movetime * 1000LL);
+
+        const auto tokens = str_split(line);
+        if (tokens.size() < 2 || tokens[1] == "0000" || tokens[1] == "(none)") {
+            moves.clear();
+            continue;
+        }
+
+        moves += ' ';
+        moves += tokens[1];
+
+        // an infinite search, which is interrupted
+        engine.write_line("go infinite");
+        std::this_thread::sleep_for(std::chrono::milliseconds(movetime));
+
+        if (!request("stop", "bestmove", stop))
+            return 1;
+    }
+
+    UCI::log(std::format("{:<20} {:>6} {:>10} {:>10} {:>10} {:>10}", "latency (us)", "count", "p50", "p90", "p99", "max"));
+
+    uci.print();
+    isready.print();
+    position.print();
+    overshoot.print();
+    stop.print();
+
+    return 0;
+}
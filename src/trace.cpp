@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "trace.h"
+
+#include "uci.h"
+
+namespace Kreveta {
+
+const std::chrono::steady_clock::time_point Trace::start_time = std::chrono::steady_clock::now();
+
+namespace {
+
+// the fields are atomic only so a dump can read them while the owner is writing, the
+// relaxed loads and stores compile into plain moves. an event being overwritten during
+// a dump may be read torn, so the dump drops all events, which might have been reused
+struct TraceEvent {
+    std::atomic<const char *> name   = nullptr;
+    std::atomic<int64_t>      start  = 0;
+    std::atomic<int64_t>      end    = 0;
+    std::atomic<uint32_t>     thread = 0;
+};
+
+// the buffer is only written by its owner thread. "claimed" is increased before an
+// event is written and "count" after it, which lets a dump find the events, which
+// were complete before it started reading and weren't overwritten until it finished
+struct TraceBuffer {
+    std::unique_ptr<TraceEvent[]> events  = std::make_unique<TraceEvent[]>(Trace::BUFFER_SIZE);
+    std::atomic<uint64_t>         claimed = 0;
+    std::atomic<uint64_t>         count   = 0;
+
+    // guarded by the registry mutex
+    bool                          in_use  = false;
+};
+
+std::mutex                                registry_mutex;
+std::vector<std::unique_ptr<TraceBuffer>> buffers;
+std::atomic<uint32_t>                     next_thread = 0;
+
+// a new thread is started for every search, so the buffers of finished threads are
+// reused instead of allocating new ones. the events remember their own thread, so
+// the older zones are still shown correctly
+struct ThreadBuffer {
+    TraceBuffer *buffer = nullptr;
+    uint32_t     thread = next_thread.fetch_add(1, std::memory_order_relaxed);
+
+    TraceBuffer &get() {
+        if (buffer)
+            return *buffer;
+
+        std::lock_guard lock(registry_mutex);
+
+        const auto free = std::ranges::find_if(buffers, [](const auto &b) { return !b->in_use; });
+        if (free != buffers.end()) {
+            buffer = free->get();
+        }
+        else {
+            buffers.push_back(std::make_unique<TraceBuffer>());
+            buffer = buffers.back().get();
+        }
+
+        buffer->in_use = true;
+        return *buffer;
+    }
+
+    ~ThreadBuffer() {
+        if (!buffer)
+            return;
+
+        std::lock_guard lock(registry_mutex);
+        buffer->in_use = false;
+    }
+};
+
+thread_local ThreadBuffer local;
+
+}
+
+void Trace::record(const char *name, const int64_t start, const int64_t end) {
+    TraceBuffer &buffer = local.get();
+
+    const uint64_t index = buffer.count.load(std::memory_order_relaxed);
+    TraceEvent    &event = buffer.events[index % BUFFER_SIZE];
+
+    buffer.claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    event.name.store(name,           std::memory_order_relaxed);
+    event.start.store(start,         std::memory_order_relaxed);
+    event.end.store(end,             std::memory_order_relaxed);
+    event.thread.store(local.thread, std::memory_order_relaxed);
+
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+bool Trace::dump(const std::string &path) {
+    std::ofstream output(path);
+    if (!output) {
+        UCI::log(std::format("Unable to open '{}'", path));
+        return false;
+    }
+
+    output << "{\"traceEvents\":[\n";
+
+    bool     first  = true;
+    uint64_t events = 0;
+
+    std::lock_guard registry_lock(registry_mutex);
+
+    struct Event {
+        const char *name;
+        int64_t     start;
+        int64_t     end;
+        uint32_t    thread;
+    };
+
+    std::vector<Event> copy;
+
+    for (const auto &buffer : buffers) {
+        const uint64_t count = buffer->count.load(std::memory_order_acquire);
+        const uint64_t begin = count > BUFFER_SIZE ? count - BUFFER_SIZE : 0;
+
+        copy.clear();
+        for (uint64_t i = begin; i < count; i++) {
+            const TraceEvent &event = buffer->events[i % BUFFER_SIZE];
+
+            copy.push_back({
+                event.name.load(std::memory_order_relaxed),
+                event.start.load(std::memory_order_relaxed),
+                event.end.load(std::memory_order_relaxed),
+                event.thread.load(std::memory_order_relaxed)
+            });
+        }
+
+        // the events claimed by the owner since then have overwritten the oldest ones
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t claimed = buffer->claimed.load(std::memory_order_relaxed);
+        const uint64_t valid   = claimed > BUFFER_SIZE ? claimed - BUFFER_SIZE : 0;
+
+        for (uint64_t i = std::max(begin, valid); i < count; i++) {
+            const Event &event = copy[i - begin];
+
+            // complete events with the timestamps in microseconds
+            output << std::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                first ? "" : ",\n", event.name, event.thread,
+                static_cast<double>(event.start) / 1000.0, static_cast<double>(event.end - event.start) / 1000.0);
+
+            first = false;
+            events++;
+        }
+    }
+
+    output << "\n]}\n";
+
+    UCI::log(std::format("info string Trace with {} zones written to '{}'", events, path));
+    return true;
+}
+
+}
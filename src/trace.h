@@ -0,0 +1,71 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Kreveta {
+
+// a timeline of what every thread was doing, which can be opened in chrome://tracing
+// or ui.perfetto.dev. every thread records the finished zones into its own ring
+// buffer, so only the most recent zones are kept, and recording never allocates or
+// locks. only coarse zones (iterations, root moves, waiting) should be traced, since
+// zones of single nodes would overwrite the whole buffer within milliseconds. like
+// the statistics, tracing is only compiled with the KREVETA_TRACE option
+class Trace {
+public:
+    // the number of zones kept per thread
+    static constexpr std::size_t BUFFER_SIZE = 1 << 16;
+
+    static constexpr std::string_view DEFAULT_FILE = "kreveta_trace.json";
+
+    // the name must be a string literal, only the pointer is stored
+    static void record(const char *name, int64_t start, int64_t end);
+
+    // writes all buffers as chrome trace events. returns false if the file can't be written
+    static bool dump(const std::string &path);
+
+    // nanoseconds since the program started
+    [[nodiscard]] static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+    }
+
+private:
+    static const std::chrono::steady_clock::time_point start_time;
+};
+
+// records the time from its construction until the end of the scope
+class TraceZone {
+public:
+    explicit TraceZone(const char *name, const bool enabled = true)
+        : name(name), start(enabled ? Trace::now() : -1) {}
+
+    ~TraceZone() {
+        if (start >= 0)
+            Trace::record(name, start, Trace::now());
+    }
+
+    TraceZone(const TraceZone &)            = delete;
+    TraceZone &operator=(const TraceZone &) = delete;
+
+private:
+    const char *name;
+    int64_t     start;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT_IMPL(a, b)
+
+#ifdef KREVETA_TRACE
+#define TRACE_ZONE(name)          const TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_ZONE_IF(cond, name) const TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name, cond)
+#else
+#define TRACE_ZONE(name)          ((void)0)
+#define TRACE_ZONE_IF(cond, name) ((void)0)
+#endif
+
+}
+
+#endif //TRACE_H
@@ -3,27 +3,42 @@
 //
 
 #include <string>
-#include <iostream>
 #include <format>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
 
 #include "uci.h"
 
 #include "bitboard.h"
 #include "position.h"
+#include "trace.h"
 #include "utils.h"
+#include "eval/nnue.h"
 #include "movegen/movegen.h"
+#include "search/bench.h"
+#include "tablebase/syzygy.h"
 
 namespace Kreveta {
 
-// just to simplify syntax
-template<typename T>
-void UCI::log(const T &msg) {
-    std::cout << msg << std::endl;
+TranspositionTable        UCI::tt;
+std::string               UCI::hash_file;
+std::unique_ptr<LazySMP>  UCI::searcher;
+std::unique_ptr<MateSolver> UCI::mate_solver;
+std::unique_ptr<MCTS>       UCI::mcts;
+bool                        UCI::use_mcts = false;
+int                         UCI::threads  = 1;
+std::thread               UCI::search_thread;
+Book                      UCI::book;
+bool                      UCI::own_book = false;
+
+// the templated log function doesn't handle string literals, so we must overload it
+void UCI::log(const char *msg) {
+    Output::write_line(msg);
 }
 
-// the above function doesn't handle string literals, so we must overload it
-void UCI::log(const char *msg) {
-    std::cout << msg << std::endl;
+void UCI::log_progress(const std::string_view msg) {
+    Output::write_progress(msg);
 }
 
 template<typename ... Args>
@@ -31,9 +46,9 @@ void UCI::log_stats(const std::string &name, const uint64_t value, Args... data)
     constexpr std::string_view STATS_HEADER = "---STATS-------------------------------";
     constexpr std::string_view STATS_AFTER  = "---------------------------------------";
 
-    std::cout << STATS_HEADER << std::endl;
+    log(STATS_HEADER);
     log_stats_rec(name, value, data...);
-    std::cout << STATS_AFTER << std::endl;
+    log(STATS_AFTER);
 }
 
 template<typename ... Args>
@@ -41,33 +56,64 @@ void UCI::log_stats_rec(const std::string &name, const uint64_t value, Args... d
     constexpr int DATA_OFFSET = 23;
 
     const int spaces = static_cast<int>(DATA_OFFSET - name.size());
-    std::cout << name << ':' << (spaces
-        ? std::string(spaces, ' ') : "") << format_uint64_t(value) << std::endl;
+    log(std::format("{}:{}{}", name, spaces > 0
+        ? std::string(spaces, ' ') : "", format_uint64_t(value)));
 
     log_stats_rec(data...);
 }
 
 void UCI::loop() {
-    std::string command;
+
+    // both are reused for all commands, so long commands
+    // (e.g. positions with many moves) don't allocate again
+    std::string                   command;
+    std::vector<std::string_view> tokens;
+
     while (std::getline(std::cin, command)) {
+        str_split(command, tokens);
 
-        if (is_str_blank(command))
+        if (tokens.empty())
             continue;
 
         // quit should exit the program immediately
-        if (command == "quit")
-            return;
+        if (tokens[0] == "quit")
+            break;
 
-        handle_command(command);
+        handle_command(tokens);
     }
+
+    // the search thread must be joined before the program exits
+    cmd_stop();
+
+    // so the next session can continue where this one ended
+    if (!hash_file.empty())
+        (void)tt.save(hash_file);
+
+#ifdef KREVETA_TRACE
+    (void)Trace::dump(std::string(Trace::DEFAULT_FILE));
+#endif
 }
 
-void UCI::handle_command(const std::string &command) {
-    const auto tokens = str_split(command);
+void UCI::handle_command(const std::vector<std::string_view> &tokens) {
+    TRACE_ZONE("command");
+
     const auto cmd = tokens.at(0);
 
     if (cmd == "uci") {
         log(std::format("id name {}-{}\nid author {}", ENGINE_NAME, ENGINE_VERSION, ENGINE_AUTHOR));
+
+        // all supported options must be listed before uciok
+        log("option name Hash type spin default 16 min 1 max 65536");
+        log("option name Threads type spin default 1 min 1 max 1024");
+        log("option name SearchMode type combo default AlphaBeta var AlphaBeta var MCTS");
+        log("option name EvalFile type string default <empty>");
+        log("option name OwnBook type check default false");
+        log("option name Book type string default <empty>");
+        log("option name SyzygyPath type string default <empty>");
+        log("option name HashFile type string default <empty>");
+#ifdef KREVETA_TREE_LOG
+        log("option name TreeLog type string default <empty>");
+#endif
         log("uciok");
     }
 
@@ -75,6 +121,18 @@ void UCI::handle_command(const std::string &command) {
         log("readyok");
     }
 
+    else if (cmd == "setoption") {
+        cmd_setoption(tokens);
+    }
+
+    else if (cmd == "ucinewgame") {
+        cmd_stop();
+
+        tt.clear();
+        if (searcher)
+            searcher->clear();
+    }
+
     else if (cmd == "d") {
         Position::board.print();
     }
@@ -87,6 +145,42 @@ void UCI::handle_command(const std::string &command) {
         cmd_go(tokens);
     }
 
+    else if (cmd == "stop") {
+        cmd_stop();
+    }
+
+    else if (cmd == "eval") {
+        cmd_eval();
+    }
+
+    else if (cmd == "evalbench") {
+        NNUE::bench();
+    }
+
+    else if (cmd == "savehash") {
+        cmd_savehash(tokens);
+    }
+
+    else if (cmd == "loadhash") {
+        cmd_loadhash(tokens);
+    }
+
+    else if (cmd == "bench") {
+        cmd_stop();
+        (void)Bench::run(tokens);
+    }
+
+#ifdef KREVETA_TRACE
+    else if (cmd == "trace") {
+        if (tokens.size() < 2 || tokens[1] != "dump") {
+            log("Usage: trace dump [file]");
+            return;
+        }
+
+        (void)Trace::dump(std::string(tokens.size() > 2 ? tokens[2] : Trace::DEFAULT_FILE));
+    }
+#endif
+
 #ifdef DEBUG
     else if (cmd == "test") {
         cmd_test();
@@ -99,6 +193,133 @@ void UCI::handle_command(const std::string &command) {
     }
 }
 
+// the option name and value may both contain spaces, so we join all tokens
+// between "name" and "value", and all tokens after "value" respectively
+void UCI::cmd_setoption(const std::vector<std::string_view> &tokens) {
+    const auto name_it  = std::ranges::find(tokens, "name");
+    const auto value_it = std::ranges::find(tokens, "value");
+
+    if (name_it == tokens.end() || name_it + 1 >= value_it) {
+        log("Missing option name");
+        return;
+    }
+
+    const auto join = [](const auto begin, const auto end) {
+        std::string str;
+        for (auto it = begin; it < end; ++it) {
+            if (!str.empty()) str += ' ';
+            str += *it;
+        }
+        return str;
+    };
+
+    const std::string name  = join(name_it + 1, value_it);
+    const std::string value = value_it != tokens.end()
+        ? join(value_it + 1, tokens.end())
+        : "";
+
+    if (name == "Hash") {
+        int mb;
+        if (!try_parse(value, mb) || mb < 1 || mb > 65536) {
+            log(std::format("Invalid hash size '{}'", value));
+            return;
+        }
+
+        // the table can't be resized while a search is using it
+        cmd_stop();
+        tt.resize(mb);
+
+        if (mcts)
+            mcts->resize(mb);
+
+        // resizing clears the table, so the saved one must be loaded again
+        if (!hash_file.empty())
+            (void)tt.load(hash_file);
+    }
+
+    else if (name == "Threads") {
+        int count;
+        if (!try_parse(value, count) || count < 1 || count > 1024) {
+            log(std::format("Invalid thread count '{}'", value));
+            return;
+        }
+
+        cmd_stop();
+        threads = count;
+
+        if (searcher)
+            searcher->set_threads(count);
+    }
+
+    else if (name == "SearchMode") {
+        if (value != "AlphaBeta" && value != "MCTS") {
+            log(std::format("Invalid search mode '{}'", value));
+            return;
+        }
+
+        cmd_stop();
+        use_mcts = value == "MCTS";
+    }
+
+    else if (name == "EvalFile") {
+
+        // the previous network is unmapped, while the search may still be using it
+        cmd_stop();
+
+        // no file means using the network embedded in the binary
+        if (value.empty() || value == "<empty>") {
+            NNUE::load_default();
+        }
+        else if (NNUE::load(value)) {
+            log(std::format("info string NNUE network loaded from '{}'", value));
+        }
+    }
+
+    else if (name == "OwnBook") {
+        own_book = value == "true";
+    }
+
+    else if (name == "Book") {
+        if (value.empty() || value == "<empty>") {
+            book.close();
+        }
+        else if (book.open(value)) {
+            log(std::format("info string Book loaded from '{}' ({} entries)", value, format_uint64_t(book.size())));
+        }
+    }
+
+    else if (name == "SyzygyPath") {
+
+        // the tables mustn't be unloaded while the search is probing them
+        cmd_stop();
+        Syzygy::init(value);
+
+        if (Syzygy::max_pieces() != 0)
+            log(std::format("info string Found tablebases up to {} pieces", Syzygy::max_pieces()));
+    }
+
+    else if (name == "HashFile") {
+        cmd_stop();
+        hash_file = value == "<empty>" ? "" : value;
+
+        // the file doesn't exist before the first session
+        if (!hash_file.empty() && std::filesystem::exists(hash_file) && tt.load(hash_file))
+            log(std::format("info string Hash loaded from '{}'", hash_file));
+    }
+
+#ifdef KREVETA_TREE_LOG
+    else if (name == "TreeLog") {
+        cmd_stop();
+
+        if (!searcher)
+            searcher = std::make_unique<LazySMP>(tt, threads);
+
+        searcher->set_tree_log(value == "<empty>" ? "" : value);
+    }
+#endif
+
+    else log(std::format("Unknown option '{}'", name));
+}
 
 void UCI::cmd_position(const std::vector<std::string_view> &tokens) {
     if (tokens.size() < 2) {
@@ -117,22 +338,195 @@ void UCI::cmd_position(const std::vector<std::string_view> &tokens) {
     else log(std::format("Invalid argument '{}'", tokens[1]));
 }
 
+SearchLimits UCI::parse_limits(const std::vector<std::string_view> &tokens) {
+    SearchLimits limits;
+
+    for (std::size_t i = 1; i < tokens.size(); i++) {
+        const auto &token = tokens[i];
+
+        if (token == "infinite") {
+            limits.infinite = true;
+            continue;
+        }
+
+        // all other arguments are followed by a number
+        int value;
+        if (i + 1 >= tokens.size() || !try_parse(tokens[i + 1], value)) {
+            log(std::format("Invalid argument '{}'", token));
+            continue;
+        }
+
+        i++;
+
+        if      (token == "depth")     limits.depth           = std::max(value, 1);
+        else if (token == "nodes")     limits.nodes           = std::max(value, 0);
+        else if (token == "movetime")  limits.movetime        = std::max(value, 1);
+        else if (token == "wtime")     limits.time[COL_WHITE] = std::max(value, 1);
+        else if (token == "btime")     limits.time[COL_BLACK] = std::max(value, 1);
+        else if (token == "winc")      limits.inc[COL_WHITE]  = std::max(value, 0);
+        else if (token == "binc")      limits.inc[COL_BLACK]  = std::max(value, 0);
+        else if (token == "movestogo") limits.movestogo       = std::max(value, 0);
+        else if (token == "mate")      limits.mate            = std::max(value, 1);
+        else log(std::format("Invalid argument '{}'", token));
+    }
+
+    return limits;
+}
+
 void UCI::cmd_go(const std::vector<std::string_view> &tokens) {
 
-    Move moves[128];
-    const int count = Movegen::get_legal_moves(Position::board, moves);
+    // a new search can't start before the previous one is finished
+    cmd_stop();
+
+    const SearchLimits limits = parse_limits(tokens);
+
+    // the book is only used in games, analysis should always search
+    if (own_book && !limits.infinite && !limits.mate) {
+        Move move;
+        if (book.probe(Position::board, move)) {
+            log(std::format("bestmove {}", Move::to_str(move)));
+            return;
+        }
+    }
+
+    if (limits.mate) {
+        if (!mate_solver)
+            mate_solver = std::make_unique<MateSolver>();
+
+        mate_solver->reset_stop();
+
+        search_thread = std::thread([board = Position::board, history = Position::history, limits] {
+            const MateResult result = mate_solver->solve(board, history, limits.mate, limits);
+
+            // even without a mate we must answer with some move
+            Move moves[MAX_MOVES];
+            const Move best = result.found && !result.pv.empty() ? result.pv[0]
+                : Movegen::get_legal_moves(board, moves) ? moves[0] : Move();
+
+            log(std::format("bestmove {}", Move::to_str(best)));
+        });
+
+        return;
+    }
+
+    // the tree uses as much memory as the transposition table
+    if (use_mcts) {
+        if (!mcts)
+            mcts = std::make_unique<MCTS>(tt.size_mb());
+
+        mcts->reset_stop();
 
-    const int the_chosen_one = rand_int(0, count);
-    Move m = moves[the_chosen_one];
+        search_thread = std::thread([board = Position::board, history = Position::history, limits] {
+            const SearchResult result = mcts->search(board, history, limits, threads);
+            log(std::format("bestmove {}", Move::to_str(result.best)));
+        });
 
-    log(std::format("bestmove {}", Move::to_str(m)));
+        return;
+    }
+
+    if (!searcher)
+        searcher = std::make_unique<LazySMP>(tt, threads);
+
+    searcher->reset_stop();
+
+    // the position may be changed during the search, so we pass copies
+    search_thread = std::thread([board = Position::board, history = Position::history, limits] {
+        const SearchResult result = searcher->search(board, history, limits);
+
+#ifdef KREVETA_STATS
+        log_search_stats(searcher->stats());
+#endif
+
+        log(std::format("bestmove {}", Move::to_str(result.best)));
+    });
 }
 
+void UCI::cmd_stop() {
+    if (!search_thread.joinable())
+        return;
+
+    if (searcher)    searcher->stop();
+    if (mate_solver) mate_solver->stop();
+    if (mcts)        mcts->stop();
+
+    search_thread.join();
+}
+
+void UCI::cmd_eval() {
+    const int score = NNUE::evaluate(Position::board);
+
+    // the evaluation is relative to the side to move, but people
+    // reading this would usually expect the white's point of view
+    log(std::format("NNUE evaluation: {} cp (white side)", Position::board.color == COL_WHITE
+        ? score : -score));
+}
+
+// savehash <file> [min depth]. leaving out the shallow entries makes the file
+// smaller, and they are quickly searched again anyway
+void UCI::cmd_savehash(const std::vector<std::string_view> &tokens) {
+    int min_depth = 0;
+
+    if (tokens.size() < 2 || (tokens.size() > 2 && (!try_parse(tokens[2], min_depth) || min_depth < 0))) {
+        log("Usage: savehash <file> [min depth]");
+        return;
+    }
+
+    // the table mustn't change while it's being written
+    cmd_stop();
+
+    if (tt.save(std::string(tokens[1]), min_depth))
+        log(std::format("info string Hash saved to '{}'", tokens[1]));
+}
+
+void UCI::cmd_loadhash(const std::vector<std::string_view> &tokens) {
+    if (tokens.size() < 2) {
+        log("Usage: loadhash <file>");
+        return;
+    }
+
+    cmd_stop();
+
+    if (tt.load(std::string(tokens[1])))
+        log(std::format("info string Hash loaded from '{}'", tokens[1]));
+}
+
+#ifdef KREVETA_STATS
+void UCI::log_search_stats(const SearchStats &stats) {
+    const auto &c = stats.counters;
+
+    // rates are printed in percent
+    const auto percent = [](const uint64_t part, const uint64_t total) {
+        return total ? part * 100 / total : 0;
+    };
+
+    log_stats(
+        "movegen calls",        c[STAT_MOVEGEN_CALLS],
+        "moves per movegen",    c[STAT_MOVES_GENERATED] / std::max<uint64_t>(c[STAT_MOVEGEN_CALLS], 1),
+        "nodes",                c[STAT_NODES],
+        "qnodes",               c[STAT_QNODES],
+        "hash probes",          c[STAT_TT_PROBES],
+        "hash hits (%)",        percent(c[STAT_TT_HITS],        c[STAT_TT_PROBES]),
+        "beta cutoffs",         c[STAT_BETA_CUTOFFS],
+        "cutoffs move 1 (%)",   percent(stats.cutoffs[0],       c[STAT_BETA_CUTOFFS]),
+        "cutoffs move 2 (%)",   percent(stats.cutoffs[1],       c[STAT_BETA_CUTOFFS]),
+        "cutoffs move 3 (%)",   percent(stats.cutoffs[2],       c[STAT_BETA_CUTOFFS]),
+        "cutoffs move 4 (%)",   percent(stats.cutoffs[3],       c[STAT_BETA_CUTOFFS]),
+        "cutoffs move 5 (%)",   percent(stats.cutoffs[4],       c[STAT_BETA_CUTOFFS]),
+        "cutoffs move 6 (%)",   percent(stats.cutoffs[5],       c[STAT_BETA_CUTOFFS]),
+        "cutoffs move 7 (%)",   percent(stats.cutoffs[6],       c[STAT_BETA_CUTOFFS]),
+        "cutoffs move 8+ (%)",  percent(stats.cutoffs[7],       c[STAT_BETA_CUTOFFS]),
+        "null move tries",      c[STAT_NULL_TRIES],
+        "null move cutoffs (%)", percent(c[STAT_NULL_CUTOFFS],  c[STAT_NULL_TRIES]),
+        "lmr searches",         c[STAT_LMR_SEARCHES],
+        "lmr re-searches (%)",  percent(c[STAT_LMR_RESEARCHES], c[STAT_LMR_SEARCHES]));
+}
+#endif
+
 #ifdef DEBUG
 void UCI::cmd_test() {
     log("Hello, World!");
 
-    Move moves[128];
+    Move moves[MAX_MOVES];
     int count = Movegen::get_legal_moves(Position::board, moves);
 
     log(std::format("pseudolegal moves: {}", count));
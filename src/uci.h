@@ -6,10 +6,21 @@
 #define UCI_H
 
 #include <cstdint>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "book/book.h"
+#include "io/output.h"
+#include "search/mate_solver.h"
+#include "search/mcts.h"
+#include "search/search.h"
+#include "search/smp.h"
+#include "search/tt.h"
+
 namespace Kreveta {
 
 class UCI {
@@ -23,23 +34,59 @@ public:
     static void log(const T &msg);
     static void log(const char *msg);
 
+    // lines only reporting the progress of the search, which may be replaced by newer ones
+    static void log_progress(std::string_view msg);
+
     template<typename ... Args>
     static void log_stats(const std::string &name, uint64_t value, Args... data);
 
     static void loop();
 
+    // the arguments of "go"
+    [[nodiscard]] static SearchLimits parse_limits(const std::vector<std::string_view> &tokens);
+
 private:
 
+    static TranspositionTable       tt;
+
+    // the table is loaded from this file when it's set, and saved into it on exit
+    static std::string              hash_file;
+    static std::unique_ptr<LazySMP> searcher;
+
+    // proof-number search for "go mate", created on first use
+    static std::unique_ptr<MateSolver> mate_solver;
+
+    // the experimental tree search is only used when selected by SearchMode
+    static std::unique_ptr<MCTS> mcts;
+    static bool                  use_mcts;
+    static int                   threads;
+
+    // the book is only probed when OwnBook is enabled
+    static Book book;
+    static bool own_book;
+
+    // the search runs in its own thread, so we can still receive "stop"
+    static std::thread search_thread;
+
     // just to handle the empty case
     static void log_stats_rec(){}
 
     template<typename ... Args>
     static void log_stats_rec(const std::string &name, uint64_t value, Args... data);
 
-    static void handle_command(const std::string &command);
+    static void handle_command(const std::vector<std::string_view> &tokens);
 
+    static void cmd_setoption(const std::vector<std::string_view> &tokens);
     inline static void cmd_position(const std::vector<std::string_view> &tokens);
     static void cmd_go(const std::vector<std::string_view> &tokens);
+    static void cmd_stop();
+    static void cmd_eval();
+    static void cmd_savehash(const std::vector<std::string_view> &tokens);
+    static void cmd_loadhash(const std::vector<std::string_view> &tokens);
+
+#ifdef KREVETA_STATS
+    static void log_search_stats(const SearchStats &stats);
+#endif
 
 #ifdef DEBUG
     static void cmd_test();
@@ -47,6 +94,20 @@ private:
 
 };
 
+// just to simplify syntax. this has to be defined in the header,
+// since it gets instantiated with different types everywhere
+template<typename T>
+void UCI::log(const T &msg) {
+    if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        Output::write_line(msg);
+    }
+    else {
+        std::ostringstream os;
+        os << msg;
+        Output::write_line(os.str());
+    }
+}
+
 }
 
 #endif //UCI_H
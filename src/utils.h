@@ -5,10 +5,12 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <charconv>
 #include <iomanip>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <ranges>
+#include <string_view>
 #include <random>
 
 namespace Kreveta {
@@ -19,10 +21,13 @@ struct comma_numpunct final : std::numpunct<char> {
     std::string do_grouping() const override { return "\3"; }
 };
 
-// convert a number to string with pretty number separators
+// convert a number to string with pretty number separators. creating the
+// locale is slow, so all calls share a single one
 inline std::string format_uint64_t(const uint64_t n) {
+    static const std::locale locale(std::locale(), new comma_numpunct);
+
     std::ostringstream os;
-    os.imbue(std::locale(std::locale(), new comma_numpunct));
+    os.imbue(locale);
     os << n;
     return os.str();
 }
@@ -33,32 +38,28 @@ constexpr bool is_str_blank(const std::string_view &str) noexcept {
         || str.find_first_not_of(" \n\t\r") == std::string_view::npos;
 }
 
-// split a string into tokens using a space as the delimeter
-inline std::vector<std::string_view> str_split(const std::string& str) {
-    std::vector<std::string_view> tokens {};
+// split a string into tokens using a space as the delimeter. the vector is cleared
+// first, so when it's reused, nothing is allocated once it has grown large enough
+inline void str_split(const std::string_view str, std::vector<std::string_view> &tokens) {
+    tokens.clear();
 
-    // ReSharper disable once CppLocalVariableMayBeConst
-    auto split = str
-        | std::ranges::views::split(' ')
-        | std::ranges::views::transform([](auto range) {
-
-        // we have to check the size of the range to prevent errors with
-        // whitespaces. when there is a whitespace at the start or end or
-        // a doubled one in the middle, we just return an empty string
-        const auto dist = std::ranges::distance(range);
-
-        // here we convert the range into a string view
-        return dist
-            ? std::string_view(&*range.begin(), dist)
-            : std::string_view();
-        });
-
-    // since we may have added empty strings, we now have to look out for them
-    for (const auto &token : split) {
-        if (!is_str_blank(token)) {
+    std::size_t begin = 0;
+    while (begin < str.size()) {
+        std::size_t end = str.find(' ', begin);
+        if (end == std::string_view::npos)
+            end = str.size();
+
+        // doubled spaces and whitespace-only tokens (e.g. a trailing '\r') are skipped
+        if (const auto token = str.substr(begin, end - begin); !is_str_blank(token))
             tokens.push_back(token);
-        }
+
+        begin = end + 1;
     }
+}
+
+inline std::vector<std::string_view> str_split(const std::string& str) {
+    std::vector<std::string_view> tokens {};
+    str_split(str, tokens);
     return tokens;
 }
 
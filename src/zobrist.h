@@ -0,0 +1,52 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+namespace Kreveta {
+
+// random keys used for hashing positions. a position's key is the xor of the keys
+// of all its pieces, castling rights, en passant file and side to move, so it can
+// be updated incrementally by xoring only the keys of the things that changed
+struct ZobristKeys {
+    uint64_t pieces[2][6][64];
+    uint64_t castling[16];
+    uint64_t en_passant[8];
+    uint64_t side;
+};
+
+// the keys are generated at compile time, which makes them the same in every
+// build and lets the starting position have its key computed at compile time
+constexpr ZobristKeys generate_zobrist_keys() {
+    ZobristKeys keys{};
+
+    // splitmix64
+    uint64_t state = 0x4B52455645544132ULL;
+    const auto next = [&] {
+        uint64_t z = state += 0x9E3779B97F4A7C15ULL;
+        z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ z >> 27) * 0x94D049BB133111EBULL;
+        return z ^ z >> 31;
+    };
+
+    for (auto &col : keys.pieces)
+        for (auto &pt : col)
+            for (auto &sq : pt)
+                sq = next();
+
+    // no castling rights must not change the key
+    for (int i = 1; i < 16; i++)
+        keys.castling[i] = next();
+
+    for (auto &file : keys.en_passant)
+        file = next();
+
+    keys.side = next();
+    return keys;
+}
+
+inline constexpr ZobristKeys ZOBRIST = generate_zobrist_keys();
+
+}
+
+#endif //ZOBRIST_H
@@ -0,0 +1,291 @@
+#ifndef _WIN32
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/daemon/daemon.h"
+#include "src/movegen/movegen.h"
+
+using namespace Kreveta;
+
+namespace {
+
+// a single connection to the daemon, reading whole lines
+class Client {
+public:
+    explicit Client(const std::string &path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::ranges::copy(path, address.sun_path);
+
+        // the daemon is started by another thread, so it may not be listening yet
+        for (int i = 0; i < 500 && fd < 0; i++) {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+            if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+                close(fd);
+                fd = -1;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    ~Client() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    [[nodiscard]] bool connected() const { return fd >= 0; }
+
+    void send(const std::string &line) const {
+        const std::string data = line + '\n';
+        (void)!write(fd, data.data(), data.size());
+    }
+
+    // returns the first line starting with the prefix, or an empty string when
+    // the connection was closed or the line didn't arrive in time
+    std::string read_until(const std::string &prefix, const std::chrono::milliseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (true) {
+            std::size_t newline;
+            while ((newline = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+
+                if (line.starts_with(prefix))
+                    return line;
+            }
+
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+
+            pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+            if (left <= 0 || poll(&pfd, 1, static_cast<int>(left)) <= 0)
+                return {};
+
+            char buffer[4096];
+            const ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count <= 0)
+                return {};
+
+            pending.append(buffer, static_cast<std::size_t>(count));
+        }
+    }
+
+    // whether the daemon closed the connection, the lines written before are skipped
+    bool closed(const std::chrono::milliseconds timeout) const {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (true) {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+
+            pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+            if (left <= 0 || poll(&pfd, 1, static_cast<int>(left)) <= 0)
+                return false;
+
+            char buffer[4096];
+            const ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count <= 0)
+                return count == 0;
+        }
+    }
+
+private:
+    int         fd = -1;
+    std::string pending;
+};
+
+// the move of the bestmove line must be legal in the position searched by the same session
+bool is_legal_bestmove(const std::string &line, const std::string &fen) {
+    if (!line.starts_with("bestmove "))
+        return false;
+
+    const Board board = board_from_fen(fen);
+    const auto tokens = str_split(line);
+
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    for (int i = 0; i < count; i++)
+        if (Move::to_str(moves[i]) == tokens[1])
+            return true;
+
+    return false;
+}
+
+// runs the daemon in another thread, which is stopped even when a test fails
+class RunningDaemon {
+public:
+    explicit RunningDaemon(const DaemonSettings &settings)
+        : thread([this, settings] { result = Daemon::run(settings); }) {}
+
+    ~RunningDaemon() { stop(); }
+
+    // returns the result of Daemon::run
+    bool stop() {
+        if (thread.joinable()) {
+            Daemon::stop();
+            thread.join();
+        }
+
+        return result;
+    }
+
+private:
+    bool        result = false;
+    std::thread thread;
+};
+
+std::string socket_path(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+}
+
+TEST_CASE("daemon serves concurrent sessions", "[daemon]") {
+    const DaemonSettings settings {
+        .socket  = socket_path("kreveta_daemon_test.sock"),
+        .threads = 2,
+        .hash    = 16
+    };
+
+    RunningDaemon daemon(settings);
+
+    // black to move after 1. e4, and a position with a single legal move
+    const std::string first_fen  = "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1";
+    const std::string second_fen = "k7/8/8/8/8/8/1q6/K7 w - - 0 1";
+
+    {
+        Client first(settings.socket);
+        Client second(settings.socket);
+
+        REQUIRE(first.connected());
+        REQUIRE(second.connected());
+
+        first.send("position fen " + first_fen);
+        second.send("position fen " + second_fen);
+
+        first.send("go depth 6");
+        second.send("go depth 6");
+
+        const std::string first_best  = first.read_until("bestmove", std::chrono::seconds(30));
+        const std::string second_best = second.read_until("bestmove", std::chrono::seconds(30));
+
+        REQUIRE(is_legal_bestmove(first_best, first_fen));
+        REQUIRE(second_best == "bestmove a1b2");
+
+        // the session keeps working after its search
+        first.send("isready");
+        REQUIRE(first.read_until("readyok", std::chrono::seconds(5)) == "readyok");
+    }
+
+    REQUIRE(daemon.stop());
+    REQUIRE_FALSE(std::filesystem::exists(settings.socket));
+}
+
+TEST_CASE("daemon stops queued searches", "[daemon]") {
+    const DaemonSettings settings {
+        .socket  = socket_path("kreveta_daemon_queue_test.sock"),
+        .threads = 1,
+        .hash    = 16
+    };
+
+    RunningDaemon daemon(settings);
+
+    const std::string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    Client running(settings.socket);
+    Client queued(settings.socket);
+    Client waiting(settings.socket);
+
+    REQUIRE(running.connected());
+    REQUIRE(queued.connected());
+    REQUIRE(waiting.connected());
+
+    // the only search thread is kept busy by the first session
+    running.send("go infinite");
+    running.send("isready");
+    REQUIRE(running.read_until("readyok", std::chrono::seconds(5)) == "readyok");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // a queued search is answered right away when stopped
+    queued.send("position fen " + fen);
+    queued.send("go infinite");
+    queued.send("stop");
+
+    const std::string best = queued.read_until("bestmove", std::chrono::seconds(2));
+    REQUIRE(is_legal_bestmove(best, fen));
+
+    // stopping the daemon closes both the running and the queued session
+    waiting.send("go infinite");
+    waiting.send("isready");
+    REQUIRE(waiting.read_until("readyok", std::chrono::seconds(5)) == "readyok");
+
+    REQUIRE(daemon.stop());
+
+    REQUIRE(running.closed(std::chrono::seconds(2)));
+    REQUIRE(waiting.closed(std::chrono::seconds(2)));
+}
+
+TEST_CASE("daemon restarts searches answered by the table", "[daemon]") {
+    const DaemonSettings settings {
+        .socket  = socket_path("kreveta_daemon_expired_test.sock"),
+        .threads = 1,
+        .hash    = 16
+    };
+
+    RunningDaemon daemon(settings);
+
+    const std::string fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    Client running(settings.socket);
+    Client queued(settings.socket);
+
+    REQUIRE(running.connected());
+    REQUIRE(queued.connected());
+
+    running.send("go infinite");
+    running.send("isready");
+    REQUIRE(running.read_until("readyok", std::chrono::seconds(5)) == "readyok");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // the second go takes the first one out of the queue
+    queued.send("position fen " + fen);
+    queued.send("go movetime 1");
+    queued.send("go movetime 1");
+
+    REQUIRE(is_legal_bestmove(queued.read_until("bestmove", std::chrono::seconds(2)), fen));
+
+    // the remaining search runs out of time in the queue, so once the thread is free,
+    // it's answered by the table. the next go arrives while the thread is still answering
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    running.send("stop");
+
+    const std::string expired = queued.read_until("bestmove", std::chrono::seconds(5));
+    queued.send("go movetime 1");
+
+    REQUIRE(is_legal_bestmove(expired, fen));
+    REQUIRE(is_legal_bestmove(queued.read_until("bestmove", std::chrono::seconds(5)), fen));
+    REQUIRE(is_legal_bestmove(running.read_until("bestmove", std::chrono::seconds(5)), fen));
+
+    queued.send("isready");
+    REQUIRE(queued.read_until("readyok", std::chrono::seconds(5)) == "readyok");
+
+    REQUIRE(daemon.stop());
+}
+
+#endif
@@ -0,0 +1,15 @@
+#!/bin/sh
+# downloads the official syzygy tables used by the tablebase tests
+# into tests/data/syzygy. the files are not kept in the repository
+set -e
+
+dir="$(dirname "$0")/syzygy"
+url="https://tablebase.lichess.ovh/tables/standard/3-4-5"
+
+mkdir -p "$dir"
+
+for table in KQvK KRvK KBvK KNvK KPvK KPvKP; do
+    for ext in rtbw rtbz; do
+        [ -f "$dir/$table.$ext" ] || curl -fsSL -o "$dir/$table.$ext" "$url/$table.$ext"
+    done
+done
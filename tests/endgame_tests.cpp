@@ -0,0 +1,108 @@
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/eval/endgame.h"
+#include "src/eval/nnue.h"
+#include "src/threads/thread_pool.h"
+
+using namespace Kreveta;
+
+static const EndgameEntry *probe(const std::string &fen) {
+    return Endgames::probe(board_from_fen(fen));
+}
+
+TEST_CASE("endgame lookup") {
+    const auto *krk = probe("8/8/8/4k3/8/8/8/R3K3 w - - 0 1");
+    REQUIRE(krk != nullptr);
+    REQUIRE(krk->eval != nullptr);
+    REQUIRE(krk->strong == COL_WHITE);
+
+    const auto *kbnk = probe("8/8/8/4k3/8/8/8/4K1nb b - - 0 1");
+    REQUIRE(kbnk != nullptr);
+    REQUIRE(kbnk->strong == COL_BLACK);
+
+    const auto *bishops = probe("8/2p5/8/2b1k3/8/3B4/5PP1/4K3 w - - 0 1");
+    REQUIRE(bishops != nullptr);
+    REQUIRE(bishops->scale != nullptr);
+    REQUIRE(bishops->strong == COL_WHITE);
+
+    // there is nothing special about the middlegame
+    REQUIRE(probe("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") == nullptr);
+}
+
+// the score (or scale factor) of the endgame from the point of view of the stronger side
+static int endgame_eval(const std::string &fen) {
+    const auto *entry = probe(fen);
+    REQUIRE(entry != nullptr);
+    REQUIRE(entry->eval != nullptr);
+
+    return entry->eval(board_from_fen(fen), entry->strong);
+}
+
+static int endgame_scale(const std::string &fen) {
+    const auto *entry = probe(fen);
+    REQUIRE(entry != nullptr);
+    REQUIRE(entry->scale != nullptr);
+
+    return entry->scale(board_from_fen(fen), entry->strong);
+}
+
+TEST_CASE("endgame evaluation") {
+
+    // the lone king is better off in the center, with the same distance between the kings
+    const int krk_corner = endgame_eval("k7/2K5/8/8/8/8/8/7R w - - 0 1");
+    const int krk_center = endgame_eval("8/8/8/3k4/8/3K4/8/7R w - - 0 1");
+
+    REQUIRE(krk_center >= ENDGAME_WIN);
+    REQUIRE(krk_corner >  krk_center);
+
+    // with a light-squared bishop, the king must be driven towards h1 (or a8), not a1
+    REQUIRE(endgame_eval("8/8/8/8/4K3/2N5/6k1/5B2 w - - 0 1")
+          > endgame_eval("8/8/8/8/3K4/2N5/1k6/5B2 w - - 0 1"));
+
+    // the stronger side is black here, and the score is still positive
+    REQUIRE(endgame_eval("8/8/8/8/8/8/1K6/5q1k b - - 0 1") > 0);
+
+    REQUIRE(endgame_eval("8/8/8/4k3/8/8/8/2N1KN2 w - - 0 1") == 0);
+}
+
+TEST_CASE("endgame scale factors") {
+
+    // the dark-squared bishop doesn't control a8, which the defending king has reached
+    REQUIRE(endgame_scale("k7/8/8/8/8/P7/8/2B1K3 w - - 0 1") == SCALE_DRAW);
+    REQUIRE(endgame_scale("k7/8/8/8/8/P7/8/3BK3 w - - 0 1") == SCALE_NORMAL);
+    REQUIRE(endgame_scale("8/8/8/8/8/P7/8/k1B1K3 w - - 0 1") == SCALE_NORMAL);
+
+    // opposite bishops shrink the evaluation, bishops of the same color don't
+    const int opposite = endgame_scale("8/2p5/8/2b1k3/8/3B4/5PP1/4K3 w - - 0 1");
+    REQUIRE(opposite > SCALE_DRAW);
+    REQUIRE(opposite < SCALE_NORMAL);
+
+    REQUIRE(endgame_scale("8/2p5/8/4k3/2b5/3B4/5PP1/4K3 w - - 0 1") == SCALE_NORMAL);
+
+    // there is no special knowledge about rook against rook and bishop
+    REQUIRE(probe("8/8/8/4k3/2b5/8/r7/R3K3 w - - 0 1") == nullptr);
+}
+
+TEST_CASE("batch evaluation applies the endgame knowledge") {
+    const std::string fens[] = {
+        "8/8/8/4k3/8/8/8/R3K3 w - - 0 1",
+        "8/8/8/8/4K3/2N5/6k1/5B2 b - - 0 1",
+        "8/2p5/8/2b1k3/8/3B4/5PP1/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+    };
+
+    std::vector<Board> boards;
+    for (const auto &fen : fens) {
+        boards.push_back(board_from_fen(std::string(fen)));
+    }
+
+    std::vector<int16_t> scores(boards.size());
+    ThreadPool pool(1);
+    NNUE::evaluate_batch(boards.data(), boards.size(), scores.data(), pool);
+
+    for (std::size_t i = 0; i < boards.size(); i++)
+        REQUIRE(scores[i] == NNUE::evaluate(boards[i]));
+}
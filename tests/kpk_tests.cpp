@@ -0,0 +1,41 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/eval/kpk.h"
+
+using namespace Kreveta;
+
+static int kpk_eval(const std::string &fen) {
+    const Board board = board_from_fen(fen);
+    REQUIRE(KPK::is_kpk(board));
+
+    return KPK::evaluate(board);
+}
+
+TEST_CASE("kpk wins") {
+
+    // king on the sixth rank in front of the pawn wins with either side to move
+    REQUIRE(kpk_eval("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1") > 0);
+    REQUIRE(kpk_eval("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1") < 0);
+
+    // the pawn can't be caught
+    REQUIRE(kpk_eval("k7/7P/8/8/8/8/8/K7 w - - 0 1") > 0);
+
+    // the same with colors reversed
+    REQUIRE(kpk_eval("8/8/8/8/4p3/4k3/8/4K3 b - - 0 1") > 0);
+}
+
+TEST_CASE("kpk draws") {
+
+    // stalemate
+    REQUIRE(kpk_eval("3k4/3P4/3K4/8/8/8/8/8 b - - 0 1") == 0);
+
+    // the rook pawn can't be promoted with the king in the corner
+    REQUIRE(kpk_eval("k7/8/8/8/8/8/P7/1K6 w - - 0 1") == 0);
+
+    // the pawn is lost
+    REQUIRE(kpk_eval("8/8/8/8/3kP3/8/8/K7 b - - 0 1") == 0);
+
+    // the defending king has the opposition in front of the pawn
+    REQUIRE(kpk_eval("8/8/8/4k3/8/4K3/4P3/8 w - - 0 1") == 0);
+}
@@ -2,7 +2,30 @@
 // Created by michn on 5/11/2025.
 //
 
-#define CATCH_CONFIG_MAIN
+#include <catch2/reporters/catch_reporter_event_listener.hpp>
+#include <catch2/reporters/catch_reporter_registrars.hpp>
 
-#include <catch2/catch_test_macros.hpp>
+#include "src/eval/endgame.h"
+#include "src/eval/kpk.h"
+#include "src/eval/nnue.h"
+#include "src/movegen/movetables.h"
 
+// the tables are initialized once before any test runs, in the same order as in main
+class TablesListener : public Catch::EventListenerBase {
+public:
+    using EventListenerBase::EventListenerBase;
+
+    void testRunStarting(const Catch::TestRunInfo &) override {
+        using namespace Kreveta;
+
+        MoveTables::init();
+
+        // the bitbase is generated using the move tables
+        KPK::init();
+        Endgames::init();
+
+        NNUE::init();
+    }
+};
+
+CATCH_REGISTER_LISTENER(TablesListener)
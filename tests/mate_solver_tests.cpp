@@ -0,0 +1,64 @@
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/movegen/movegen.h"
+#include "src/search/mate_solver.h"
+
+using namespace Kreveta;
+
+static MateResult solve(const std::string &fen, const int max_moves) {
+    MateSolver solver;
+    solver.silent = true;
+
+    return solver.solve(board_from_fen(fen), {}, max_moves, SearchLimits{});
+}
+
+// the pv must be a legal line of the full length, which ends in checkmate
+static void require_mating_pv(const std::string &fen, const MateResult &result) {
+    REQUIRE(result.pv.size() == static_cast<std::size_t>(result.moves * 2 - 1));
+
+    Board board = board_from_fen(fen);
+    for (const Move move : result.pv) {
+        REQUIRE(board.is_move_legal(move, board.color));
+        board.play_move(move);
+    }
+
+    Move moves[MAX_MOVES];
+    REQUIRE(Movegen::get_legal_moves(board, moves) == 0);
+    REQUIRE(Movegen::is_in_check(board, board.color));
+}
+
+TEST_CASE("mate in two", "[mate]") {
+    for (const std::string fen : {
+        "r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 1",
+        "r1b2k1r/ppp1bppp/8/1B1Q4/5q2/2P5/PPP2PPP/R3R1K1 w - - 1 1" }) {
+
+        const MateResult result = solve(fen, 5);
+
+        REQUIRE(result.found);
+        REQUIRE(result.moves == 2);
+        require_mating_pv(fen, result);
+    }
+}
+
+TEST_CASE("mate in three", "[mate]") {
+
+    // the smothered mate, where the king escaping to f8 would be mated a move sooner
+    const std::string fen = "r5k1/5Npp/8/8/2Q5/8/6PP/6K1 w - - 0 1";
+    const MateResult result = solve(fen, 5);
+
+    REQUIRE(result.found);
+    REQUIRE(result.moves == 3);
+    require_mating_pv(fen, result);
+}
+
+TEST_CASE("mate longer than the limit", "[mate]") {
+    const MateResult result = solve("r5k1/5Npp/8/8/2Q5/8/6PP/6K1 w - - 0 1", 2);
+
+    REQUIRE_FALSE(result.found);
+    REQUIRE(result.pv.empty());
+    REQUIRE(result.nodes > 0);
+}
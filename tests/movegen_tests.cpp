@@ -0,0 +1,40 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/global/consts.h"
+#include "src/movegen/movegen.h"
+
+using namespace Kreveta;
+
+// the checks found without playing the moves must be the same as after playing them
+static void require_same_checks(const std::string &fen) {
+    const Board board = board_from_fen(fen);
+
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    int expected = 0;
+    for (int i = 0; i < count; i++) {
+        Board child = board.clone();
+        child.play_move(moves[i]);
+
+        const bool check = Movegen::is_in_check(child, child.color);
+        REQUIRE(Movegen::gives_check(board, moves[i]) == check);
+
+        expected += check;
+    }
+
+    Move checks[MAX_MOVES];
+    REQUIRE(Movegen::get_legal_checks(board, checks) == expected);
+}
+
+TEST_CASE("checking moves") {
+    for (const auto fen : BENCH_FENS)
+        require_same_checks(std::string(fen));
+
+    // discovered checks, promotions, en passant and castling
+    require_same_checks("4k3/8/8/8/4N3/8/8/4R1K1 w - - 0 1");
+    require_same_checks("3k4/1P6/8/8/8/8/8/6K1 w - - 0 1");
+    require_same_checks("8/8/8/1k1pP3/8/8/8/4K2Q w - d6 0 1");
+    require_same_checks("5k2/8/8/8/8/8/8/4K2R w K - 0 1");
+}
@@ -0,0 +1,234 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/global/consts.h"
+#include "src/eval/nnue.h"
+#include "src/movegen/movegen.h"
+#include "src/threads/thread_pool.h"
+
+using namespace Kreveta;
+
+namespace {
+
+// loads a network with random parameters and switches back to the default one when
+// the test ends. unlike the bootstrap network, which only looks at the pieces from
+// one perspective, every feature here changes every neuron of both perspectives
+class RandomNetwork {
+public:
+    RandomNetwork() {
+        const auto network = std::make_unique<Network>();
+        std::mt19937 rng(0x4B52);
+
+        // the accumulators can end up both below zero and above QA, so the clipping is tested too
+        std::uniform_int_distribution<int> ft(-64, 64);
+        std::uniform_int_distribution<int> out(-128, 127);
+
+        for (int16_t &w : network->ft_weights)  w = static_cast<int16_t>(ft(rng));
+        for (int16_t &b : network->ft_biases)   b = static_cast<int16_t>(ft(rng));
+        for (int8_t  &w : network->out_weights) w = static_cast<int8_t>(out(rng));
+        network->out_bias = 1234;
+
+        // the mapping stays valid after the file is removed
+        const std::string path = (std::filesystem::temp_directory_path() / "kreveta_nnue_test.nnue").string();
+        REQUIRE(NNUE::save(path, *network));
+        REQUIRE(NNUE::load(path));
+        std::filesystem::remove(path);
+    }
+
+    ~RandomNetwork() {
+        NNUE::set_kernel(NNUE::best_kernel());
+        NNUE::load_default();
+    }
+};
+
+std::vector<NNUEKernel> supported_kernels() {
+    std::vector<NNUEKernel> kernels;
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (NNUE::is_kernel_supported(static_cast<NNUEKernel>(k)))
+            kernels.push_back(static_cast<NNUEKernel>(k));
+    }
+
+    return kernels;
+}
+
+// the accumulator of the stack must be the same as after a full refresh of a fresh stack
+void require_refreshed(AccumulatorStack &stack, AccumulatorStack &fresh, const Board &board) {
+    fresh.reset(board);
+
+    REQUIRE(std::memcmp(stack.current(board).values, fresh.current(board).values, sizeof(Accumulator::values)) == 0);
+    REQUIRE(stack.evaluate(board) == NNUE::evaluate(board));
+}
+
+// play the moves one by one, checking the accumulator after each of them
+void play_and_check(AccumulatorStack &stack, AccumulatorStack &fresh, const std::string &fen, const std::vector<std::string> &moves) {
+    Board board = board_from_fen(fen);
+    stack.reset(board);
+
+    for (const std::string &str : moves) {
+        const Move move = Move::str_to_move(str, board);
+        REQUIRE(board.is_move_legal(move, board.color));
+
+        DirtyPieces dirty;
+        board.play_move(move, dirty);
+        stack.push(board, dirty);
+
+        require_refreshed(stack, fresh, board);
+    }
+}
+
+}
+
+TEST_CASE("lazy accumulator updates match a full refresh", "[nnue]") {
+    const RandomNetwork network;
+
+    const auto stack = std::make_unique<AccumulatorStack>();
+    const auto fresh = std::make_unique<AccumulatorStack>();
+
+    for (const NNUEKernel kernel : supported_kernels()) {
+        NNUE::set_kernel(kernel);
+
+        // castling on both sides, where the black king also crosses into another bucket
+        play_and_check(*stack, *fresh, "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", { "e1g1", "e8c8", "g1g2", "c8b8" });
+
+        // en passant, and both a capturing and a quiet promotion
+        play_and_check(*stack, *fresh, "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", { "e5d6", "e8f7", "d6d7", "f7e7" });
+        play_and_check(*stack, *fresh, "1n2k3/P6P/8/8/8/8/8/4K3 w - - 0 1", { "a7b8q", "e8f7", "h7h8n" });
+
+        // the king walks through buckets and returns into the ones it has already
+        // visited, where the refresh starts from the cached accumulator
+        play_and_check(*stack, *fresh, "4k3/8/8/8/8/8/PPPPPPPP/4K3 w - - 0 1",
+            { "e1f1", "e8e7", "f1e1", "e7e8", "e1d1", "e8d8", "d1e1", "d8e8" });
+        play_and_check(*stack, *fresh, "rnbqkbnr/pppppppp/8/8/8/8/8/4K3 w kq - 0 1",
+            { "e1e2", "e7e6", "e2e3", "e8e7", "e3d4", "e7d6", "d4e3", "d6e7", "e3e2" });
+
+        // random games, where only some of the positions are evaluated, so several
+        // moves are often applied at once. the stack is also popped at random
+        std::mt19937 rng(kernel + 1);
+
+        for (const std::string_view fen : BENCH_FENS) {
+            std::vector<Board> boards = { board_from_fen(std::string(fen)) };
+            stack->reset(boards.back());
+
+            for (int ply = 0; ply < 120; ply++) {
+                if (boards.size() > 1 && rng() % 8 == 0) {
+                    boards.pop_back();
+                    stack->pop();
+
+                    require_refreshed(*stack, *fresh, boards.back());
+                    continue;
+                }
+
+                Move moves[MAX_MOVES];
+                const int count = Movegen::get_legal_moves(boards.back(), moves);
+
+                if (count == 0)
+                    break;
+
+                Board child = boards.back().clone();
+                DirtyPieces dirty;
+                child.play_move(moves[rng() % count], dirty);
+
+                boards.push_back(child);
+                stack->push(child, dirty);
+
+                if (rng() % 3 == 0)
+                    require_refreshed(*stack, *fresh, child);
+            }
+
+            require_refreshed(*stack, *fresh, boards.back());
+        }
+    }
+}
+
+TEST_CASE("all kernels compute the same output", "[nnue]") {
+    const RandomNetwork network;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> values(-300, 300);
+
+    alignas(64) int16_t us[NNUE_HIDDEN_SIZE];
+    alignas(64) int16_t them[NNUE_HIDDEN_SIZE];
+
+    // random accumulators, including values which have to be clipped
+    for (int r = 0; r < 1000; r++) {
+        for (int i = 0; i < NNUE_HIDDEN_SIZE; i++) {
+            us[i]   = static_cast<int16_t>(values(rng));
+            them[i] = static_cast<int16_t>(values(rng));
+        }
+
+        const int32_t expected = NNUE::output_sum(us, them, KERNEL_SCALAR);
+
+        for (const NNUEKernel kernel : supported_kernels())
+            REQUIRE(NNUE::output_sum(us, them, kernel) == expected);
+    }
+
+    // the accumulators computed by each kernel must also be the same
+    const auto scalar = std::make_unique<AccumulatorStack>();
+    const auto stack  = std::make_unique<AccumulatorStack>();
+
+    for (const std::string_view fen : BENCH_FENS) {
+        const Board board = board_from_fen(std::string(fen));
+
+        NNUE::set_kernel(KERNEL_SCALAR);
+        scalar->reset(board);
+        const Accumulator &expected = scalar->current(board);
+
+        for (const NNUEKernel kernel : supported_kernels()) {
+            NNUE::set_kernel(kernel);
+            stack->reset(board);
+
+            REQUIRE(std::memcmp(stack->current(board).values, expected.values, sizeof(Accumulator::values)) == 0);
+            REQUIRE(NNUE::output_sum(expected.values[0], expected.values[1], kernel)
+                 == NNUE::output_sum(expected.values[0], expected.values[1], KERNEL_SCALAR));
+        }
+    }
+}
+
+TEST_CASE("batch evaluation matches the single evaluation", "[nnue]") {
+    const RandomNetwork network;
+
+    // positions from random games, so the blocks mix all kinds of material
+    std::vector<Board> boards;
+    std::mt19937 rng(11);
+
+    for (const std::string_view fen : BENCH_FENS) {
+        Board board = board_from_fen(std::string(fen));
+
+        for (int ply = 0; ply < 40; ply++) {
+            boards.push_back(board);
+
+            Move moves[MAX_MOVES];
+            const int count = Movegen::get_legal_moves(board, moves);
+
+            if (count == 0)
+                break;
+
+            board.play_move(moves[rng() % count]);
+        }
+    }
+
+    // a board without both kings is scored as zero
+    boards.push_back(board_from_fen("8/8/8/4k3/8/8/8/8 w - - 0 1"));
+
+    std::vector<int16_t> scores(boards.size());
+    ThreadPool pool(4);
+
+    for (const NNUEKernel kernel : supported_kernels()) {
+        NNUE::set_kernel(kernel);
+        NNUE::evaluate_batch(boards.data(), boards.size(), scores.data(), pool);
+
+        for (std::size_t i = 0; i + 1 < boards.size(); i++)
+            REQUIRE(scores[i] == NNUE::evaluate(boards[i]));
+
+        REQUIRE(scores.back() == 0);
+    }
+}
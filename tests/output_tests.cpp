@@ -0,0 +1,148 @@
+#include <condition_variable>
+#include <cstdio>
+#include <format>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "src/io/output.h"
+
+using namespace Kreveta;
+
+namespace {
+
+std::vector<std::string> read_lines(std::FILE *file) {
+    std::rewind(file);
+
+    std::vector<std::string> lines;
+    std::string line;
+
+    for (int c; (c = std::fgetc(file)) != EOF;) {
+        if (c == '\n') {
+            lines.push_back(line);
+            line.clear();
+        }
+        else line += static_cast<char>(c);
+    }
+
+    return lines;
+}
+
+std::vector<std::string> split_lines(const std::string &data) {
+    std::vector<std::string> lines;
+
+    std::size_t begin = 0, newline;
+    while ((newline = data.find('\n', begin)) != std::string::npos) {
+        lines.push_back(data.substr(begin, newline - begin));
+        begin = newline + 1;
+    }
+
+    return lines;
+}
+
+int count_prefix(const std::vector<std::string> &lines, const std::string &prefix) {
+    int count = 0;
+    for (const auto &line : lines)
+        count += line.starts_with(prefix);
+
+    return count;
+}
+
+}
+
+TEST_CASE("a burst of progress lines is coalesced", "[output]") {
+    constexpr int BURST = 1000;
+
+    // the sink holds the writer thread inside its first write until the whole burst
+    // is appended, so the outcome doesn't depend on how the threads are scheduled
+    std::mutex              mutex;
+    std::condition_variable changed;
+    bool entered = false;
+    bool release = false;
+
+    std::string written;
+
+    {
+        Output output([&](const std::string_view data) {
+            std::unique_lock lock(mutex);
+            written.append(data);
+
+            entered = true;
+            changed.notify_all();
+            changed.wait(lock, [&] { return release; });
+        });
+
+        output.append("readyok", false);
+
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&] { return entered; });
+        }
+
+        for (int i = 0; i < BURST; i++)
+            output.append(std::format("info depth 20 currmove e2e4 currmovenumber {} nodes {}", i + 1, i), true);
+
+        {
+            std::lock_guard lock(mutex);
+            release = true;
+        }
+
+        changed.notify_all();
+        output.wait_written();
+    }
+
+    const auto lines = split_lines(written);
+
+    // only the latest progress line of the burst is written
+    REQUIRE(lines.size() == 2);
+    REQUIRE(lines[0] == "readyok");
+    REQUIRE(lines[1] == std::format("info depth 20 currmove e2e4 currmovenumber {} nodes {}", BURST, BURST - 1));
+}
+
+TEST_CASE("pv lines and bestmove are never dropped", "[output]") {
+    std::FILE *file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    constexpr int DEPTHS = 30;
+    constexpr int BURST  = 100;
+
+    {
+        Output output(file);
+
+        for (int depth = 1; depth <= DEPTHS; depth++) {
+            for (int i = 0; i < BURST; i++)
+                output.append(std::format("info depth {} currmove e2e4 currmovenumber {}", depth, i + 1), true);
+
+            output.append(std::format("info depth {} score cp 20 nodes {} pv e2e4 e7e5", depth, depth * 1000), false);
+            output.append("info string side note", false);
+        }
+
+        for (int i = 0; i < BURST; i++)
+            output.append(std::format("info depth {} currmove d2d4 currmovenumber {}", DEPTHS + 1, i + 1), true);
+
+        output.append("bestmove e2e4 ponder e7e5", false);
+    }
+
+    const auto lines = read_lines(file);
+    std::fclose(file);
+
+    std::vector<std::string> kept;
+    for (const auto &line : lines)
+        if (line.find(" currmove ") == std::string::npos)
+            kept.push_back(line);
+
+    // everything except the progress lines is written in the original order
+    REQUIRE(kept.size() == 2 * DEPTHS + 1);
+    for (int depth = 1; depth <= DEPTHS; depth++) {
+        REQUIRE(kept[2 * depth - 2] == std::format("info depth {} score cp 20 nodes {} pv e2e4 e7e5", depth, depth * 1000));
+        REQUIRE(kept[2 * depth - 1] == "info string side note");
+    }
+
+    REQUIRE(kept.back() == "bestmove e2e4 ponder e7e5");
+    REQUIRE(lines.back() == "bestmove e2e4 ponder e7e5");
+
+    REQUIRE(count_prefix(lines, "info depth") - DEPTHS < DEPTHS * BURST);
+}
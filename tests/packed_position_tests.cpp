@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "src/io/packed_position.h"
+
+using namespace Kreveta;
+
+TEST_CASE("packed positions round trip", "[packed]") {
+    const Board board = Board::make_startpos();
+
+    const PackedPosition packed = PackedPosition::pack(board, 25, RESULT_DRAW, 7, 12);
+    REQUIRE(packed.is_valid());
+
+    const Board unpacked = packed.to_board();
+
+    REQUIRE(unpacked.occupied()       == board.occupied());
+    REQUIRE(unpacked.key              == board.key);
+    REQUIRE(unpacked.halfmove_clock   == 7);
+    REQUIRE(unpacked.castling_rights  == board.castling_rights);
+    REQUIRE(packed.result()           == RESULT_DRAW);
+}
+
+TEST_CASE("damaged packed positions are rejected", "[packed]") {
+    const PackedPosition valid = PackedPosition::pack(Board::make_startpos(), 0, RESULT_UNKNOWN);
+
+    // more pieces than the nibbles can hold
+    PackedPosition crowded = valid;
+    crowded.occupancy = ~0ULL;
+    REQUIRE_FALSE(crowded.is_valid());
+
+    // the first piece (the black rook on a8) becomes piece type 6
+    PackedPosition unknown_piece = valid;
+    unknown_piece.pieces[0] = static_cast<uint8_t>((unknown_piece.pieces[0] & 0xF0) | COL_BLACK << 3 | 6);
+    REQUIRE_FALSE(unknown_piece.is_valid());
+
+    // the black king on e8 (the fifth piece) becomes a queen
+    PackedPosition no_king = valid;
+    no_king.pieces[2] = static_cast<uint8_t>((no_king.pieces[2] & 0xF0) | COL_BLACK << 3 | PT_QUEEN);
+    REQUIRE_FALSE(no_king.is_valid());
+
+    // an unpacked damaged record still only contains valid pieces
+    const Board board = unknown_piece.to_board();
+    REQUIRE(board.occupied() == (valid.occupancy & ~1ULL));
+}
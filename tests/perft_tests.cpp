@@ -0,0 +1,171 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/movegen/movegen.h"
+
+using namespace Kreveta;
+
+// the number of leaf nodes of the legal move tree of the given depth
+static uint64_t perft(const Board &board, const int depth) {
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    if (depth == 1)
+        return count;
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < count; i++) {
+        Board child = board.clone();
+        child.play_move(moves[i]);
+
+        nodes += perft(child, depth - 1);
+    }
+
+    return nodes;
+}
+
+// the incrementally updated key must always match the key computed from scratch
+static void require_same_keys(const Board &board, const int depth) {
+    REQUIRE(board.key == board.compute_key());
+
+    if (depth == 0)
+        return;
+
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    for (int i = 0; i < count; i++) {
+        Board child = board.clone();
+        child.play_move(moves[i]);
+
+        require_same_keys(child, depth - 1);
+    }
+}
+
+static bool has_move(const Board &board, const std::string_view move) {
+    Move moves[MAX_MOVES];
+    const int count = Movegen::get_legal_moves(board, moves);
+
+    for (int i = 0; i < count; i++)
+        if (Move::to_str(moves[i]) == move)
+            return true;
+
+    return false;
+}
+
+// the board after playing the move, which must be legal
+static Board play(const Board &board, const std::string_view move) {
+    REQUIRE(has_move(board, move));
+
+    Board child = board.clone();
+    child.play_move(Move::str_to_move(move, board));
+    return child;
+}
+
+// the standard perft positions from the chess programming wiki
+constexpr std::string_view STARTPOS  = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+constexpr std::string_view KIWIPETE  = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+constexpr std::string_view POSITION3 = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1";
+constexpr std::string_view POSITION4 = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1";
+constexpr std::string_view POSITION5 = "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8";
+
+TEST_CASE("perft", "[perft]") {
+    REQUIRE(perft(board_from_fen(std::string(STARTPOS)), 1) == 20);
+    REQUIRE(perft(board_from_fen(std::string(STARTPOS)), 3) == 8902);
+    REQUIRE(perft(board_from_fen(std::string(STARTPOS)), 5) == 4865609);
+
+    REQUIRE(perft(board_from_fen(std::string(KIWIPETE)), 1) == 48);
+    REQUIRE(perft(board_from_fen(std::string(KIWIPETE)), 4) == 4085603);
+
+    REQUIRE(perft(board_from_fen(std::string(POSITION3)), 5) == 674624);
+    REQUIRE(perft(board_from_fen(std::string(POSITION4)), 4) == 422333);
+    REQUIRE(perft(board_from_fen(std::string(POSITION5)), 4) == 2103487);
+}
+
+TEST_CASE("incremental keys", "[perft]") {
+    for (const auto fen : { KIWIPETE, POSITION3, POSITION4, POSITION5 })
+        require_same_keys(board_from_fen(std::string(fen)), 3);
+}
+
+TEST_CASE("castling", "[perft]") {
+    const Board board = board_from_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+
+    REQUIRE(has_move(board, "e1g1"));
+    REQUIRE(has_move(board, "e1c1"));
+
+    // the rook jumps over the king, and both white rights are lost
+    const Board castled = play(board, "e1g1");
+    REQUIRE(castled.piece_at(62, COL_WHITE) == PT_KING);
+    REQUIRE(castled.piece_at(61, COL_WHITE) == PT_ROOK);
+    REQUIRE(castled.piece_at(63, COL_WHITE) == PT_NONE);
+    REQUIRE(castled.castling_rights == (CR_B_KINGSIDE | CR_B_QUEENSIDE));
+
+    // moving a rook only loses its own side, and capturing a rook removes its right
+    REQUIRE(play(board, "h1h2").castling_rights == (CR_W_QUEENSIDE | CR_B_KINGSIDE | CR_B_QUEENSIDE));
+    REQUIRE(play(board, "a1a8").castling_rights == (CR_W_KINGSIDE | CR_B_KINGSIDE));
+
+    // the king can't castle out of, through or into check
+    REQUIRE_FALSE(has_move(board_from_fen("r3k2r/8/8/8/8/8/4r3/R3K2R w KQkq - 0 1"), "e1g1"));
+    REQUIRE_FALSE(has_move(board_from_fen("r3k2r/8/8/8/8/8/4r3/R3K2R w KQkq - 0 1"), "e1c1"));
+    REQUIRE_FALSE(has_move(board_from_fen("4kr2/8/8/8/8/8/8/R3K2R w KQ - 0 1"),      "e1g1"));
+    REQUIRE(      has_move(board_from_fen("4kr2/8/8/8/8/8/8/R3K2R w KQ - 0 1"),      "e1c1"));
+    REQUIRE_FALSE(has_move(board_from_fen("4k1r1/8/8/8/8/8/8/R3K2R w KQ - 0 1"),     "e1g1"));
+
+    // the b1 square may be attacked, but it must be empty
+    REQUIRE(      has_move(board_from_fen("1r2k3/8/8/8/8/8/8/R3K3 w Q - 0 1"),  "e1c1"));
+    REQUIRE_FALSE(has_move(board_from_fen("4k3/8/8/8/8/8/8/RN2K3 w Q - 0 1"),   "e1c1"));
+
+    // without the right there is no castling
+    REQUIRE_FALSE(has_move(board_from_fen("r3k2r/8/8/8/8/8/8/R3K2R w Qkq - 0 1"), "e1g1"));
+}
+
+TEST_CASE("en passant", "[perft]") {
+    const Board board = board_from_fen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+
+    // the captured pawn isn't on the square the capturing pawn moves to
+    const Board captured = play(board, "e5d6");
+    REQUIRE(captured.piece_at(19, COL_WHITE) == PT_PAWN);
+    REQUIRE(captured.piece_at(27, COL_BLACK) == PT_NONE);
+    REQUIRE(captured.en_passant_sq == 64);
+
+    // a double push sets the square, which is only available for one move
+    const Board pushed = play(board_from_fen("4k3/2p5/8/3P4/8/8/8/4K3 b - - 0 1"), "c7c5");
+    REQUIRE(pushed.en_passant_sq == 18);
+    REQUIRE(has_move(pushed, "d5c6"));
+    REQUIRE_FALSE(has_move(play(play(pushed, "e1e2"), "e8e7"), "d5c6"));
+
+    // both pawns disappear from the rank, which would expose the king
+    REQUIRE_FALSE(has_move(board_from_fen("8/8/8/K2pP2r/8/8/8/7k w - d6 0 1"), "e5d6"));
+
+    // capturing the checking pawn en passant is legal
+    REQUIRE(has_move(board_from_fen("8/8/8/5k2/3pP3/8/8/4K3 b - e3 0 1"), "d4e3"));
+}
+
+TEST_CASE("legal moves", "[perft]") {
+
+    // a pinned piece can only move along the pin
+    const Board pinned = board_from_fen("4r2k/8/8/8/8/8/4R3/4K3 w - - 0 1");
+    REQUIRE(has_move(pinned, "e2e5"));
+    REQUIRE_FALSE(has_move(pinned, "e2d2"));
+
+    // in check, only moves that resolve the check are legal
+    const Board check = board_from_fen("4k3/8/8/8/8/8/3q4/R3K3 w - - 0 1");
+    REQUIRE(Movegen::is_in_check(check, COL_WHITE));
+    REQUIRE(perft(check, 1) == 2);
+    REQUIRE(has_move(check, "e1d2"));
+    REQUIRE(has_move(check, "e1f1"));
+
+    // the king can't capture a protected piece or step into an attack
+    const Board king = board_from_fen("4k3/8/8/8/8/4b3/3q4/4K3 w - - 0 1");
+    REQUIRE_FALSE(has_move(king, "e1d2"));
+    REQUIRE_FALSE(has_move(king, "e1e2"));
+    REQUIRE(has_move(king, "e1f1"));
+
+    // checkmate and stalemate leave no legal moves
+    REQUIRE(perft(board_from_fen("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1"), 1) == 0);
+    REQUIRE(perft(board_from_fen("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1"), 1) == 0);
+}
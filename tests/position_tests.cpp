@@ -0,0 +1,42 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "src/position.h"
+#include "src/utils.h"
+
+using namespace Kreveta;
+
+static void set_position(const std::string &command) {
+    const auto tokens = str_split(command);
+    if (tokens[1] == "startpos") Position::set_startpos(tokens);
+    else                         Position::set_position_fen(tokens);
+}
+
+TEST_CASE("extending the move list matches the full replay") {
+    set_position("position startpos moves e2e4 e7e5");
+    set_position("position startpos moves e2e4 e7e5 g1f3 b8c6 f1b5");
+
+    const auto incremental_key     = Position::board.key;
+    const auto incremental_history = Position::history;
+
+    // a different base position forces the whole list to be replayed
+    set_position("position fen rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    set_position("position startpos moves e2e4 e7e5 g1f3 b8c6 f1b5");
+
+    REQUIRE(Position::board.key == incremental_key);
+    REQUIRE(Position::history == incremental_history);
+    REQUIRE(Position::history.size() == 5);
+
+    // a list, which doesn't extend the previous one, starts over
+    set_position("position startpos moves d2d4");
+    REQUIRE(Position::history.size() == 1);
+}
+
+TEST_CASE("an invalid extension keeps the previous position") {
+    set_position("position startpos moves e2e4");
+    const auto key = Position::board.key;
+
+    set_position("position startpos moves e2e4 e7e5 xyz");
+
+    REQUIRE(Position::board.key == key);
+    REQUIRE(Position::history.size() == 1);
+}
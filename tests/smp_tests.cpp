@@ -0,0 +1,23 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/search/smp.h"
+
+using namespace Kreveta;
+
+TEST_CASE("the node limit applies to all threads together", "[smp]") {
+    TranspositionTable tt;
+
+    LazySMP smp(tt, 4);
+    smp.set_silent(true);
+
+    SearchLimits limits;
+    limits.nodes = 100000;
+
+    const Board board = board_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    const SearchResult result = smp.search(board, {}, limits);
+
+    // the threads publish their nodes in small batches, so they may overshoot a little
+    REQUIRE(result.nodes >= limits.nodes);
+    REQUIRE(result.nodes <= limits.nodes + 4 * 1000);
+}
@@ -0,0 +1,85 @@
+#include <filesystem>
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_utils.h"
+#include "src/tablebase/syzygy.h"
+
+using namespace Kreveta;
+
+// the official KQvK, KRvK, KBvK, KNvK, KPvK and KPvKP tables (.rtbw and .rtbz),
+// downloaded into tests/data/syzygy by tests/data/fetch_syzygy.sh. the minor piece
+// ones are probed after underpromotions. the dtz of KPvKP with a pawn about to
+// promote would need the KxvKP tables
+static void load_tables() {
+    const std::filesystem::path dir = std::filesystem::path(KREVETA_TEST_DATA) / "syzygy";
+
+    for (const char *table : { "KQvK", "KRvK", "KBvK", "KNvK", "KPvK", "KPvKP" }) {
+        for (const char *ext : { ".rtbw", ".rtbz" })
+            REQUIRE(std::filesystem::exists(dir / (std::string(table) + ext)));
+    }
+
+    Syzygy::init(dir.string());
+    REQUIRE(Syzygy::max_pieces() == 4);
+}
+
+static WDLScore wdl(const std::string &fen) {
+    ProbeState state;
+    const WDLScore score = Syzygy::probe_wdl(board_from_fen(fen), state);
+
+    REQUIRE(state != PROBE_FAIL);
+    return score;
+}
+
+static int dtz(const std::string &fen) {
+    ProbeState state;
+    const int score = Syzygy::probe_dtz(board_from_fen(fen), state);
+
+    REQUIRE(state != PROBE_FAIL);
+    return score;
+}
+
+TEST_CASE("syzygy wdl") {
+    load_tables();
+
+    // the same position with either side to move
+    REQUIRE(wdl("4k3/8/8/8/8/8/8/3QK3 w - - 0 1") == WDL_WIN);
+    REQUIRE(wdl("4k3/8/8/8/8/8/8/3QK3 b - - 0 1") == WDL_LOSS);
+
+    // stalemate
+    REQUIRE(wdl("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1") == WDL_DRAW);
+
+    // the undefended rook is captured
+    REQUIRE(wdl("8/8/8/8/8/8/1k6/1R2K3 b - - 0 1") == WDL_DRAW);
+
+    // a rook pawn with the defending king in the corner, and a pawn outside the square
+    REQUIRE(wdl("k7/8/8/8/8/8/P7/K7 w - - 0 1")     == WDL_DRAW);
+    REQUIRE(wdl("8/8/8/8/8/k7/6P1/6K1 w - - 0 1")   == WDL_WIN);
+
+    // the side to move doesn't have the opposition
+    REQUIRE(wdl("4k3/8/8/8/8/8/4P3/4K3 w - - 0 1")  == WDL_WIN);
+    REQUIRE(wdl("4k3/8/8/8/8/8/4P3/4K3 b - - 0 1")  == WDL_DRAW);
+
+    // only the en passant capture saves the pawn, which then draws
+    REQUIRE(wdl("k7/8/8/8/3pP3/3K4/8/8 b - e3 0 1") == WDL_DRAW);
+    REQUIRE(wdl("k7/8/8/8/3pP3/3K4/8/8 b - - 0 1")  == WDL_LOSS);
+}
+
+TEST_CASE("syzygy dtz") {
+    load_tables();
+
+    // mate in one, and mated after any move
+    REQUIRE(dtz("4k3/8/4K3/8/8/8/8/Q7 w - - 0 1")  ==  1);
+    REQUIRE(dtz("7k/8/5K2/8/8/8/8/6Q1 b - - 0 1")  == -2);
+
+    // the winning pawn push resets the counter right away, and so does a promotion
+    REQUIRE(dtz("8/8/8/8/8/k7/6P1/6K1 w - - 0 1")  ==  1);
+    REQUIRE(dtz("8/P7/8/8/8/8/8/k1K5 w - - 0 1")   ==  1);
+
+    // the table only stores white to move, so this one is found by a search
+    REQUIRE(dtz("8/8/8/8/8/k7/6P1/6K1 b - - 0 1")  == -2);
+
+    REQUIRE(dtz("k7/8/8/8/3pP3/3K4/8/8 b - e3 0 1") ==  0);
+    REQUIRE(dtz("k7/8/8/8/3pP3/3K4/8/8 b - - 0 1")  == -2);
+}
@@ -0,0 +1,23 @@
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "src/board.h"
+#include "src/position.h"
+#include "src/utils.h"
+
+namespace Kreveta {
+
+// the board described by the FEN string, which must be valid
+inline Board board_from_fen(const std::string &fen) {
+    Board board;
+    REQUIRE(Position::try_parse_fen(str_split(fen), board));
+    return board;
+}
+
+}
+
+#endif //TEST_UTILS_H
@@ -0,0 +1,71 @@
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "src/search/tt.h"
+
+using namespace Kreveta;
+
+TEST_CASE("hash file round trip") {
+    const auto path = (std::filesystem::temp_directory_path() / "kreveta_tt_test.bin").string();
+
+    TranspositionTable tt(1);
+    tt.store(0x1234567890ABCDEFULL, Move(), 57,  12, BOUND_EXACT);
+    tt.store(0x0FEDCBA098765432ULL, Move(), -31, 2,  BOUND_LOWER);
+
+    REQUIRE(tt.save(path));
+
+    // the table doesn't have to be of the same size
+    TranspositionTable loaded(2);
+    REQUIRE(loaded.load(path));
+
+    TTData data;
+    REQUIRE(loaded.probe(0x1234567890ABCDEFULL, data));
+    REQUIRE(data.score   == 57);
+    REQUIRE(data.depth   == 12);
+    REQUIRE(data.bound() == BOUND_EXACT);
+
+    REQUIRE(loaded.probe(0x0FEDCBA098765432ULL, data));
+    REQUIRE(data.score == -31);
+
+    // shallow entries are left out
+    REQUIRE(tt.save(path, 5));
+    REQUIRE(loaded.load(path));
+
+    REQUIRE(loaded.probe(0x1234567890ABCDEFULL, data));
+    REQUIRE_FALSE(loaded.probe(0x0FEDCBA098765432ULL, data));
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("hash file with a corrupted count") {
+    const auto path = (std::filesystem::temp_directory_path() / "kreveta_tt_count_test.bin").string();
+
+    TranspositionTable tt(1);
+    tt.store(0x1234567890ABCDEFULL, Move(), 57,  12, BOUND_EXACT);
+    tt.store(0x0FEDCBA098765432ULL, Move(), -31, 2,  BOUND_LOWER);
+
+    REQUIRE(tt.save(path));
+
+    const auto write_count = [&](const uint64_t count) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetof(TTFileHeader, count));
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    };
+
+    TranspositionTable loaded(1);
+
+    // the expected size of this count overflows into the real size of the file
+    write_count(2 + (1ULL << 60));
+    REQUIRE_FALSE(loaded.load(path));
+
+    write_count(3);
+    REQUIRE_FALSE(loaded.load(path));
+
+    write_count(2);
+    REQUIRE(loaded.load(path));
+
+    std::filesystem::remove(path);
+}
@@ -6,14 +6,16 @@
 
 #include "src/utils.h"
 
+using namespace Kreveta;
+
 TEST_CASE("is string blank") {
     constexpr std::string_view str1 = "";
     constexpr std::string_view str2 = "   \n\r";
     constexpr std::string_view str3 = "\n\r g?";
 
-    REQUIRE(Kreveta::is_str_blank(str1) == true);
-    REQUIRE(Kreveta::is_str_blank(str2) == true);
-    REQUIRE(Kreveta::is_str_blank(str3) == false);
+    REQUIRE(is_str_blank(str1) == true);
+    REQUIRE(is_str_blank(str2) == true);
+    REQUIRE(is_str_blank(str3) == false);
 }
 
 TEST_CASE("split string correctly") {
@@ -21,9 +23,20 @@ TEST_CASE("split string correctly") {
     const std::string str2 = "uci";
     const std::string str3 = "position   startpos moves    e2e4";
 
-    REQUIRE(Kreveta::str_split(str1).size() == 0);
-    REQUIRE(Kreveta::str_split(str2).size() == 1);
-    REQUIRE(Kreveta::str_split(str3).size() == 4);
+    REQUIRE(str_split(str1).size() == 0);
+    REQUIRE(str_split(str2).size() == 1);
+    REQUIRE(str_split(str3).size() == 4);
+
+    REQUIRE(str_split(str3)[2] == "moves");
+}
+
+TEST_CASE("split string into a reused vector") {
+    std::vector<std::string_view> tokens;
+
+    str_split("position startpos moves e2e4 e7e5", tokens);
+    REQUIRE(tokens.size() == 5);
 
-    REQUIRE(Kreveta::str_split(str3)[2] == "moves");
+    str_split("  go  depth 5\r", tokens);
+    REQUIRE(tokens.size() == 3);
+    REQUIRE(tokens[1] == "depth");
 }